@@ -1,7 +1,9 @@
 /* 
-    Implementation of the AES module in ECB mode with ANSI X9.23 Padding.
+    Implementation of the AES module (128, 192 and 256-bits keys) in ECB mode with ANSI X9.23 Padding.
+    The other modes of operation are implemented in AES_modes.c.
 */
-#include "AES.h"
+#include "AES_backends.h"
+#include <time.h>
 
 
 static int Forward_S_Box[16*16] = {
@@ -63,6 +65,294 @@ static int Inv_S_Box[16*16] = {
 };
 
 
+/*
+    T-tables (AES_ENGINE_TTABLE).
+    Each entry folds SubBytes + MixColumns of one byte into its 32-bits column contribution:
+        Te0[x] = (2.S[x], S[x], S[x], 3.S[x])           with S = Forward_S_Box
+        Td0[x] = (e.Si[x], 9.Si[x], d.Si[x], b.Si[x])   with Si = Inv_S_Box
+    Te1..Te3 (resp. Td1..Td3) are Te0 (resp. Td0) rotated right by 8, 16 and 24 bits.
+*/
+static const uint32_t Te0[256] = {
+    0xc66363a5, 0xf87c7c84, 0xee777799, 0xf67b7b8d, 0xfff2f20d, 0xd66b6bbd, 0xde6f6fb1, 0x91c5c554,
+    0x60303050, 0x02010103, 0xce6767a9, 0x562b2b7d, 0xe7fefe19, 0xb5d7d762, 0x4dababe6, 0xec76769a,
+    0x8fcaca45, 0x1f82829d, 0x89c9c940, 0xfa7d7d87, 0xeffafa15, 0xb25959eb, 0x8e4747c9, 0xfbf0f00b,
+    0x41adadec, 0xb3d4d467, 0x5fa2a2fd, 0x45afafea, 0x239c9cbf, 0x53a4a4f7, 0xe4727296, 0x9bc0c05b,
+    0x75b7b7c2, 0xe1fdfd1c, 0x3d9393ae, 0x4c26266a, 0x6c36365a, 0x7e3f3f41, 0xf5f7f702, 0x83cccc4f,
+    0x6834345c, 0x51a5a5f4, 0xd1e5e534, 0xf9f1f108, 0xe2717193, 0xabd8d873, 0x62313153, 0x2a15153f,
+    0x0804040c, 0x95c7c752, 0x46232365, 0x9dc3c35e, 0x30181828, 0x379696a1, 0x0a05050f, 0x2f9a9ab5,
+    0x0e070709, 0x24121236, 0x1b80809b, 0xdfe2e23d, 0xcdebeb26, 0x4e272769, 0x7fb2b2cd, 0xea75759f,
+    0x1209091b, 0x1d83839e, 0x582c2c74, 0x341a1a2e, 0x361b1b2d, 0xdc6e6eb2, 0xb45a5aee, 0x5ba0a0fb,
+    0xa45252f6, 0x763b3b4d, 0xb7d6d661, 0x7db3b3ce, 0x5229297b, 0xdde3e33e, 0x5e2f2f71, 0x13848497,
+    0xa65353f5, 0xb9d1d168, 0x00000000, 0xc1eded2c, 0x40202060, 0xe3fcfc1f, 0x79b1b1c8, 0xb65b5bed,
+    0xd46a6abe, 0x8dcbcb46, 0x67bebed9, 0x7239394b, 0x944a4ade, 0x984c4cd4, 0xb05858e8, 0x85cfcf4a,
+    0xbbd0d06b, 0xc5efef2a, 0x4faaaae5, 0xedfbfb16, 0x864343c5, 0x9a4d4dd7, 0x66333355, 0x11858594,
+    0x8a4545cf, 0xe9f9f910, 0x04020206, 0xfe7f7f81, 0xa05050f0, 0x783c3c44, 0x259f9fba, 0x4ba8a8e3,
+    0xa25151f3, 0x5da3a3fe, 0x804040c0, 0x058f8f8a, 0x3f9292ad, 0x219d9dbc, 0x70383848, 0xf1f5f504,
+    0x63bcbcdf, 0x77b6b6c1, 0xafdada75, 0x42212163, 0x20101030, 0xe5ffff1a, 0xfdf3f30e, 0xbfd2d26d,
+    0x81cdcd4c, 0x180c0c14, 0x26131335, 0xc3ecec2f, 0xbe5f5fe1, 0x359797a2, 0x884444cc, 0x2e171739,
+    0x93c4c457, 0x55a7a7f2, 0xfc7e7e82, 0x7a3d3d47, 0xc86464ac, 0xba5d5de7, 0x3219192b, 0xe6737395,
+    0xc06060a0, 0x19818198, 0x9e4f4fd1, 0xa3dcdc7f, 0x44222266, 0x542a2a7e, 0x3b9090ab, 0x0b888883,
+    0x8c4646ca, 0xc7eeee29, 0x6bb8b8d3, 0x2814143c, 0xa7dede79, 0xbc5e5ee2, 0x160b0b1d, 0xaddbdb76,
+    0xdbe0e03b, 0x64323256, 0x743a3a4e, 0x140a0a1e, 0x924949db, 0x0c06060a, 0x4824246c, 0xb85c5ce4,
+    0x9fc2c25d, 0xbdd3d36e, 0x43acacef, 0xc46262a6, 0x399191a8, 0x319595a4, 0xd3e4e437, 0xf279798b,
+    0xd5e7e732, 0x8bc8c843, 0x6e373759, 0xda6d6db7, 0x018d8d8c, 0xb1d5d564, 0x9c4e4ed2, 0x49a9a9e0,
+    0xd86c6cb4, 0xac5656fa, 0xf3f4f407, 0xcfeaea25, 0xca6565af, 0xf47a7a8e, 0x47aeaee9, 0x10080818,
+    0x6fbabad5, 0xf0787888, 0x4a25256f, 0x5c2e2e72, 0x381c1c24, 0x57a6a6f1, 0x73b4b4c7, 0x97c6c651,
+    0xcbe8e823, 0xa1dddd7c, 0xe874749c, 0x3e1f1f21, 0x964b4bdd, 0x61bdbddc, 0x0d8b8b86, 0x0f8a8a85,
+    0xe0707090, 0x7c3e3e42, 0x71b5b5c4, 0xcc6666aa, 0x904848d8, 0x06030305, 0xf7f6f601, 0x1c0e0e12,
+    0xc26161a3, 0x6a35355f, 0xae5757f9, 0x69b9b9d0, 0x17868691, 0x99c1c158, 0x3a1d1d27, 0x279e9eb9,
+    0xd9e1e138, 0xebf8f813, 0x2b9898b3, 0x22111133, 0xd26969bb, 0xa9d9d970, 0x078e8e89, 0x339494a7,
+    0x2d9b9bb6, 0x3c1e1e22, 0x15878792, 0xc9e9e920, 0x87cece49, 0xaa5555ff, 0x50282878, 0xa5dfdf7a,
+    0x038c8c8f, 0x59a1a1f8, 0x09898980, 0x1a0d0d17, 0x65bfbfda, 0xd7e6e631, 0x844242c6, 0xd06868b8,
+    0x824141c3, 0x299999b0, 0x5a2d2d77, 0x1e0f0f11, 0x7bb0b0cb, 0xa85454fc, 0x6dbbbbd6, 0x2c16163a
+};
+
+static const uint32_t Te1[256] = {
+    0xa5c66363, 0x84f87c7c, 0x99ee7777, 0x8df67b7b, 0x0dfff2f2, 0xbdd66b6b, 0xb1de6f6f, 0x5491c5c5,
+    0x50603030, 0x03020101, 0xa9ce6767, 0x7d562b2b, 0x19e7fefe, 0x62b5d7d7, 0xe64dabab, 0x9aec7676,
+    0x458fcaca, 0x9d1f8282, 0x4089c9c9, 0x87fa7d7d, 0x15effafa, 0xebb25959, 0xc98e4747, 0x0bfbf0f0,
+    0xec41adad, 0x67b3d4d4, 0xfd5fa2a2, 0xea45afaf, 0xbf239c9c, 0xf753a4a4, 0x96e47272, 0x5b9bc0c0,
+    0xc275b7b7, 0x1ce1fdfd, 0xae3d9393, 0x6a4c2626, 0x5a6c3636, 0x417e3f3f, 0x02f5f7f7, 0x4f83cccc,
+    0x5c683434, 0xf451a5a5, 0x34d1e5e5, 0x08f9f1f1, 0x93e27171, 0x73abd8d8, 0x53623131, 0x3f2a1515,
+    0x0c080404, 0x5295c7c7, 0x65462323, 0x5e9dc3c3, 0x28301818, 0xa1379696, 0x0f0a0505, 0xb52f9a9a,
+    0x090e0707, 0x36241212, 0x9b1b8080, 0x3ddfe2e2, 0x26cdebeb, 0x694e2727, 0xcd7fb2b2, 0x9fea7575,
+    0x1b120909, 0x9e1d8383, 0x74582c2c, 0x2e341a1a, 0x2d361b1b, 0xb2dc6e6e, 0xeeb45a5a, 0xfb5ba0a0,
+    0xf6a45252, 0x4d763b3b, 0x61b7d6d6, 0xce7db3b3, 0x7b522929, 0x3edde3e3, 0x715e2f2f, 0x97138484,
+    0xf5a65353, 0x68b9d1d1, 0x00000000, 0x2cc1eded, 0x60402020, 0x1fe3fcfc, 0xc879b1b1, 0xedb65b5b,
+    0xbed46a6a, 0x468dcbcb, 0xd967bebe, 0x4b723939, 0xde944a4a, 0xd4984c4c, 0xe8b05858, 0x4a85cfcf,
+    0x6bbbd0d0, 0x2ac5efef, 0xe54faaaa, 0x16edfbfb, 0xc5864343, 0xd79a4d4d, 0x55663333, 0x94118585,
+    0xcf8a4545, 0x10e9f9f9, 0x06040202, 0x81fe7f7f, 0xf0a05050, 0x44783c3c, 0xba259f9f, 0xe34ba8a8,
+    0xf3a25151, 0xfe5da3a3, 0xc0804040, 0x8a058f8f, 0xad3f9292, 0xbc219d9d, 0x48703838, 0x04f1f5f5,
+    0xdf63bcbc, 0xc177b6b6, 0x75afdada, 0x63422121, 0x30201010, 0x1ae5ffff, 0x0efdf3f3, 0x6dbfd2d2,
+    0x4c81cdcd, 0x14180c0c, 0x35261313, 0x2fc3ecec, 0xe1be5f5f, 0xa2359797, 0xcc884444, 0x392e1717,
+    0x5793c4c4, 0xf255a7a7, 0x82fc7e7e, 0x477a3d3d, 0xacc86464, 0xe7ba5d5d, 0x2b321919, 0x95e67373,
+    0xa0c06060, 0x98198181, 0xd19e4f4f, 0x7fa3dcdc, 0x66442222, 0x7e542a2a, 0xab3b9090, 0x830b8888,
+    0xca8c4646, 0x29c7eeee, 0xd36bb8b8, 0x3c281414, 0x79a7dede, 0xe2bc5e5e, 0x1d160b0b, 0x76addbdb,
+    0x3bdbe0e0, 0x56643232, 0x4e743a3a, 0x1e140a0a, 0xdb924949, 0x0a0c0606, 0x6c482424, 0xe4b85c5c,
+    0x5d9fc2c2, 0x6ebdd3d3, 0xef43acac, 0xa6c46262, 0xa8399191, 0xa4319595, 0x37d3e4e4, 0x8bf27979,
+    0x32d5e7e7, 0x438bc8c8, 0x596e3737, 0xb7da6d6d, 0x8c018d8d, 0x64b1d5d5, 0xd29c4e4e, 0xe049a9a9,
+    0xb4d86c6c, 0xfaac5656, 0x07f3f4f4, 0x25cfeaea, 0xafca6565, 0x8ef47a7a, 0xe947aeae, 0x18100808,
+    0xd56fbaba, 0x88f07878, 0x6f4a2525, 0x725c2e2e, 0x24381c1c, 0xf157a6a6, 0xc773b4b4, 0x5197c6c6,
+    0x23cbe8e8, 0x7ca1dddd, 0x9ce87474, 0x213e1f1f, 0xdd964b4b, 0xdc61bdbd, 0x860d8b8b, 0x850f8a8a,
+    0x90e07070, 0x427c3e3e, 0xc471b5b5, 0xaacc6666, 0xd8904848, 0x05060303, 0x01f7f6f6, 0x121c0e0e,
+    0xa3c26161, 0x5f6a3535, 0xf9ae5757, 0xd069b9b9, 0x91178686, 0x5899c1c1, 0x273a1d1d, 0xb9279e9e,
+    0x38d9e1e1, 0x13ebf8f8, 0xb32b9898, 0x33221111, 0xbbd26969, 0x70a9d9d9, 0x89078e8e, 0xa7339494,
+    0xb62d9b9b, 0x223c1e1e, 0x92158787, 0x20c9e9e9, 0x4987cece, 0xffaa5555, 0x78502828, 0x7aa5dfdf,
+    0x8f038c8c, 0xf859a1a1, 0x80098989, 0x171a0d0d, 0xda65bfbf, 0x31d7e6e6, 0xc6844242, 0xb8d06868,
+    0xc3824141, 0xb0299999, 0x775a2d2d, 0x111e0f0f, 0xcb7bb0b0, 0xfca85454, 0xd66dbbbb, 0x3a2c1616
+};
+
+static const uint32_t Te2[256] = {
+    0x63a5c663, 0x7c84f87c, 0x7799ee77, 0x7b8df67b, 0xf20dfff2, 0x6bbdd66b, 0x6fb1de6f, 0xc55491c5,
+    0x30506030, 0x01030201, 0x67a9ce67, 0x2b7d562b, 0xfe19e7fe, 0xd762b5d7, 0xabe64dab, 0x769aec76,
+    0xca458fca, 0x829d1f82, 0xc94089c9, 0x7d87fa7d, 0xfa15effa, 0x59ebb259, 0x47c98e47, 0xf00bfbf0,
+    0xadec41ad, 0xd467b3d4, 0xa2fd5fa2, 0xafea45af, 0x9cbf239c, 0xa4f753a4, 0x7296e472, 0xc05b9bc0,
+    0xb7c275b7, 0xfd1ce1fd, 0x93ae3d93, 0x266a4c26, 0x365a6c36, 0x3f417e3f, 0xf702f5f7, 0xcc4f83cc,
+    0x345c6834, 0xa5f451a5, 0xe534d1e5, 0xf108f9f1, 0x7193e271, 0xd873abd8, 0x31536231, 0x153f2a15,
+    0x040c0804, 0xc75295c7, 0x23654623, 0xc35e9dc3, 0x18283018, 0x96a13796, 0x050f0a05, 0x9ab52f9a,
+    0x07090e07, 0x12362412, 0x809b1b80, 0xe23ddfe2, 0xeb26cdeb, 0x27694e27, 0xb2cd7fb2, 0x759fea75,
+    0x091b1209, 0x839e1d83, 0x2c74582c, 0x1a2e341a, 0x1b2d361b, 0x6eb2dc6e, 0x5aeeb45a, 0xa0fb5ba0,
+    0x52f6a452, 0x3b4d763b, 0xd661b7d6, 0xb3ce7db3, 0x297b5229, 0xe33edde3, 0x2f715e2f, 0x84971384,
+    0x53f5a653, 0xd168b9d1, 0x00000000, 0xed2cc1ed, 0x20604020, 0xfc1fe3fc, 0xb1c879b1, 0x5bedb65b,
+    0x6abed46a, 0xcb468dcb, 0xbed967be, 0x394b7239, 0x4ade944a, 0x4cd4984c, 0x58e8b058, 0xcf4a85cf,
+    0xd06bbbd0, 0xef2ac5ef, 0xaae54faa, 0xfb16edfb, 0x43c58643, 0x4dd79a4d, 0x33556633, 0x85941185,
+    0x45cf8a45, 0xf910e9f9, 0x02060402, 0x7f81fe7f, 0x50f0a050, 0x3c44783c, 0x9fba259f, 0xa8e34ba8,
+    0x51f3a251, 0xa3fe5da3, 0x40c08040, 0x8f8a058f, 0x92ad3f92, 0x9dbc219d, 0x38487038, 0xf504f1f5,
+    0xbcdf63bc, 0xb6c177b6, 0xda75afda, 0x21634221, 0x10302010, 0xff1ae5ff, 0xf30efdf3, 0xd26dbfd2,
+    0xcd4c81cd, 0x0c14180c, 0x13352613, 0xec2fc3ec, 0x5fe1be5f, 0x97a23597, 0x44cc8844, 0x17392e17,
+    0xc45793c4, 0xa7f255a7, 0x7e82fc7e, 0x3d477a3d, 0x64acc864, 0x5de7ba5d, 0x192b3219, 0x7395e673,
+    0x60a0c060, 0x81981981, 0x4fd19e4f, 0xdc7fa3dc, 0x22664422, 0x2a7e542a, 0x90ab3b90, 0x88830b88,
+    0x46ca8c46, 0xee29c7ee, 0xb8d36bb8, 0x143c2814, 0xde79a7de, 0x5ee2bc5e, 0x0b1d160b, 0xdb76addb,
+    0xe03bdbe0, 0x32566432, 0x3a4e743a, 0x0a1e140a, 0x49db9249, 0x060a0c06, 0x246c4824, 0x5ce4b85c,
+    0xc25d9fc2, 0xd36ebdd3, 0xacef43ac, 0x62a6c462, 0x91a83991, 0x95a43195, 0xe437d3e4, 0x798bf279,
+    0xe732d5e7, 0xc8438bc8, 0x37596e37, 0x6db7da6d, 0x8d8c018d, 0xd564b1d5, 0x4ed29c4e, 0xa9e049a9,
+    0x6cb4d86c, 0x56faac56, 0xf407f3f4, 0xea25cfea, 0x65afca65, 0x7a8ef47a, 0xaee947ae, 0x08181008,
+    0xbad56fba, 0x7888f078, 0x256f4a25, 0x2e725c2e, 0x1c24381c, 0xa6f157a6, 0xb4c773b4, 0xc65197c6,
+    0xe823cbe8, 0xdd7ca1dd, 0x749ce874, 0x1f213e1f, 0x4bdd964b, 0xbddc61bd, 0x8b860d8b, 0x8a850f8a,
+    0x7090e070, 0x3e427c3e, 0xb5c471b5, 0x66aacc66, 0x48d89048, 0x03050603, 0xf601f7f6, 0x0e121c0e,
+    0x61a3c261, 0x355f6a35, 0x57f9ae57, 0xb9d069b9, 0x86911786, 0xc15899c1, 0x1d273a1d, 0x9eb9279e,
+    0xe138d9e1, 0xf813ebf8, 0x98b32b98, 0x11332211, 0x69bbd269, 0xd970a9d9, 0x8e89078e, 0x94a73394,
+    0x9bb62d9b, 0x1e223c1e, 0x87921587, 0xe920c9e9, 0xce4987ce, 0x55ffaa55, 0x28785028, 0xdf7aa5df,
+    0x8c8f038c, 0xa1f859a1, 0x89800989, 0x0d171a0d, 0xbfda65bf, 0xe631d7e6, 0x42c68442, 0x68b8d068,
+    0x41c38241, 0x99b02999, 0x2d775a2d, 0x0f111e0f, 0xb0cb7bb0, 0x54fca854, 0xbbd66dbb, 0x163a2c16
+};
+
+static const uint32_t Te3[256] = {
+    0x6363a5c6, 0x7c7c84f8, 0x777799ee, 0x7b7b8df6, 0xf2f20dff, 0x6b6bbdd6, 0x6f6fb1de, 0xc5c55491,
+    0x30305060, 0x01010302, 0x6767a9ce, 0x2b2b7d56, 0xfefe19e7, 0xd7d762b5, 0xababe64d, 0x76769aec,
+    0xcaca458f, 0x82829d1f, 0xc9c94089, 0x7d7d87fa, 0xfafa15ef, 0x5959ebb2, 0x4747c98e, 0xf0f00bfb,
+    0xadadec41, 0xd4d467b3, 0xa2a2fd5f, 0xafafea45, 0x9c9cbf23, 0xa4a4f753, 0x727296e4, 0xc0c05b9b,
+    0xb7b7c275, 0xfdfd1ce1, 0x9393ae3d, 0x26266a4c, 0x36365a6c, 0x3f3f417e, 0xf7f702f5, 0xcccc4f83,
+    0x34345c68, 0xa5a5f451, 0xe5e534d1, 0xf1f108f9, 0x717193e2, 0xd8d873ab, 0x31315362, 0x15153f2a,
+    0x04040c08, 0xc7c75295, 0x23236546, 0xc3c35e9d, 0x18182830, 0x9696a137, 0x05050f0a, 0x9a9ab52f,
+    0x0707090e, 0x12123624, 0x80809b1b, 0xe2e23ddf, 0xebeb26cd, 0x2727694e, 0xb2b2cd7f, 0x75759fea,
+    0x09091b12, 0x83839e1d, 0x2c2c7458, 0x1a1a2e34, 0x1b1b2d36, 0x6e6eb2dc, 0x5a5aeeb4, 0xa0a0fb5b,
+    0x5252f6a4, 0x3b3b4d76, 0xd6d661b7, 0xb3b3ce7d, 0x29297b52, 0xe3e33edd, 0x2f2f715e, 0x84849713,
+    0x5353f5a6, 0xd1d168b9, 0x00000000, 0xeded2cc1, 0x20206040, 0xfcfc1fe3, 0xb1b1c879, 0x5b5bedb6,
+    0x6a6abed4, 0xcbcb468d, 0xbebed967, 0x39394b72, 0x4a4ade94, 0x4c4cd498, 0x5858e8b0, 0xcfcf4a85,
+    0xd0d06bbb, 0xefef2ac5, 0xaaaae54f, 0xfbfb16ed, 0x4343c586, 0x4d4dd79a, 0x33335566, 0x85859411,
+    0x4545cf8a, 0xf9f910e9, 0x02020604, 0x7f7f81fe, 0x5050f0a0, 0x3c3c4478, 0x9f9fba25, 0xa8a8e34b,
+    0x5151f3a2, 0xa3a3fe5d, 0x4040c080, 0x8f8f8a05, 0x9292ad3f, 0x9d9dbc21, 0x38384870, 0xf5f504f1,
+    0xbcbcdf63, 0xb6b6c177, 0xdada75af, 0x21216342, 0x10103020, 0xffff1ae5, 0xf3f30efd, 0xd2d26dbf,
+    0xcdcd4c81, 0x0c0c1418, 0x13133526, 0xecec2fc3, 0x5f5fe1be, 0x9797a235, 0x4444cc88, 0x1717392e,
+    0xc4c45793, 0xa7a7f255, 0x7e7e82fc, 0x3d3d477a, 0x6464acc8, 0x5d5de7ba, 0x19192b32, 0x737395e6,
+    0x6060a0c0, 0x81819819, 0x4f4fd19e, 0xdcdc7fa3, 0x22226644, 0x2a2a7e54, 0x9090ab3b, 0x8888830b,
+    0x4646ca8c, 0xeeee29c7, 0xb8b8d36b, 0x14143c28, 0xdede79a7, 0x5e5ee2bc, 0x0b0b1d16, 0xdbdb76ad,
+    0xe0e03bdb, 0x32325664, 0x3a3a4e74, 0x0a0a1e14, 0x4949db92, 0x06060a0c, 0x24246c48, 0x5c5ce4b8,
+    0xc2c25d9f, 0xd3d36ebd, 0xacacef43, 0x6262a6c4, 0x9191a839, 0x9595a431, 0xe4e437d3, 0x79798bf2,
+    0xe7e732d5, 0xc8c8438b, 0x3737596e, 0x6d6db7da, 0x8d8d8c01, 0xd5d564b1, 0x4e4ed29c, 0xa9a9e049,
+    0x6c6cb4d8, 0x5656faac, 0xf4f407f3, 0xeaea25cf, 0x6565afca, 0x7a7a8ef4, 0xaeaee947, 0x08081810,
+    0xbabad56f, 0x787888f0, 0x25256f4a, 0x2e2e725c, 0x1c1c2438, 0xa6a6f157, 0xb4b4c773, 0xc6c65197,
+    0xe8e823cb, 0xdddd7ca1, 0x74749ce8, 0x1f1f213e, 0x4b4bdd96, 0xbdbddc61, 0x8b8b860d, 0x8a8a850f,
+    0x707090e0, 0x3e3e427c, 0xb5b5c471, 0x6666aacc, 0x4848d890, 0x03030506, 0xf6f601f7, 0x0e0e121c,
+    0x6161a3c2, 0x35355f6a, 0x5757f9ae, 0xb9b9d069, 0x86869117, 0xc1c15899, 0x1d1d273a, 0x9e9eb927,
+    0xe1e138d9, 0xf8f813eb, 0x9898b32b, 0x11113322, 0x6969bbd2, 0xd9d970a9, 0x8e8e8907, 0x9494a733,
+    0x9b9bb62d, 0x1e1e223c, 0x87879215, 0xe9e920c9, 0xcece4987, 0x5555ffaa, 0x28287850, 0xdfdf7aa5,
+    0x8c8c8f03, 0xa1a1f859, 0x89898009, 0x0d0d171a, 0xbfbfda65, 0xe6e631d7, 0x4242c684, 0x6868b8d0,
+    0x4141c382, 0x9999b029, 0x2d2d775a, 0x0f0f111e, 0xb0b0cb7b, 0x5454fca8, 0xbbbbd66d, 0x16163a2c
+};
+
+static const uint32_t Td0[256] = {
+    0x51f4a750, 0x7e416553, 0x1a17a4c3, 0x3a275e96, 0x3bab6bcb, 0x1f9d45f1, 0xacfa58ab, 0x4be30393,
+    0x2030fa55, 0xad766df6, 0x88cc7691, 0xf5024c25, 0x4fe5d7fc, 0xc52acbd7, 0x26354480, 0xb562a38f,
+    0xdeb15a49, 0x25ba1b67, 0x45ea0e98, 0x5dfec0e1, 0xc32f7502, 0x814cf012, 0x8d4697a3, 0x6bd3f9c6,
+    0x038f5fe7, 0x15929c95, 0xbf6d7aeb, 0x955259da, 0xd4be832d, 0x587421d3, 0x49e06929, 0x8ec9c844,
+    0x75c2896a, 0xf48e7978, 0x99583e6b, 0x27b971dd, 0xbee14fb6, 0xf088ad17, 0xc920ac66, 0x7dce3ab4,
+    0x63df4a18, 0xe51a3182, 0x97513360, 0x62537f45, 0xb16477e0, 0xbb6bae84, 0xfe81a01c, 0xf9082b94,
+    0x70486858, 0x8f45fd19, 0x94de6c87, 0x527bf8b7, 0xab73d323, 0x724b02e2, 0xe31f8f57, 0x6655ab2a,
+    0xb2eb2807, 0x2fb5c203, 0x86c57b9a, 0xd33708a5, 0x302887f2, 0x23bfa5b2, 0x02036aba, 0xed16825c,
+    0x8acf1c2b, 0xa779b492, 0xf307f2f0, 0x4e69e2a1, 0x65daf4cd, 0x0605bed5, 0xd134621f, 0xc4a6fe8a,
+    0x342e539d, 0xa2f355a0, 0x058ae132, 0xa4f6eb75, 0x0b83ec39, 0x4060efaa, 0x5e719f06, 0xbd6e1051,
+    0x3e218af9, 0x96dd063d, 0xdd3e05ae, 0x4de6bd46, 0x91548db5, 0x71c45d05, 0x0406d46f, 0x605015ff,
+    0x1998fb24, 0xd6bde997, 0x894043cc, 0x67d99e77, 0xb0e842bd, 0x07898b88, 0xe7195b38, 0x79c8eedb,
+    0xa17c0a47, 0x7c420fe9, 0xf8841ec9, 0x00000000, 0x09808683, 0x322bed48, 0x1e1170ac, 0x6c5a724e,
+    0xfd0efffb, 0x0f853856, 0x3daed51e, 0x362d3927, 0x0a0fd964, 0x685ca621, 0x9b5b54d1, 0x24362e3a,
+    0x0c0a67b1, 0x9357e70f, 0xb4ee96d2, 0x1b9b919e, 0x80c0c54f, 0x61dc20a2, 0x5a774b69, 0x1c121a16,
+    0xe293ba0a, 0xc0a02ae5, 0x3c22e043, 0x121b171d, 0x0e090d0b, 0xf28bc7ad, 0x2db6a8b9, 0x141ea9c8,
+    0x57f11985, 0xaf75074c, 0xee99ddbb, 0xa37f60fd, 0xf701269f, 0x5c72f5bc, 0x44663bc5, 0x5bfb7e34,
+    0x8b432976, 0xcb23c6dc, 0xb6edfc68, 0xb8e4f163, 0xd731dcca, 0x42638510, 0x13972240, 0x84c61120,
+    0x854a247d, 0xd2bb3df8, 0xaef93211, 0xc729a16d, 0x1d9e2f4b, 0xdcb230f3, 0x0d8652ec, 0x77c1e3d0,
+    0x2bb3166c, 0xa970b999, 0x119448fa, 0x47e96422, 0xa8fc8cc4, 0xa0f03f1a, 0x567d2cd8, 0x223390ef,
+    0x87494ec7, 0xd938d1c1, 0x8ccaa2fe, 0x98d40b36, 0xa6f581cf, 0xa57ade28, 0xdab78e26, 0x3fadbfa4,
+    0x2c3a9de4, 0x5078920d, 0x6a5fcc9b, 0x547e4662, 0xf68d13c2, 0x90d8b8e8, 0x2e39f75e, 0x82c3aff5,
+    0x9f5d80be, 0x69d0937c, 0x6fd52da9, 0xcf2512b3, 0xc8ac993b, 0x10187da7, 0xe89c636e, 0xdb3bbb7b,
+    0xcd267809, 0x6e5918f4, 0xec9ab701, 0x834f9aa8, 0xe6956e65, 0xaaffe67e, 0x21bccf08, 0xef15e8e6,
+    0xbae79bd9, 0x4a6f36ce, 0xea9f09d4, 0x29b07cd6, 0x31a4b2af, 0x2a3f2331, 0xc6a59430, 0x35a266c0,
+    0x744ebc37, 0xfc82caa6, 0xe090d0b0, 0x33a7d815, 0xf104984a, 0x41ecdaf7, 0x7fcd500e, 0x1791f62f,
+    0x764dd68d, 0x43efb04d, 0xccaa4d54, 0xe49604df, 0x9ed1b5e3, 0x4c6a881b, 0xc12c1fb8, 0x4665517f,
+    0x9d5eea04, 0x018c355d, 0xfa877473, 0xfb0b412e, 0xb3671d5a, 0x92dbd252, 0xe9105633, 0x6dd64713,
+    0x9ad7618c, 0x37a10c7a, 0x59f8148e, 0xeb133c89, 0xcea927ee, 0xb761c935, 0xe11ce5ed, 0x7a47b13c,
+    0x9cd2df59, 0x55f2733f, 0x1814ce79, 0x73c737bf, 0x53f7cdea, 0x5ffdaa5b, 0xdf3d6f14, 0x7844db86,
+    0xcaaff381, 0xb968c43e, 0x3824342c, 0xc2a3405f, 0x161dc372, 0xbce2250c, 0x283c498b, 0xff0d9541,
+    0x39a80171, 0x080cb3de, 0xd8b4e49c, 0x6456c190, 0x7bcb8461, 0xd532b670, 0x486c5c74, 0xd0b85742
+};
+
+static const uint32_t Td1[256] = {
+    0x5051f4a7, 0x537e4165, 0xc31a17a4, 0x963a275e, 0xcb3bab6b, 0xf11f9d45, 0xabacfa58, 0x934be303,
+    0x552030fa, 0xf6ad766d, 0x9188cc76, 0x25f5024c, 0xfc4fe5d7, 0xd7c52acb, 0x80263544, 0x8fb562a3,
+    0x49deb15a, 0x6725ba1b, 0x9845ea0e, 0xe15dfec0, 0x02c32f75, 0x12814cf0, 0xa38d4697, 0xc66bd3f9,
+    0xe7038f5f, 0x9515929c, 0xebbf6d7a, 0xda955259, 0x2dd4be83, 0xd3587421, 0x2949e069, 0x448ec9c8,
+    0x6a75c289, 0x78f48e79, 0x6b99583e, 0xdd27b971, 0xb6bee14f, 0x17f088ad, 0x66c920ac, 0xb47dce3a,
+    0x1863df4a, 0x82e51a31, 0x60975133, 0x4562537f, 0xe0b16477, 0x84bb6bae, 0x1cfe81a0, 0x94f9082b,
+    0x58704868, 0x198f45fd, 0x8794de6c, 0xb7527bf8, 0x23ab73d3, 0xe2724b02, 0x57e31f8f, 0x2a6655ab,
+    0x07b2eb28, 0x032fb5c2, 0x9a86c57b, 0xa5d33708, 0xf2302887, 0xb223bfa5, 0xba02036a, 0x5ced1682,
+    0x2b8acf1c, 0x92a779b4, 0xf0f307f2, 0xa14e69e2, 0xcd65daf4, 0xd50605be, 0x1fd13462, 0x8ac4a6fe,
+    0x9d342e53, 0xa0a2f355, 0x32058ae1, 0x75a4f6eb, 0x390b83ec, 0xaa4060ef, 0x065e719f, 0x51bd6e10,
+    0xf93e218a, 0x3d96dd06, 0xaedd3e05, 0x464de6bd, 0xb591548d, 0x0571c45d, 0x6f0406d4, 0xff605015,
+    0x241998fb, 0x97d6bde9, 0xcc894043, 0x7767d99e, 0xbdb0e842, 0x8807898b, 0x38e7195b, 0xdb79c8ee,
+    0x47a17c0a, 0xe97c420f, 0xc9f8841e, 0x00000000, 0x83098086, 0x48322bed, 0xac1e1170, 0x4e6c5a72,
+    0xfbfd0eff, 0x560f8538, 0x1e3daed5, 0x27362d39, 0x640a0fd9, 0x21685ca6, 0xd19b5b54, 0x3a24362e,
+    0xb10c0a67, 0x0f9357e7, 0xd2b4ee96, 0x9e1b9b91, 0x4f80c0c5, 0xa261dc20, 0x695a774b, 0x161c121a,
+    0x0ae293ba, 0xe5c0a02a, 0x433c22e0, 0x1d121b17, 0x0b0e090d, 0xadf28bc7, 0xb92db6a8, 0xc8141ea9,
+    0x8557f119, 0x4caf7507, 0xbbee99dd, 0xfda37f60, 0x9ff70126, 0xbc5c72f5, 0xc544663b, 0x345bfb7e,
+    0x768b4329, 0xdccb23c6, 0x68b6edfc, 0x63b8e4f1, 0xcad731dc, 0x10426385, 0x40139722, 0x2084c611,
+    0x7d854a24, 0xf8d2bb3d, 0x11aef932, 0x6dc729a1, 0x4b1d9e2f, 0xf3dcb230, 0xec0d8652, 0xd077c1e3,
+    0x6c2bb316, 0x99a970b9, 0xfa119448, 0x2247e964, 0xc4a8fc8c, 0x1aa0f03f, 0xd8567d2c, 0xef223390,
+    0xc787494e, 0xc1d938d1, 0xfe8ccaa2, 0x3698d40b, 0xcfa6f581, 0x28a57ade, 0x26dab78e, 0xa43fadbf,
+    0xe42c3a9d, 0x0d507892, 0x9b6a5fcc, 0x62547e46, 0xc2f68d13, 0xe890d8b8, 0x5e2e39f7, 0xf582c3af,
+    0xbe9f5d80, 0x7c69d093, 0xa96fd52d, 0xb3cf2512, 0x3bc8ac99, 0xa710187d, 0x6ee89c63, 0x7bdb3bbb,
+    0x09cd2678, 0xf46e5918, 0x01ec9ab7, 0xa8834f9a, 0x65e6956e, 0x7eaaffe6, 0x0821bccf, 0xe6ef15e8,
+    0xd9bae79b, 0xce4a6f36, 0xd4ea9f09, 0xd629b07c, 0xaf31a4b2, 0x312a3f23, 0x30c6a594, 0xc035a266,
+    0x37744ebc, 0xa6fc82ca, 0xb0e090d0, 0x1533a7d8, 0x4af10498, 0xf741ecda, 0x0e7fcd50, 0x2f1791f6,
+    0x8d764dd6, 0x4d43efb0, 0x54ccaa4d, 0xdfe49604, 0xe39ed1b5, 0x1b4c6a88, 0xb8c12c1f, 0x7f466551,
+    0x049d5eea, 0x5d018c35, 0x73fa8774, 0x2efb0b41, 0x5ab3671d, 0x5292dbd2, 0x33e91056, 0x136dd647,
+    0x8c9ad761, 0x7a37a10c, 0x8e59f814, 0x89eb133c, 0xeecea927, 0x35b761c9, 0xede11ce5, 0x3c7a47b1,
+    0x599cd2df, 0x3f55f273, 0x791814ce, 0xbf73c737, 0xea53f7cd, 0x5b5ffdaa, 0x14df3d6f, 0x867844db,
+    0x81caaff3, 0x3eb968c4, 0x2c382434, 0x5fc2a340, 0x72161dc3, 0x0cbce225, 0x8b283c49, 0x41ff0d95,
+    0x7139a801, 0xde080cb3, 0x9cd8b4e4, 0x906456c1, 0x617bcb84, 0x70d532b6, 0x74486c5c, 0x42d0b857
+};
+
+static const uint32_t Td2[256] = {
+    0xa75051f4, 0x65537e41, 0xa4c31a17, 0x5e963a27, 0x6bcb3bab, 0x45f11f9d, 0x58abacfa, 0x03934be3,
+    0xfa552030, 0x6df6ad76, 0x769188cc, 0x4c25f502, 0xd7fc4fe5, 0xcbd7c52a, 0x44802635, 0xa38fb562,
+    0x5a49deb1, 0x1b6725ba, 0x0e9845ea, 0xc0e15dfe, 0x7502c32f, 0xf012814c, 0x97a38d46, 0xf9c66bd3,
+    0x5fe7038f, 0x9c951592, 0x7aebbf6d, 0x59da9552, 0x832dd4be, 0x21d35874, 0x692949e0, 0xc8448ec9,
+    0x896a75c2, 0x7978f48e, 0x3e6b9958, 0x71dd27b9, 0x4fb6bee1, 0xad17f088, 0xac66c920, 0x3ab47dce,
+    0x4a1863df, 0x3182e51a, 0x33609751, 0x7f456253, 0x77e0b164, 0xae84bb6b, 0xa01cfe81, 0x2b94f908,
+    0x68587048, 0xfd198f45, 0x6c8794de, 0xf8b7527b, 0xd323ab73, 0x02e2724b, 0x8f57e31f, 0xab2a6655,
+    0x2807b2eb, 0xc2032fb5, 0x7b9a86c5, 0x08a5d337, 0x87f23028, 0xa5b223bf, 0x6aba0203, 0x825ced16,
+    0x1c2b8acf, 0xb492a779, 0xf2f0f307, 0xe2a14e69, 0xf4cd65da, 0xbed50605, 0x621fd134, 0xfe8ac4a6,
+    0x539d342e, 0x55a0a2f3, 0xe132058a, 0xeb75a4f6, 0xec390b83, 0xefaa4060, 0x9f065e71, 0x1051bd6e,
+    0x8af93e21, 0x063d96dd, 0x05aedd3e, 0xbd464de6, 0x8db59154, 0x5d0571c4, 0xd46f0406, 0x15ff6050,
+    0xfb241998, 0xe997d6bd, 0x43cc8940, 0x9e7767d9, 0x42bdb0e8, 0x8b880789, 0x5b38e719, 0xeedb79c8,
+    0x0a47a17c, 0x0fe97c42, 0x1ec9f884, 0x00000000, 0x86830980, 0xed48322b, 0x70ac1e11, 0x724e6c5a,
+    0xfffbfd0e, 0x38560f85, 0xd51e3dae, 0x3927362d, 0xd9640a0f, 0xa621685c, 0x54d19b5b, 0x2e3a2436,
+    0x67b10c0a, 0xe70f9357, 0x96d2b4ee, 0x919e1b9b, 0xc54f80c0, 0x20a261dc, 0x4b695a77, 0x1a161c12,
+    0xba0ae293, 0x2ae5c0a0, 0xe0433c22, 0x171d121b, 0x0d0b0e09, 0xc7adf28b, 0xa8b92db6, 0xa9c8141e,
+    0x198557f1, 0x074caf75, 0xddbbee99, 0x60fda37f, 0x269ff701, 0xf5bc5c72, 0x3bc54466, 0x7e345bfb,
+    0x29768b43, 0xc6dccb23, 0xfc68b6ed, 0xf163b8e4, 0xdccad731, 0x85104263, 0x22401397, 0x112084c6,
+    0x247d854a, 0x3df8d2bb, 0x3211aef9, 0xa16dc729, 0x2f4b1d9e, 0x30f3dcb2, 0x52ec0d86, 0xe3d077c1,
+    0x166c2bb3, 0xb999a970, 0x48fa1194, 0x642247e9, 0x8cc4a8fc, 0x3f1aa0f0, 0x2cd8567d, 0x90ef2233,
+    0x4ec78749, 0xd1c1d938, 0xa2fe8cca, 0x0b3698d4, 0x81cfa6f5, 0xde28a57a, 0x8e26dab7, 0xbfa43fad,
+    0x9de42c3a, 0x920d5078, 0xcc9b6a5f, 0x4662547e, 0x13c2f68d, 0xb8e890d8, 0xf75e2e39, 0xaff582c3,
+    0x80be9f5d, 0x937c69d0, 0x2da96fd5, 0x12b3cf25, 0x993bc8ac, 0x7da71018, 0x636ee89c, 0xbb7bdb3b,
+    0x7809cd26, 0x18f46e59, 0xb701ec9a, 0x9aa8834f, 0x6e65e695, 0xe67eaaff, 0xcf0821bc, 0xe8e6ef15,
+    0x9bd9bae7, 0x36ce4a6f, 0x09d4ea9f, 0x7cd629b0, 0xb2af31a4, 0x23312a3f, 0x9430c6a5, 0x66c035a2,
+    0xbc37744e, 0xcaa6fc82, 0xd0b0e090, 0xd81533a7, 0x984af104, 0xdaf741ec, 0x500e7fcd, 0xf62f1791,
+    0xd68d764d, 0xb04d43ef, 0x4d54ccaa, 0x04dfe496, 0xb5e39ed1, 0x881b4c6a, 0x1fb8c12c, 0x517f4665,
+    0xea049d5e, 0x355d018c, 0x7473fa87, 0x412efb0b, 0x1d5ab367, 0xd25292db, 0x5633e910, 0x47136dd6,
+    0x618c9ad7, 0x0c7a37a1, 0x148e59f8, 0x3c89eb13, 0x27eecea9, 0xc935b761, 0xe5ede11c, 0xb13c7a47,
+    0xdf599cd2, 0x733f55f2, 0xce791814, 0x37bf73c7, 0xcdea53f7, 0xaa5b5ffd, 0x6f14df3d, 0xdb867844,
+    0xf381caaf, 0xc43eb968, 0x342c3824, 0x405fc2a3, 0xc372161d, 0x250cbce2, 0x498b283c, 0x9541ff0d,
+    0x017139a8, 0xb3de080c, 0xe49cd8b4, 0xc1906456, 0x84617bcb, 0xb670d532, 0x5c74486c, 0x5742d0b8
+};
+
+static const uint32_t Td3[256] = {
+    0xf4a75051, 0x4165537e, 0x17a4c31a, 0x275e963a, 0xab6bcb3b, 0x9d45f11f, 0xfa58abac, 0xe303934b,
+    0x30fa5520, 0x766df6ad, 0xcc769188, 0x024c25f5, 0xe5d7fc4f, 0x2acbd7c5, 0x35448026, 0x62a38fb5,
+    0xb15a49de, 0xba1b6725, 0xea0e9845, 0xfec0e15d, 0x2f7502c3, 0x4cf01281, 0x4697a38d, 0xd3f9c66b,
+    0x8f5fe703, 0x929c9515, 0x6d7aebbf, 0x5259da95, 0xbe832dd4, 0x7421d358, 0xe0692949, 0xc9c8448e,
+    0xc2896a75, 0x8e7978f4, 0x583e6b99, 0xb971dd27, 0xe14fb6be, 0x88ad17f0, 0x20ac66c9, 0xce3ab47d,
+    0xdf4a1863, 0x1a3182e5, 0x51336097, 0x537f4562, 0x6477e0b1, 0x6bae84bb, 0x81a01cfe, 0x082b94f9,
+    0x48685870, 0x45fd198f, 0xde6c8794, 0x7bf8b752, 0x73d323ab, 0x4b02e272, 0x1f8f57e3, 0x55ab2a66,
+    0xeb2807b2, 0xb5c2032f, 0xc57b9a86, 0x3708a5d3, 0x2887f230, 0xbfa5b223, 0x036aba02, 0x16825ced,
+    0xcf1c2b8a, 0x79b492a7, 0x07f2f0f3, 0x69e2a14e, 0xdaf4cd65, 0x05bed506, 0x34621fd1, 0xa6fe8ac4,
+    0x2e539d34, 0xf355a0a2, 0x8ae13205, 0xf6eb75a4, 0x83ec390b, 0x60efaa40, 0x719f065e, 0x6e1051bd,
+    0x218af93e, 0xdd063d96, 0x3e05aedd, 0xe6bd464d, 0x548db591, 0xc45d0571, 0x06d46f04, 0x5015ff60,
+    0x98fb2419, 0xbde997d6, 0x4043cc89, 0xd99e7767, 0xe842bdb0, 0x898b8807, 0x195b38e7, 0xc8eedb79,
+    0x7c0a47a1, 0x420fe97c, 0x841ec9f8, 0x00000000, 0x80868309, 0x2bed4832, 0x1170ac1e, 0x5a724e6c,
+    0x0efffbfd, 0x8538560f, 0xaed51e3d, 0x2d392736, 0x0fd9640a, 0x5ca62168, 0x5b54d19b, 0x362e3a24,
+    0x0a67b10c, 0x57e70f93, 0xee96d2b4, 0x9b919e1b, 0xc0c54f80, 0xdc20a261, 0x774b695a, 0x121a161c,
+    0x93ba0ae2, 0xa02ae5c0, 0x22e0433c, 0x1b171d12, 0x090d0b0e, 0x8bc7adf2, 0xb6a8b92d, 0x1ea9c814,
+    0xf1198557, 0x75074caf, 0x99ddbbee, 0x7f60fda3, 0x01269ff7, 0x72f5bc5c, 0x663bc544, 0xfb7e345b,
+    0x4329768b, 0x23c6dccb, 0xedfc68b6, 0xe4f163b8, 0x31dccad7, 0x63851042, 0x97224013, 0xc6112084,
+    0x4a247d85, 0xbb3df8d2, 0xf93211ae, 0x29a16dc7, 0x9e2f4b1d, 0xb230f3dc, 0x8652ec0d, 0xc1e3d077,
+    0xb3166c2b, 0x70b999a9, 0x9448fa11, 0xe9642247, 0xfc8cc4a8, 0xf03f1aa0, 0x7d2cd856, 0x3390ef22,
+    0x494ec787, 0x38d1c1d9, 0xcaa2fe8c, 0xd40b3698, 0xf581cfa6, 0x7ade28a5, 0xb78e26da, 0xadbfa43f,
+    0x3a9de42c, 0x78920d50, 0x5fcc9b6a, 0x7e466254, 0x8d13c2f6, 0xd8b8e890, 0x39f75e2e, 0xc3aff582,
+    0x5d80be9f, 0xd0937c69, 0xd52da96f, 0x2512b3cf, 0xac993bc8, 0x187da710, 0x9c636ee8, 0x3bbb7bdb,
+    0x267809cd, 0x5918f46e, 0x9ab701ec, 0x4f9aa883, 0x956e65e6, 0xffe67eaa, 0xbccf0821, 0x15e8e6ef,
+    0xe79bd9ba, 0x6f36ce4a, 0x9f09d4ea, 0xb07cd629, 0xa4b2af31, 0x3f23312a, 0xa59430c6, 0xa266c035,
+    0x4ebc3774, 0x82caa6fc, 0x90d0b0e0, 0xa7d81533, 0x04984af1, 0xecdaf741, 0xcd500e7f, 0x91f62f17,
+    0x4dd68d76, 0xefb04d43, 0xaa4d54cc, 0x9604dfe4, 0xd1b5e39e, 0x6a881b4c, 0x2c1fb8c1, 0x65517f46,
+    0x5eea049d, 0x8c355d01, 0x877473fa, 0x0b412efb, 0x671d5ab3, 0xdbd25292, 0x105633e9, 0xd647136d,
+    0xd7618c9a, 0xa10c7a37, 0xf8148e59, 0x133c89eb, 0xa927eece, 0x61c935b7, 0x1ce5ede1, 0x47b13c7a,
+    0xd2df599c, 0xf2733f55, 0x14ce7918, 0xc737bf73, 0xf7cdea53, 0xfdaa5b5f, 0x3d6f14df, 0x44db8678,
+    0xaff381ca, 0x68c43eb9, 0x24342c38, 0xa3405fc2, 0x1dc37216, 0xe2250cbc, 0x3c498b28, 0x0d9541ff,
+    0xa8017139, 0x0cb3de08, 0xb4e49cd8, 0x56c19064, 0xcb84617b, 0x32b670d5, 0x6c5c7448, 0xb85742d0
+};
+
+
 static uint8_t S_box_8(uint8_t data, int *sbox)
 {
     int row = (data & 0xF0) >> 4;
@@ -96,49 +386,83 @@ static void S_box(AES_Block_Struct *block, int *sbox)
 }
 
 
-static void read_block(FILE *file, AES_Block_Struct *block)
+/*
+    Big-endian 32-bits word at any address of a caller buffer: memcpy and __builtin_bswap32 are inlined
+    (one MOVBE, or a load and a BSWAP), unlike the out-of-line switch_endianness_32() of helpers.c.
+*/
+static inline uint32_t AES_Load_32(const uint8_t *data)
 {
-    fread(&block->w0, sizeof(uint32_t), 1, file);
-    fread(&block->w1, sizeof(uint32_t), 1, file);
-    fread(&block->w2, sizeof(uint32_t), 1, file);
-    fread(&block->w3, sizeof(uint32_t), 1, file);
-
-    block->w0 = switch_endianness_32(block->w0);
-    block->w1 = switch_endianness_32(block->w1);
-    block->w2 = switch_endianness_32(block->w2);
-    block->w3 = switch_endianness_32(block->w3);
+    uint32_t word;
+    memcpy(&word, data, sizeof(uint32_t));
+    return __builtin_bswap32(word);
 }
 
 
-static void write_block(FILE *file, AES_Block_Struct *block)
+static inline void AES_Store_32(uint8_t *data, uint32_t word)
 {
-    uint32_t data;
+    word = __builtin_bswap32(word);
+    memcpy(data, &word, sizeof(uint32_t));
+}
 
-    data = switch_endianness_32(block->w0);
-    fwrite(&data, sizeof(uint32_t), 1, file);
 
-    data = switch_endianness_32(block->w1);
-    fwrite(&data, sizeof(uint32_t), 1, file);
+/*
+    Convert "count" consecutive 16-bytes blocks of a data buffer from/to the AES matrix form
+    (each column is stored in big-endian format in the buffer).
+*/
+void AES_Load_Blocks(const uint8_t *data, AES_Block_Struct *blocks, size_t count)
+{
+    for(size_t i = 0; i < count; i++){
+        blocks[i].w0 = AES_Load_32(&data[16*i + 0]);
+        blocks[i].w1 = AES_Load_32(&data[16*i + 4]);
+        blocks[i].w2 = AES_Load_32(&data[16*i + 8]);
+        blocks[i].w3 = AES_Load_32(&data[16*i + 12]);
+    }
+}
 
-    data = switch_endianness_32(block->w2);
-    fwrite(&data, sizeof(uint32_t), 1, file);
 
-    data = switch_endianness_32(block->w3);
-    fwrite(&data, sizeof(uint32_t), 1, file);
+void AES_Store_Blocks(const AES_Block_Struct *blocks, uint8_t *data, size_t count)
+{
+    for(size_t i = 0; i < count; i++){
+        AES_Store_32(&data[16*i + 0], blocks[i].w0);
+        AES_Store_32(&data[16*i + 4], blocks[i].w1);
+        AES_Store_32(&data[16*i + 8], blocks[i].w2);
+        AES_Store_32(&data[16*i + 12], blocks[i].w3);
+    }
 }
 
 
 
-static void generate_subkey(AES_Block_Struct *input_subkey, AES_Block_Struct *output_subkey, int rcon_index)
+/*
+    Key expansion (FIPS-197, section 5.2) for a key of "key_words" (4, 6 or 8) columns, giving the
+    key_words + 6 sub-keys that follow the initial round key.
+    The S-box is applied through "sub_word" so that each backend can provide its own implementation.
+*/
+void AES_Expand_Key(const uint32_t *key, int key_words, AES_SUB_WORD_T sub_word, AES_Block_Struct *sub_keys)
 {
-    output_subkey->w0 = left_circular_shift_32(input_subkey->w3, 8);
-    output_subkey->w0 = S_box_32(output_subkey->w0, Forward_S_Box);
-    output_subkey->w0 ^= input_subkey->w0;
-    output_subkey->w0 ^= ((uint32_t)rcon_table[rcon_index] << 24);
+    int rounds = key_words + 6;
+    uint32_t w[4 * (AES_MAX_ROUNDS+1)];
+
+    for(int i = 0; i < key_words; i++){
+        w[i] = key[i];
+    }
 
-    output_subkey->w1 = output_subkey->w0 ^ input_subkey->w1;
-    output_subkey->w2 = output_subkey->w1 ^ input_subkey->w2;
-    output_subkey->w3 = output_subkey->w2 ^ input_subkey->w3;
+    for(int i = key_words; i < 4 * (rounds+1); i++){
+        uint32_t temp = w[i-1];
+
+        if(i % key_words == 0)
+            temp = sub_word(left_circular_shift_32(temp, 8)) ^ ((uint32_t)rcon_table[i / key_words] << 24);
+        else if(  (key_words > 6) && (i % key_words == 4)  )
+            temp = sub_word(temp);
+
+        w[i] = w[i - key_words] ^ temp;
+    }
+
+    for(int i = 0; i < rounds; i++){
+        sub_keys[i].w0 = w[4*(i+1) + 0];
+        sub_keys[i].w1 = w[4*(i+1) + 1];
+        sub_keys[i].w2 = w[4*(i+1) + 2];
+        sub_keys[i].w3 = w[4*(i+1) + 3];
+    }
 }
 
 
@@ -361,7 +685,7 @@ static void InvMixColumns(AES_Block_Struct *block)
     block->w3 = InvMixSingleColumn(block->w3);
 }
 
-static void Round(AES_Block_Struct *block, AES_Block_Struct *sub_key, int useMixColumns)
+static void Round(AES_Block_Struct *block, const AES_Block_Struct *sub_key, int useMixColumns)
 {
     SubBytes(block);
     ShiftRows(block);
@@ -376,21 +700,25 @@ static void Round(AES_Block_Struct *block, AES_Block_Struct *sub_key, int useMix
 }
 
 
-static void InvRound(AES_Block_Struct *block, AES_Block_Struct *sub_key, int useMixColumns)
+/*
+    Equivalent inverse cipher round: InvMixColumns comes before the round key addition, the inner round keys
+    having been InvMixColumns'd beforehand (see generate_decryption_subkeys()).
+*/
+static void InvRound(AES_Block_Struct *block, const AES_Block_Struct *sub_key, int useMixColumns)
 {
     InvShiftRows(block);
     InvSubBytes(block);
 
+    if(useMixColumns == AES_ROUND_USE_MIXCOLUMNS)
+        InvMixColumns(block);
+
     block->w0 ^= sub_key->w0;
     block->w1 ^= sub_key->w1;
     block->w2 ^= sub_key->w2;
     block->w3 ^= sub_key->w3;
-
-    if(useMixColumns == AES_ROUND_USE_MIXCOLUMNS)
-        InvMixColumns(block);
 }
 
-static void EncryptBlock(AES_Block_Struct *block, AES_Block_Struct *private_key, AES_Block_Struct *sub_keys)
+static void EncryptBlock_Reference(AES_Block_Struct *block, const AES_Block_Struct *private_key, const AES_Block_Struct *sub_keys, int rounds)
 {
     /* initial round key addition */
     block->w0 ^= private_key->w0;
@@ -399,31 +727,479 @@ static void EncryptBlock(AES_Block_Struct *block, AES_Block_Struct *private_key,
     block->w3 ^= private_key->w3;
 
     /* rounds */
-    for(int i = 0; i < 9; i++){
+    for(int i = 0; i < rounds-1; i++){
         Round(block, &(sub_keys[i]), AES_ROUND_USE_MIXCOLUMNS);
     }
-    Round(block, &(sub_keys[9]), AES_ROUND_NO_MIXCOLUMNS);
+    Round(block, &(sub_keys[rounds-1]), AES_ROUND_NO_MIXCOLUMNS);
 }
 
 
-static void DecryptBlock(AES_Block_Struct *block, AES_Block_Struct *private_key, AES_Block_Struct *sub_keys)
+/*
+    sub_keys must come from generate_decryption_subkeys().
+*/
+static void DecryptBlock_Reference(AES_Block_Struct *block, const AES_Block_Struct *private_key, const AES_Block_Struct *sub_keys, int rounds)
 {
     /* initial round key addition */
-    block->w0 ^= sub_keys[9].w0;
-    block->w1 ^= sub_keys[9].w1;
-    block->w2 ^= sub_keys[9].w2;
-    block->w3 ^= sub_keys[9].w3;
+    block->w0 ^= sub_keys[rounds-1].w0;
+    block->w1 ^= sub_keys[rounds-1].w1;
+    block->w2 ^= sub_keys[rounds-1].w2;
+    block->w3 ^= sub_keys[rounds-1].w3;
 
     /* rounds */
-    for(int i = 0; i < 9; i++){
-        InvRound(block, &(sub_keys[9-1-i]), AES_ROUND_USE_MIXCOLUMNS);
+    for(int i = rounds-2; i >= 0; i--){
+        InvRound(block, &(sub_keys[i]), AES_ROUND_USE_MIXCOLUMNS);
     }
     InvRound(block, private_key, AES_ROUND_NO_MIXCOLUMNS);
 }
 
 
+/*
+    T-table round: SubBytes + ShiftRows + MixColumns + AddRoundKey with 4 table lookups per column.
+    The ShiftRows offsets are applied when picking the source column of each byte.
+*/
+#define AES_BYTE0(w)        ((uint8_t)((w) >> 24))
+#define AES_BYTE1(w)        ((uint8_t)((w) >> 16))
+#define AES_BYTE2(w)        ((uint8_t)((w) >> 8))
+#define AES_BYTE3(w)        ((uint8_t)(w))
 
-int AES128_encryption(const char* const plain_file_name, uint64_t key_msb, uint64_t key_lsb, const char* const encrypted_file_name)
+static void Round_TTable(AES_Block_Struct *block, const AES_Block_Struct *sub_key)
+{
+    uint32_t w0 = block->w0, w1 = block->w1, w2 = block->w2, w3 = block->w3;
+
+    block->w0 = Te0[AES_BYTE0(w0)] ^ Te1[AES_BYTE1(w1)] ^ Te2[AES_BYTE2(w2)] ^ Te3[AES_BYTE3(w3)] ^ sub_key->w0;
+    block->w1 = Te0[AES_BYTE0(w1)] ^ Te1[AES_BYTE1(w2)] ^ Te2[AES_BYTE2(w3)] ^ Te3[AES_BYTE3(w0)] ^ sub_key->w1;
+    block->w2 = Te0[AES_BYTE0(w2)] ^ Te1[AES_BYTE1(w3)] ^ Te2[AES_BYTE2(w0)] ^ Te3[AES_BYTE3(w1)] ^ sub_key->w2;
+    block->w3 = Te0[AES_BYTE0(w3)] ^ Te1[AES_BYTE1(w0)] ^ Te2[AES_BYTE2(w1)] ^ Te3[AES_BYTE3(w2)] ^ sub_key->w3;
+}
+
+/* last round: no MixColumns, plain S-box bytes */
+static uint32_t LastRoundColumn(uint32_t a, uint32_t b, uint32_t c, uint32_t d, const int *sbox)
+{
+    return ((uint32_t)sbox[AES_BYTE0(a)] << 24) | ((uint32_t)sbox[AES_BYTE1(b)] << 16) | ((uint32_t)sbox[AES_BYTE2(c)] << 8) | (uint32_t)sbox[AES_BYTE3(d)];
+}
+
+static void LastRound_TTable(AES_Block_Struct *block, const AES_Block_Struct *sub_key)
+{
+    uint32_t w0 = block->w0, w1 = block->w1, w2 = block->w2, w3 = block->w3;
+
+    block->w0 = LastRoundColumn(w0, w1, w2, w3, Forward_S_Box) ^ sub_key->w0;
+    block->w1 = LastRoundColumn(w1, w2, w3, w0, Forward_S_Box) ^ sub_key->w1;
+    block->w2 = LastRoundColumn(w2, w3, w0, w1, Forward_S_Box) ^ sub_key->w2;
+    block->w3 = LastRoundColumn(w3, w0, w1, w2, Forward_S_Box) ^ sub_key->w3;
+}
+
+/*
+    Inverse T-table round (equivalent inverse cipher): the round key must already be InvMixColumns'd,
+    see generate_decryption_subkeys().
+*/
+static void InvRound_TTable(AES_Block_Struct *block, const AES_Block_Struct *sub_key)
+{
+    uint32_t w0 = block->w0, w1 = block->w1, w2 = block->w2, w3 = block->w3;
+
+    block->w0 = Td0[AES_BYTE0(w0)] ^ Td1[AES_BYTE1(w3)] ^ Td2[AES_BYTE2(w2)] ^ Td3[AES_BYTE3(w1)] ^ sub_key->w0;
+    block->w1 = Td0[AES_BYTE0(w1)] ^ Td1[AES_BYTE1(w0)] ^ Td2[AES_BYTE2(w3)] ^ Td3[AES_BYTE3(w2)] ^ sub_key->w1;
+    block->w2 = Td0[AES_BYTE0(w2)] ^ Td1[AES_BYTE1(w1)] ^ Td2[AES_BYTE2(w0)] ^ Td3[AES_BYTE3(w3)] ^ sub_key->w2;
+    block->w3 = Td0[AES_BYTE0(w3)] ^ Td1[AES_BYTE1(w2)] ^ Td2[AES_BYTE2(w1)] ^ Td3[AES_BYTE3(w0)] ^ sub_key->w3;
+}
+
+static void InvLastRound_TTable(AES_Block_Struct *block, const AES_Block_Struct *sub_key)
+{
+    uint32_t w0 = block->w0, w1 = block->w1, w2 = block->w2, w3 = block->w3;
+
+    block->w0 = LastRoundColumn(w0, w3, w2, w1, Inv_S_Box) ^ sub_key->w0;
+    block->w1 = LastRoundColumn(w1, w0, w3, w2, Inv_S_Box) ^ sub_key->w1;
+    block->w2 = LastRoundColumn(w2, w1, w0, w3, Inv_S_Box) ^ sub_key->w2;
+    block->w3 = LastRoundColumn(w3, w2, w1, w0, Inv_S_Box) ^ sub_key->w3;
+}
+
+/*
+    "rounds" is a compile-time constant at each call site (see AES_ROUNDS_SWITCH), the round loop is fully unrolled.
+*/
+static AES_ALWAYS_INLINE void EncryptBlock_TTable(AES_Block_Struct *block, const AES_Block_Struct *private_key, const AES_Block_Struct *sub_keys, int rounds)
+{
+    /* initial round key addition */
+    block->w0 ^= private_key->w0;
+    block->w1 ^= private_key->w1;
+    block->w2 ^= private_key->w2;
+    block->w3 ^= private_key->w3;
+
+    /* rounds */
+    #pragma GCC unroll 13
+    for(int i = 0; i < rounds-1; i++){
+        Round_TTable(block, &(sub_keys[i]));
+    }
+    LastRound_TTable(block, &(sub_keys[rounds-1]));
+}
+
+/*
+    sub_keys must come from generate_decryption_subkeys().
+*/
+static AES_ALWAYS_INLINE void DecryptBlock_TTable(AES_Block_Struct *block, const AES_Block_Struct *private_key, const AES_Block_Struct *sub_keys, int rounds)
+{
+    /* initial round key addition */
+    block->w0 ^= sub_keys[rounds-1].w0;
+    block->w1 ^= sub_keys[rounds-1].w1;
+    block->w2 ^= sub_keys[rounds-1].w2;
+    block->w3 ^= sub_keys[rounds-1].w3;
+
+    /* rounds */
+    #pragma GCC unroll 13
+    for(int i = rounds-2; i >= 0; i--){
+        InvRound_TTable(block, &(sub_keys[i]));
+    }
+    InvLastRound_TTable(block, private_key);
+}
+
+
+/*
+    Sub-keys used by DecryptBlock().
+    Both software engines run the equivalent inverse cipher, so InvMixColumns is applied once here
+    to the sub-keys of the inner rounds instead of on every block.
+*/
+static void generate_decryption_subkeys(const AES_Block_Struct *sub_keys, int rounds, AES_Block_Struct *decryption_sub_keys)
+{
+    for(int i = 0; i < rounds; i++){
+        decryption_sub_keys[i] = sub_keys[i];
+
+        if(i < rounds-1)
+            InvMixColumns(&decryption_sub_keys[i]);
+    }
+}
+
+
+static AES_ALWAYS_INLINE void EncryptBlock(AES_Block_Struct *block, const AES_Block_Struct *private_key, const AES_Block_Struct *sub_keys, int rounds)
+{
+    if(AES_ENGINE == AES_ENGINE_TTABLE)
+        EncryptBlock_TTable(block, private_key, sub_keys, rounds);
+    else
+        EncryptBlock_Reference(block, private_key, sub_keys, rounds);
+}
+
+static AES_ALWAYS_INLINE void DecryptBlock(AES_Block_Struct *block, const AES_Block_Struct *private_key, const AES_Block_Struct *decryption_sub_keys, int rounds)
+{
+    if(AES_ENGINE == AES_ENGINE_TTABLE)
+        DecryptBlock_TTable(block, private_key, decryption_sub_keys, rounds);
+    else
+        DecryptBlock_Reference(block, private_key, decryption_sub_keys, rounds);
+}
+
+
+
+/*
+    Software backend (portable C, always available).
+*/
+static int Software_Is_Supported(void)
+{
+    return 1;
+}
+
+static uint32_t SubWord(uint32_t word)
+{
+    return S_box_32(word, Forward_S_Box);
+}
+
+static void Software_Expand_Key(const uint32_t *key, int key_words, AES_Block_Struct *sub_keys)
+{
+    AES_Expand_Key(key, key_words, SubWord, sub_keys);
+}
+
+static AES_ALWAYS_INLINE void encrypt_blocks_n(int rounds, AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context)
+{
+    for(size_t i = 0; i < count; i++){
+        EncryptBlock(&blocks[i], &context->private_key, context->sub_keys, rounds);
+    }
+}
+
+static AES_ALWAYS_INLINE void decrypt_blocks_n(int rounds, AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context)
+{
+    for(size_t i = 0; i < count; i++){
+        DecryptBlock(&blocks[i], &context->private_key, context->decryption_sub_keys, rounds);
+    }
+}
+
+static void Software_Encrypt_Blocks(AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context)
+{
+    AES_ROUNDS_SWITCH(context->rounds, encrypt_blocks_n, blocks, count, context);
+}
+
+static void Software_Decrypt_Blocks(AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context)
+{
+    AES_ROUNDS_SWITCH(context->rounds, decrypt_blocks_n, blocks, count, context);
+}
+
+static const AES_BACKEND_T AES_Backend_Software = {
+    .name = (AES_ENGINE == AES_ENGINE_TTABLE) ? "software (T-tables)" : "software (reference)",
+    .is_supported = Software_Is_Supported,
+    .expand_key = Software_Expand_Key,
+    .decryption_subkeys = generate_decryption_subkeys,
+    .encrypt_blocks = Software_Encrypt_Blocks,
+    .decrypt_blocks = Software_Decrypt_Blocks
+};
+
+
+
+/*
+    Backend selection.
+    The backend is chosen once (on the first AES call, from the CPUID feature flags) unless
+    AES_Set_Backend() is called explicitly.
+*/
+static const AES_BACKEND_T *aes_backend = NULL;
+
+static const AES_BACKEND_T* get_backend_by_id(AES_BACKEND_ID_T backend_id)
+{
+    switch(backend_id)
+    {
+        case AES_BACKEND_SOFTWARE: return &AES_Backend_Software;
+#if AES_X86_BACKENDS
+        case AES_BACKEND_AESNI: return &AES_Backend_AESNI;
+        case AES_BACKEND_BITSLICE: return &AES_Backend_Bitslice;
+        case AES_BACKEND_VPAES: return &AES_Backend_VPAES;
+#endif
+        default: return NULL;
+    }
+}
+
+
+/*
+    Select the backend used by all the AES functions.
+
+    Return EXIT_FAILURE if the backend is not supported by this CPU (the current backend is kept).
+*/
+int AES_Set_Backend(AES_BACKEND_ID_T backend_id)
+{
+    if(backend_id == AES_BACKEND_AUTO){
+        /*
+            fastest first; without AES-NI, prefer the constant-time vector permute engine over the table lookups.
+            The bitsliced engine needs the same CPU features as the vector permute one and is only fast on
+            batches of 8 blocks, so it is never picked here: it has to be selected explicitly.
+        */
+        AES_BACKEND_ID_T candidates[] = {AES_BACKEND_AESNI, AES_BACKEND_VPAES, AES_BACKEND_SOFTWARE};
+
+        for(int i = 0; i < (int)(sizeof(candidates)/sizeof(candidates[0])); i++){
+            if(AES_Set_Backend(candidates[i]) == EXIT_SUCCESS){
+                return EXIT_SUCCESS;
+            }
+        }
+        return EXIT_FAILURE;
+    }
+
+    const AES_BACKEND_T *backend = get_backend_by_id(backend_id);
+    if((backend == NULL) || (backend->is_supported() == 0)){
+        return EXIT_FAILURE;
+    }
+
+    aes_backend = backend;
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    Current backend (selected on the first call).
+    Multi-threaded modes call it before starting their worker threads.
+*/
+const AES_BACKEND_T* AES_Get_Backend(void)
+{
+    if(aes_backend == NULL){
+        AES_Set_Backend(AES_BACKEND_AUTO);
+    }
+    return aes_backend;
+}
+
+
+const char* AES_Get_Backend_Name(void)
+{
+    return AES_Get_Backend()->name;
+}
+
+
+
+/*
+    Format the private key in a matrix form.
+*/
+static void format_private_key(uint64_t key_msb, uint64_t key_lsb, AES_Block_Struct *private_key)
+{
+    private_key->w0 = (uint32_t)(key_msb >> 32);
+    private_key->w1 = (uint32_t)(key_msb);
+    private_key->w2 = (uint32_t)(key_lsb >> 32);
+    private_key->w3 = (uint32_t)(key_lsb);
+}
+
+
+/* key columns and context fields, before the key expansion */
+static int init_key_columns(AES_KEY_CONTEXT_T *context, const AES_BACKEND_T *backend, const uint8_t *key, int key_bits, uint32_t *key_columns)
+{
+    if(  (key_bits != 128) && (key_bits != 192) && (key_bits != 256)  ){
+        printf("AES Error: invalid key size.\n");
+        return EXIT_FAILURE;
+    }
+
+    int key_words = key_bits / 32;
+
+    for(int i = 0; i < key_words; i++){
+        key_columns[i] = ((uint32_t)key[4*i] << 24) | ((uint32_t)key[4*i+1] << 16) | ((uint32_t)key[4*i+2] << 8) | (uint32_t)key[4*i+3];
+    }
+
+    context->backend = backend;
+    context->rounds = key_words + 6;
+    context->private_key.w0 = key_columns[0];
+    context->private_key.w1 = key_columns[1];
+    context->private_key.w2 = key_columns[2];
+    context->private_key.w3 = key_columns[3];
+
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    Key schedule: the encryption and decryption sub-keys are generated once, with the current backend.
+
+    Parameters:
+        - key      : private key (16, 24 or 32 bytes)
+        - key_bits : 128, 192 or 256
+*/
+int AES_Init_Key_Context(AES_KEY_CONTEXT_T *context, const uint8_t *key, int key_bits)
+{
+    const AES_BACKEND_T *backend = AES_Get_Backend();
+    uint32_t key_columns[8];
+
+    if(init_key_columns(context, backend, key, key_bits, key_columns) != EXIT_SUCCESS)
+        return EXIT_FAILURE;
+
+    backend->expand_key(key_columns, key_bits / 32, context->sub_keys);
+    backend->decryption_subkeys(context->sub_keys, context->rounds, context->decryption_sub_keys);
+
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    Key schedule of several independent keys (multi-key batches): the keys of the same size are expanded
+    together by groups of AES_BATCH_LANES, so that backends can interleave the computations.
+    The decryption sub-keys are only prepared for AES_DECRYPTION_MODE: with short records, the inverse
+    key schedule would cost as much as the encryption itself.
+*/
+int AES_Init_Key_Contexts(AES_KEY_CONTEXT_T *const *contexts, const uint8_t *const *keys, const int *key_bits, int count, int mode)
+{
+    const AES_BACKEND_T *backend = AES_Get_Backend();
+
+    for(int i = 0; i < count; i++){
+        if(  (key_bits[i] != 128) && (key_bits[i] != 192) && (key_bits[i] != 256)  ){
+            printf("AES Error: invalid key size.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    for(int key_words = 4; key_words <= 8; key_words += 2){
+        uint32_t key_columns[AES_BATCH_LANES][8];
+        const uint32_t *group_keys[AES_BATCH_LANES];
+        AES_Block_Struct *group_sub_keys[AES_BATCH_LANES];
+        int n = 0;
+
+        for(int i = 0; i <= count; i++){
+            /* expand the group when it is full or at the end */
+            if(  (n == AES_BATCH_LANES) || ((i == count) && (n > 0))  ){
+                if(backend->expand_keys_multikey != NULL){
+                    backend->expand_keys_multikey(group_keys, key_words, group_sub_keys, n);
+                }
+                else{
+                    for(int j = 0; j < n; j++)
+                        backend->expand_key(group_keys[j], key_words, group_sub_keys[j]);
+                }
+                n = 0;
+            }
+
+            if(  (i == count) || (key_bits[i] != 32 * key_words)  )
+                continue;
+
+            init_key_columns(contexts[i], backend, keys[i], key_bits[i], key_columns[n]);
+            group_keys[n] = key_columns[n];
+            group_sub_keys[n] = contexts[i]->sub_keys;
+            n++;
+        }
+    }
+
+    if(mode == AES_DECRYPTION_MODE){
+        for(int i = 0; i < count; i++){
+            backend->decryption_subkeys(contexts[i]->sub_keys, contexts[i]->rounds, contexts[i]->decryption_sub_keys);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+void AES128_Init_Key_Context(AES_KEY_CONTEXT_T *context, uint64_t key_msb, uint64_t key_lsb)
+{
+    AES_Block_Struct private_key;
+    uint8_t key[16];
+
+    format_private_key(key_msb, key_lsb, &private_key);
+    AES_Store_Blocks(&private_key, key, 1);
+
+    AES_Init_Key_Context(context, key, 128);
+}
+
+
+
+/*
+    Encrypt or decrypt "block_count" consecutive 16-bytes blocks from "input" to "output"
+    (input and output may be the same buffer).
+*/
+void AES_ECB_Process_Blocks(const AES_KEY_CONTEXT_T *context, const uint8_t *input, uint8_t *output, size_t block_count, int mode)
+{
+    const AES_BACKEND_T *backend = context->backend;
+    AES_Block_Struct blocks[AES_FILE_CHUNK_BLOCKS];
+
+    /* blocks are processed by chunks, so that the backend can work on several independent blocks at once */
+    for(size_t i = 0; i < block_count; i += AES_FILE_CHUNK_BLOCKS){
+        size_t count = __min_(AES_FILE_CHUNK_BLOCKS, block_count - i);
+
+        AES_Load_Blocks(&input[16*i], blocks, count);
+        if(mode == AES_ENCRYPTION_MODE)
+            backend->encrypt_blocks(blocks, count, context);
+        else
+            backend->decrypt_blocks(blocks, count, context);
+        AES_Store_Blocks(blocks, &output[16*i], count);
+    }
+}
+
+
+/*
+    Build the last (padded) block from the "remainder" (0..15) last bytes of the data.
+*/
+void AES_Pad_Last_Block(const uint8_t *data, size_t remainder, uint8_t *last_block)
+{
+    memset(last_block, 0, 16);
+    memcpy(last_block, data, remainder);
+    last_block[15] = 16 - remainder;          // padding last block with (16-remainder-1) null bytes + 1 byte for the length
+}
+
+
+/*
+    Number of data bytes in the last decrypted block, or -1 if the padding length is not valid.
+*/
+int AES_Unpadded_Size(const uint8_t *last_block)
+{
+    int padded_bytes_count = last_block[15];
+
+    if(  (padded_bytes_count < 1) || (padded_bytes_count > 16)  ){
+        return -1;
+    }
+    return 16 - padded_bytes_count;
+}
+
+
+/*
+    Size of the encrypted data for a given plain data size (the padding always adds 1 to 16 bytes).
+*/
+size_t AES_Encrypted_Size(size_t plain_size)
+{
+    return 16 * (plain_size/16 + 1);
+}
+
+
+
+int AES_encryption(const AES_KEY_CONTEXT_T *context, const char* const plain_file_name, const char* const encrypted_file_name)
 {
     FILE *plain_file = fopen(plain_file_name, "rb");
     FILE *encrypted_file = fopen(encrypted_file_name, "wb");
@@ -434,53 +1210,29 @@ int AES128_encryption(const char* const plain_file_name, uint64_t key_msb, uint6
         return EXIT_FAILURE;
     }
 
-    /*
-        Format the private key in a matrix form.
-    */
-    AES_Block_Struct private_key;
-    private_key.w0 = (uint32_t)(key_msb >> 32);
-    private_key.w1 = (uint32_t)(key_msb);
-    private_key.w2 = (uint32_t)(key_lsb >> 32);
-    private_key.w3 = (uint32_t)(key_lsb);
-
-    /*
-        Generate all sub-keys
-    */
-    AES_Block_Struct sub_keys[10];
-    generate_subkey(&private_key, &sub_keys[0], 1);
-    for(int i = 1; i < 10; i++){
-        generate_subkey(&sub_keys[i-1], &sub_keys[i], i+1);
-    }
-
-    
     /* Process blocks */
 
     /* AES operates on 128-bits (16-bytes) wide blocks */
     int remainder = filesize % 16;      // number of bytes to pad (if necessary)
     int q = filesize / 16;                // number of 128-bits blocks
 
-    AES_Block_Struct block;
+    uint8_t data_buffer[16 * AES_FILE_CHUNK_BLOCKS];
 
+    for(int i = 0; i < q; i += AES_FILE_CHUNK_BLOCKS){
+        int count = __min_(AES_FILE_CHUNK_BLOCKS, q - i);
 
-    for(int i = 0; i < q; i++){
-        read_block(plain_file, &block);
-        EncryptBlock(&block, &private_key, sub_keys);
-        write_block(encrypted_file, &block);
+        fread(data_buffer, 16, count, plain_file);
+        AES_ECB_Process_Blocks(context, data_buffer, data_buffer, count, AES_ENCRYPTION_MODE);
+        fwrite(data_buffer, 16, count, encrypted_file);
     }
 
     /* Last block: padding */
-    uint8_t data_buffer[16] = {0};
+    uint8_t last_block[16];
     fread(data_buffer, sizeof(uint8_t), remainder, plain_file);
+    AES_Pad_Last_Block(data_buffer, remainder, last_block);
 
-    block.w0 = switch_endianness_32(*(uint32_t*)&data_buffer[0]);
-    block.w1 = switch_endianness_32(*(uint32_t*)&data_buffer[4]);
-    block.w2 = switch_endianness_32(*(uint32_t*)&data_buffer[8]);
-    block.w3 = switch_endianness_32(*(uint32_t*)&data_buffer[12]);
-
-    block.w3 |= (16-remainder );        // padding last block with (16-remainder-1) null bytes + 1 byte for the length
-
-    EncryptBlock(&block, &private_key, sub_keys);
-    write_block(encrypted_file, &block);
+    AES_ECB_Process_Blocks(context, last_block, last_block, 1, AES_ENCRYPTION_MODE);
+    fwrite(last_block, sizeof(uint8_t), 16, encrypted_file);
 
 
     fclose(plain_file);
@@ -493,7 +1245,7 @@ int AES128_encryption(const char* const plain_file_name, uint64_t key_msb, uint6
 
 
 
-int AES128_decryption(const char* const encrypted_file_name, uint64_t key_msb, uint64_t key_lsb, const char* const decrypted_file_name)
+int AES_decryption(const AES_KEY_CONTEXT_T *context, const char* const encrypted_file_name, const char* const decrypted_file_name)
 {
     FILE *encrypted_file = fopen(encrypted_file_name, "rb");
     FILE *decrypted_file = fopen(decrypted_file_name, "wb");
@@ -504,50 +1256,27 @@ int AES128_decryption(const char* const encrypted_file_name, uint64_t key_msb, u
         return EXIT_FAILURE;
     }
 
-    /*
-        Format the private key in a matrix form.
-    */
-    AES_Block_Struct private_key;
-    private_key.w0 = (uint32_t)(key_msb >> 32);
-    private_key.w1 = (uint32_t)(key_msb);
-    private_key.w2 = (uint32_t)(key_lsb >> 32);
-    private_key.w3 = (uint32_t)(key_lsb);
-
-    /*
-        Generate all sub-keys
-    */
-    AES_Block_Struct sub_keys[10];
-    generate_subkey(&private_key, &sub_keys[0], 1);
-    for(int i = 1; i < 10; i++){
-        generate_subkey(&sub_keys[i-1], &sub_keys[i], i+1);
-    }
-
     /* Process blocks */
 
     /* AES operates on 128-bits (16-bytes) wide blocks */
     int q = filesize / 16;           // number of 128-bits blocks
 
-    AES_Block_Struct block;
+    uint8_t data_buffer[16 * AES_FILE_CHUNK_BLOCKS];
 
+    for(int i = 0; i < q-1; i += AES_FILE_CHUNK_BLOCKS){
+        int count = __min_(AES_FILE_CHUNK_BLOCKS, q-1 - i);
 
-    for(int i = 0; i < q-1; i++){
-        read_block(encrypted_file, &block);
-        DecryptBlock(&block, &private_key, sub_keys);
-        write_block(decrypted_file, &block);
+        fread(data_buffer, 16, count, encrypted_file);
+        AES_ECB_Process_Blocks(context, data_buffer, data_buffer, count, AES_DECRYPTION_MODE);
+        fwrite(data_buffer, 16, count, decrypted_file);
     }
 
     /* Last block: padding */
-    read_block(encrypted_file, &block);
-    DecryptBlock(&block, &private_key, sub_keys);
+    fread(data_buffer, sizeof(uint8_t), 16, encrypted_file);
+    AES_ECB_Process_Blocks(context, data_buffer, data_buffer, 1, AES_DECRYPTION_MODE);
 
-    int data_bytes_count = 16 - (block.w3 & 0xFF);
-    uint8_t temp_buffer[16];
-    *(uint32_t*)&temp_buffer[0] = switch_endianness_32(block.w0);
-    *(uint32_t*)&temp_buffer[4] = switch_endianness_32(block.w1);
-    *(uint32_t*)&temp_buffer[8] = switch_endianness_32(block.w2);
-    *(uint32_t*)&temp_buffer[12] = switch_endianness_32(block.w3);
-
-    fwrite(temp_buffer, sizeof(uint8_t), data_bytes_count, decrypted_file);
+    int data_bytes_count = 16 - data_buffer[15];
+    fwrite(data_buffer, sizeof(uint8_t), data_bytes_count, decrypted_file);
 
 
     fclose(encrypted_file);
@@ -560,8 +1289,795 @@ int AES128_decryption(const char* const encrypted_file_name, uint64_t key_msb, u
 
 
 
+/*
+    Encryption of a memory buffer.
+
+    Parameters:
+        - plain_data     : data to encrypt
+        - plain_size     : size of the data, in bytes
+        - encrypted_data : output buffer, at least AES_Encrypted_Size(plain_size) bytes; it may be plain_data itself
+        - encrypted_size : size of the encrypted data, in bytes
+*/
+int AES_encryption_buffer(const AES_KEY_CONTEXT_T *context, const uint8_t *plain_data, size_t plain_size, uint8_t *encrypted_data, size_t *encrypted_size)
+{
+    if(  ((plain_data == NULL) && (plain_size > 0)) || (encrypted_data == NULL)  ){
+        printf("AES Error: invalid buffer.\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t remainder = plain_size % 16;
+    size_t q = plain_size / 16;
+
+    /* the last bytes are copied first, in case the encryption is done in place */
+    uint8_t last_block[16];
+    AES_Pad_Last_Block(&plain_data[16*q], remainder, last_block);
+
+    AES_ECB_Process_Blocks(context, plain_data, encrypted_data, q, AES_ENCRYPTION_MODE);
+    AES_ECB_Process_Blocks(context, last_block, &encrypted_data[16*q], 1, AES_ENCRYPTION_MODE);
+
+    if(encrypted_size != NULL){
+        *encrypted_size = 16 * (q+1);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    Decryption of a memory buffer.
+
+    Parameters:
+        - encrypted_data : data to decrypt
+        - encrypted_size : size of the encrypted data (a non-null multiple of 16 bytes)
+        - decrypted_data : output buffer, at least encrypted_size bytes; it may be encrypted_data itself
+        - decrypted_size : size of the decrypted data, in bytes
+*/
+int AES_decryption_buffer(const AES_KEY_CONTEXT_T *context, const uint8_t *encrypted_data, size_t encrypted_size, uint8_t *decrypted_data, size_t *decrypted_size)
+{
+    if(  (encrypted_data == NULL) || (decrypted_data == NULL) || (encrypted_size == 0) || ((encrypted_size % 16) > 0)  ){
+        printf("AES Error: invalid buffer.\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t q = encrypted_size / 16;
+
+    AES_ECB_Process_Blocks(context, encrypted_data, decrypted_data, q, AES_DECRYPTION_MODE);
+
+    int last_bytes_count = AES_Unpadded_Size(&decrypted_data[16*(q-1)]);
+    if(last_bytes_count == -1){
+        printf("AES Error: wrong padding.\n");
+        return EXIT_FAILURE;
+    }
+
+    if(decrypted_size != NULL){
+        *decrypted_size = 16*(q-1) + last_bytes_count;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    In-place encryption: "data" holds data_size bytes of plain data and has a capacity of buffer_size bytes,
+    which must be at least AES_Encrypted_Size(data_size).
+*/
+int AES_encryption_in_place(const AES_KEY_CONTEXT_T *context, uint8_t *data, size_t data_size, size_t buffer_size, size_t *encrypted_size)
+{
+    if(buffer_size < AES_Encrypted_Size(data_size)){
+        printf("AES Error: buffer too small.\n");
+        return EXIT_FAILURE;
+    }
+
+    return AES_encryption_buffer(context, data, data_size, data, encrypted_size);
+}
+
+
+/*
+    In-place decryption: the decrypted data (decrypted_size bytes) starts at the beginning of "data".
+*/
+int AES_decryption_in_place(const AES_KEY_CONTEXT_T *context, uint8_t *data, size_t data_size, size_t *decrypted_size)
+{
+    return AES_decryption_buffer(context, data, data_size, data, decrypted_size);
+}
+
+
+
+
+
+/*
+    Scatter/gather lists: the data is the concatenation of the vector elements.
+*/
+typedef struct {
+    const AES_IOVEC_T *iov;
+    int count;
+    int index;              // current element
+    size_t offset;          // offset in the current element
+} IOV_CURSOR_T;
+
+
+static size_t iov_total_size(const AES_IOVEC_T *iov, int count)
+{
+    size_t size = 0;
+    for(int i = 0; i < count; i++){
+        size += iov[i].len;
+    }
+    return size;
+}
+
+
+/*
+    Copy the next "size" bytes of the list to a contiguous buffer (gather) or the opposite (scatter).
+    Return the number of bytes actually copied.
+*/
+static size_t iov_copy(IOV_CURSOR_T *cursor, uint8_t *buffer, size_t size, int gather)
+{
+    size_t copied = 0;
+
+    while(  (copied < size) && (cursor->index < cursor->count)  ){
+        const AES_IOVEC_T *element = &cursor->iov[cursor->index];
+        size_t n = __min_(element->len - cursor->offset, size - copied);
+
+        if(gather)
+            memcpy(&buffer[copied], &element->base[cursor->offset], n);
+        else
+            memcpy(&element->base[cursor->offset], &buffer[copied], n);
+
+        copied += n;
+        cursor->offset += n;
+        if(cursor->offset == element->len){
+            cursor->index++;
+            cursor->offset = 0;
+        }
+    }
+
+    return copied;
+}
+
+
+/*
+    Encryption of a scatter/gather list into another one (same format as AES_encryption_buffer()).
+    The output list must have room for AES_Encrypted_Size() of the total input size.
+*/
+int AES_encryption_iov(const AES_KEY_CONTEXT_T *context, const AES_IOVEC_T *plain_iov, int plain_iov_count,
+                       const AES_IOVEC_T *encrypted_iov, int encrypted_iov_count, size_t *encrypted_size)
+{
+    size_t plain_size = iov_total_size(plain_iov, plain_iov_count);
+
+    if(iov_total_size(encrypted_iov, encrypted_iov_count) < AES_Encrypted_Size(plain_size)){
+        printf("AES Error: buffer too small.\n");
+        return EXIT_FAILURE;
+    }
+
+    IOV_CURSOR_T input = {plain_iov, plain_iov_count, 0, 0};
+    IOV_CURSOR_T output = {encrypted_iov, encrypted_iov_count, 0, 0};
+    uint8_t data_buffer[16 * AES_FILE_CHUNK_BLOCKS];
+    size_t q = plain_size / 16;
+
+    for(size_t i = 0; i < q; i += AES_FILE_CHUNK_BLOCKS){
+        size_t count = __min_(AES_FILE_CHUNK_BLOCKS, q - i);
+
+        iov_copy(&input, data_buffer, 16*count, 1);
+        AES_ECB_Process_Blocks(context, data_buffer, data_buffer, count, AES_ENCRYPTION_MODE);
+        iov_copy(&output, data_buffer, 16*count, 0);
+    }
+
+    /* Last block: padding */
+    uint8_t last_block[16];
+    size_t remainder = iov_copy(&input, data_buffer, 16, 1);
+    AES_Pad_Last_Block(data_buffer, remainder, last_block);
+
+    AES_ECB_Process_Blocks(context, last_block, last_block, 1, AES_ENCRYPTION_MODE);
+    iov_copy(&output, last_block, 16, 0);
+
+    if(encrypted_size != NULL){
+        *encrypted_size = 16 * (q+1);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    Decryption of a scatter/gather list into another one.
+    The output list must have room for the total input size.
+*/
+int AES_decryption_iov(const AES_KEY_CONTEXT_T *context, const AES_IOVEC_T *encrypted_iov, int encrypted_iov_count,
+                       const AES_IOVEC_T *decrypted_iov, int decrypted_iov_count, size_t *decrypted_size)
+{
+    size_t encrypted_size = iov_total_size(encrypted_iov, encrypted_iov_count);
+
+    if(  (encrypted_size == 0) || ((encrypted_size % 16) > 0)  ){
+        printf("AES Error: invalid buffer.\n");
+        return EXIT_FAILURE;
+    }
+    if(iov_total_size(decrypted_iov, decrypted_iov_count) < encrypted_size - 1){
+        printf("AES Error: buffer too small.\n");
+        return EXIT_FAILURE;
+    }
+
+    IOV_CURSOR_T input = {encrypted_iov, encrypted_iov_count, 0, 0};
+    IOV_CURSOR_T output = {decrypted_iov, decrypted_iov_count, 0, 0};
+    uint8_t data_buffer[16 * AES_FILE_CHUNK_BLOCKS];
+    size_t q = encrypted_size / 16;
+
+    for(size_t i = 0; i < q-1; i += AES_FILE_CHUNK_BLOCKS){
+        size_t count = __min_(AES_FILE_CHUNK_BLOCKS, q-1 - i);
+
+        iov_copy(&input, data_buffer, 16*count, 1);
+        AES_ECB_Process_Blocks(context, data_buffer, data_buffer, count, AES_DECRYPTION_MODE);
+        iov_copy(&output, data_buffer, 16*count, 0);
+    }
+
+    /* Last block: padding */
+    iov_copy(&input, data_buffer, 16, 1);
+    AES_ECB_Process_Blocks(context, data_buffer, data_buffer, 1, AES_DECRYPTION_MODE);
+
+    int last_bytes_count = AES_Unpadded_Size(data_buffer);
+    if(last_bytes_count == -1){
+        printf("AES Error: wrong padding.\n");
+        return EXIT_FAILURE;
+    }
+    iov_copy(&output, data_buffer, last_bytes_count, 0);
+
+    if(decrypted_size != NULL){
+        *decrypted_size = 16*(q-1) + last_bytes_count;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+
+
+/*
+    Random access: decrypt "length" bytes of plain data starting at "offset" from an ECB encrypted file,
+    reading only the covering blocks (and the last block, for the padding, when the range reaches it).
+
+    Parameters:
+        - decrypted_data : output buffer of "length" bytes
+        - decrypted_size : number of bytes written (less than "length" if the range goes past the end of the data)
+*/
+int AES_decryption_range(const AES_KEY_CONTEXT_T *context, const char* const encrypted_file_name, uint64_t offset, size_t length,
+                         uint8_t *decrypted_data, size_t *decrypted_size)
+{
+    FILE *encrypted_file = fopen(encrypted_file_name, "rb");
+    int64_t filesize = get_filesize_64(encrypted_file_name);
+
+    if(  (encrypted_file == NULL) || (filesize < 16) || ((filesize % 16) > 0)  ){
+        if(encrypted_file != NULL)
+            fclose(encrypted_file);
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t q = (uint64_t)filesize / 16;
+    uint64_t data_size = 16*(q-1);          // up to the last block
+    uint8_t data_buffer[16 * AES_FILE_CHUNK_BLOCKS];
+
+    /* the last block is only needed when the range reaches it */
+    if(offset + length > data_size){
+        if(file_read_at(encrypted_file, data_buffer, 16, (int64_t)data_size) != 16){
+            fclose(encrypted_file);
+            printf("AES Error: cannot open files.\n");
+            return EXIT_FAILURE;
+        }
+        AES_ECB_Process_Blocks(context, data_buffer, data_buffer, 1, AES_DECRYPTION_MODE);
+
+        int last_bytes_count = AES_Unpadded_Size(data_buffer);
+        if(last_bytes_count == -1){
+            fclose(encrypted_file);
+            printf("AES Error: wrong padding.\n");
+            return EXIT_FAILURE;
+        }
+        data_size += last_bytes_count;
+    }
+
+    length = (offset >= data_size) ? 0 : (size_t)__min_((uint64_t)length, data_size - offset);
+
+    size_t done = 0;
+    while(done < length){
+        uint64_t block = (offset + done) / 16;
+        size_t skip = (offset + done) % 16;
+        size_t count = __min_(AES_FILE_CHUNK_BLOCKS, (skip + length - done + 15) / 16);
+        size_t size = __min_(16*count - skip, length - done);
+
+        file_read_at(encrypted_file, data_buffer, 16*count, (int64_t)(16*block));
+        AES_ECB_Process_Blocks(context, data_buffer, data_buffer, count, AES_DECRYPTION_MODE);
+        memcpy(&decrypted_data[done], &data_buffer[skip], size);
+        done += size;
+    }
+
+    fclose(encrypted_file);
+
+    if(decrypted_size != NULL){
+        *decrypted_size = length;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+
+
+/*
+    AES-128 functions taking the key itself: the key schedule is computed on each call.
+*/
+int AES128_encryption(const char* const plain_file_name, uint64_t key_msb, uint64_t key_lsb, const char* const encrypted_file_name)
+{
+    AES_KEY_CONTEXT_T context;
+    AES128_Init_Key_Context(&context, key_msb, key_lsb);
+
+    return AES_encryption(&context, plain_file_name, encrypted_file_name);
+}
+
+int AES128_decryption(const char* const encrypted_file_name, uint64_t key_msb, uint64_t key_lsb, const char* const decrypted_file_name)
+{
+    AES_KEY_CONTEXT_T context;
+    AES128_Init_Key_Context(&context, key_msb, key_lsb);
+
+    return AES_decryption(&context, encrypted_file_name, decrypted_file_name);
+}
+
+int AES128_decryption_range(const char* const encrypted_file_name, uint64_t key_msb, uint64_t key_lsb, uint64_t offset, size_t length,
+                            uint8_t *decrypted_data, size_t *decrypted_size)
+{
+    AES_KEY_CONTEXT_T context;
+    AES128_Init_Key_Context(&context, key_msb, key_lsb);
+
+    return AES_decryption_range(&context, encrypted_file_name, offset, length, decrypted_data, decrypted_size);
+}
+
+int AES128_encryption_buffer(const uint8_t *plain_data, size_t plain_size, uint64_t key_msb, uint64_t key_lsb, uint8_t *encrypted_data, size_t *encrypted_size)
+{
+    AES_KEY_CONTEXT_T context;
+    AES128_Init_Key_Context(&context, key_msb, key_lsb);
+
+    return AES_encryption_buffer(&context, plain_data, plain_size, encrypted_data, encrypted_size);
+}
+
+int AES128_decryption_buffer(const uint8_t *encrypted_data, size_t encrypted_size, uint64_t key_msb, uint64_t key_lsb, uint8_t *decrypted_data, size_t *decrypted_size)
+{
+    AES_KEY_CONTEXT_T context;
+    AES128_Init_Key_Context(&context, key_msb, key_lsb);
+
+    return AES_decryption_buffer(&context, encrypted_data, encrypted_size, decrypted_data, decrypted_size);
+}
+
+int AES128_encryption_in_place(uint8_t *data, size_t data_size, size_t buffer_size, uint64_t key_msb, uint64_t key_lsb, size_t *encrypted_size)
+{
+    AES_KEY_CONTEXT_T context;
+    AES128_Init_Key_Context(&context, key_msb, key_lsb);
+
+    return AES_encryption_in_place(&context, data, data_size, buffer_size, encrypted_size);
+}
+
+int AES128_decryption_in_place(uint8_t *data, size_t data_size, uint64_t key_msb, uint64_t key_lsb, size_t *decrypted_size)
+{
+    AES_KEY_CONTEXT_T context;
+    AES128_Init_Key_Context(&context, key_msb, key_lsb);
+
+    return AES_decryption_in_place(&context, data, data_size, decrypted_size);
+}
+
+int AES128_encryption_iov(const AES_IOVEC_T *plain_iov, int plain_iov_count, uint64_t key_msb, uint64_t key_lsb,
+                          const AES_IOVEC_T *encrypted_iov, int encrypted_iov_count, size_t *encrypted_size)
+{
+    AES_KEY_CONTEXT_T context;
+    AES128_Init_Key_Context(&context, key_msb, key_lsb);
+
+    return AES_encryption_iov(&context, plain_iov, plain_iov_count, encrypted_iov, encrypted_iov_count, encrypted_size);
+}
+
+int AES128_decryption_iov(const AES_IOVEC_T *encrypted_iov, int encrypted_iov_count, uint64_t key_msb, uint64_t key_lsb,
+                          const AES_IOVEC_T *decrypted_iov, int decrypted_iov_count, size_t *decrypted_size)
+{
+    AES_KEY_CONTEXT_T context;
+    AES128_Init_Key_Context(&context, key_msb, key_lsb);
+
+    return AES_decryption_iov(&context, encrypted_iov, encrypted_iov_count, decrypted_iov, decrypted_iov_count, decrypted_size);
+}
+
+
+
+
+
+/* test vectors are written as hexadecimal strings */
+static size_t test_hex_to_bytes(const char *hex, uint8_t *bytes)
+{
+    size_t size = strlen(hex) / 2;
+    for(size_t i = 0; i < size; i++){
+        unsigned int byte;
+        sscanf(&hex[2*i], "%2x", &byte);
+        bytes[i] = (uint8_t)byte;
+    }
+    return size;
+}
+
+
+/*
+    AES-GCM known answers (McGrew & Viega, "The Galois/Counter Mode of Operation", test cases 2, 4 and 6):
+    96-bits IV without and with AAD, 60-bytes IV (J0 computed with GHASH), then a tampered tag.
+    A round trip cannot catch a wrong GHASH, since encryption and decryption would share the bug.
+*/
+static int AES_GCM_known_answers(void)
+{
+    static const struct {
+        const char *key, *iv, *aad, *plain, *cipher, *tag;
+    } vectors[] = {
+        {"00000000000000000000000000000000", "000000000000000000000000", "",
+         "00000000000000000000000000000000",
+         "0388dace60b6a392f328c2b971b2fe78",
+         "ab6e47d42cec13bdf53a67b21257bddf"},
+        {"feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+         "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+         "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091",
+         "5bc94fbc3221a5db94fae95ae7121a47"},
+        {"feffe9928665731c6d6a8f9467308308",
+         "9313225df88406e555909c5aff5269aa6a7a9538534f7da1e4c303d2a318a728c3c0c95156809539fcf0e2429a6b525416aedbf5a0de6a57a637b39b",
+         "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+         "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+         "8ce24998625615b603a033aca13fb894be9112a5c3a211a8ba262a3cca7e2ca701e4a9a4fba43c90ccdcb281d48c7c6fd62875d2aca417034c34aee5",
+         "619cc5aefffe0bfa462af43c1699d050"}
+    };
+    AES_KEY_CONTEXT_T context;
+    uint8_t key[16], iv[64], aad[32], plain[64], cipher[64], tag[16];
+    uint8_t output[64], output_tag[16];
+    size_t iv_size = 0, aad_size = 0, size = 0;
+    int ok = 1;
+
+    for(int v = 0; v < (int)(sizeof(vectors)/sizeof(vectors[0])); v++){
+        test_hex_to_bytes(vectors[v].key, key);
+        iv_size = test_hex_to_bytes(vectors[v].iv, iv);
+        aad_size = test_hex_to_bytes(vectors[v].aad, aad);
+        size = test_hex_to_bytes(vectors[v].plain, plain);
+        test_hex_to_bytes(vectors[v].cipher, cipher);
+        test_hex_to_bytes(vectors[v].tag, tag);
+        AES_Init_Key_Context(&context, key, 128);
+
+        AES_GCM_encryption_buffer(&context, iv, iv_size, aad, aad_size, plain, size, output, output_tag);
+        ok &= (memcmp(output, cipher, size) == 0) && (memcmp(output_tag, tag, 16) == 0);
+
+        ok &= (AES_GCM_decryption_buffer(&context, iv, iv_size, aad, aad_size, cipher, size, output, tag) == EXIT_SUCCESS);
+        ok &= (memcmp(output, plain, size) == 0);
+    }
+
+    /* tampered tag (last vector): rejected, and the output buffer is cleared */
+    const uint8_t zeros[64] = {0};
+    tag[15] ^= 0x01;
+    ok &= (AES_GCM_decryption_buffer(&context, iv, iv_size, aad, aad_size, cipher, size, output, tag) == EXIT_FAILURE);
+    ok &= (memcmp(output, zeros, size) == 0);
+
+    return ok;
+}
+
+
+
+/*
+    CTR keystream reservoir: a sequence of messages of various sizes gives the same output as one CTR stream
+    over their concatenation (also checked in place). Then, once the background thread has filled the ring,
+    a message is served from the reservoir.
+*/
+static int AES_reservoir_check(const AES_KEY_CONTEXT_T *context, size_t capacity_blocks)
+{
+    AES_CTR_RESERVOIR_T reservoir;
+    AES_CTR_RESERVOIR_METRICS_T metrics;
+    AES_STREAM_T stream;
+    uint8_t plain[2048], expected[2048 + 16], output[2048];
+    size_t total = 0, size;
+    uint64_t offset;
+    int ok = 1;
+
+    for(int i = 0; i < 2048; i++){
+        plain[i] = (uint8_t)(i * 31 + 7);
+    }
+    if(AES_CTR_Reservoir_Init(&reservoir, context, 0x0123456789ABCDEF, capacity_blocks) != EXIT_SUCCESS)
+        return 0;
+
+    for(int i = 0; total + 53 <= 2048; i++){
+        size_t message_size = (size_t)((i * 7) % 53);
+        AES_CTR_Reservoir_Process(&reservoir, &plain[total], &output[total], message_size, &offset);
+        ok &= (offset == total);
+        total += message_size;
+    }
+
+    AES_CTR_Stream_Init(&stream, context, 0x0123456789ABCDEF);
+    AES_Stream_Update(&stream, plain, total, expected, &size);
+    ok &= (size == total) && (memcmp(output, expected, total) == 0);
+
+    /* the same stream processed in place, by pieces that do not follow the block boundaries */
+    memcpy(output, plain, total);
+    AES_CTR_Stream_Init(&stream, context, 0x0123456789ABCDEF);
+    for(size_t done = 0; done < total; done += size){
+        AES_Stream_Update(&stream, &output[done], __min_((size_t)37, total - done), &output[done], &size);
+    }
+    ok &= (memcmp(output, expected, total) == 0);
+
+    AES_CTR_Reservoir_Get_Metrics(&reservoir, &metrics);
+    ok &= (metrics.refilled_blocks + metrics.inline_blocks >= (total + 15) / 16);
+
+    /* wait (at most 1 s) for the background thread to fill the ring */
+    for(int i = 0; (i < 1000) && (metrics.fill_blocks < metrics.capacity_blocks); i++){
+        nanosleep(&(struct timespec){0, 1000000}, NULL);
+        AES_CTR_Reservoir_Get_Metrics(&reservoir, &metrics);
+    }
+    uint64_t reservoir_bytes = metrics.reservoir_bytes;
+    AES_CTR_Reservoir_Process(&reservoir, plain, output, 1, NULL);      // the ring holds at least the current block
+    AES_CTR_Reservoir_Get_Metrics(&reservoir, &metrics);
+    ok &= (metrics.reservoir_bytes == reservoir_bytes + 1);
+
+    AES_CTR_Reservoir_Free(&reservoir);
+    return ok;
+}
+
+
+
+/*
+    Random access (ECB and CTR files): ranges starting and ending inside a block, covering only the last
+    (padded) block, and going past the end of the data, compared with the same slice of the full decryption.
+*/
+static int AES_range_check(const AES_KEY_CONTEXT_T *context)
+{
+    const uint64_t nonce = 0x0123456789ABCDEF;
+    const uint64_t range_offsets[4] = {21, 992, 990, 1200};          // the plain data is 62 blocks and 8 bytes long
+    const size_t range_lengths[4] = {40, 8, 100, 16};
+    uint8_t plain[1000], full[2][1024], range[128];
+    size_t full_size[2], size;
+    int ok = 1;
+
+    for(int i = 0; i < (int)sizeof(plain); i++){
+        plain[i] = (uint8_t)(i * 7 + 3);
+    }
+    FILE *plain_file = fopen("AES_range_plain_test.txt", "wb");
+    if(plain_file == NULL){
+        return 0;
+    }
+    fwrite(plain, sizeof(uint8_t), sizeof(plain), plain_file);
+    fclose(plain_file);
+
+    ok &= (AES_encryption(context, "AES_range_plain_test.txt", "AES_range_encrypted_test.txt") == EXIT_SUCCESS);
+    ok &= (AES_decryption(context, "AES_range_encrypted_test.txt", "AES_range_decrypted_test.txt") == EXIT_SUCCESS);
+    ok &= (AES_CTR_encryption(context, "AES_range_plain_test.txt", nonce, "AES_CTR_range_encrypted_test.txt", 1) == EXIT_SUCCESS);
+    ok &= (AES_CTR_decryption(context, "AES_CTR_range_encrypted_test.txt", nonce, "AES_CTR_range_decrypted_test.txt", 1) == EXIT_SUCCESS);
+
+    const char *decrypted_file_names[2] = {"AES_range_decrypted_test.txt", "AES_CTR_range_decrypted_test.txt"};
+    for(int f = 0; f < 2; f++){
+        FILE *decrypted_file = fopen(decrypted_file_names[f], "rb");
+        if(decrypted_file == NULL){
+            return 0;
+        }
+        full_size[f] = fread(full[f], sizeof(uint8_t), sizeof(full[f]), decrypted_file);
+        fclose(decrypted_file);
+        ok &= (full_size[f] == sizeof(plain));
+    }
+
+    for(int r = 0; r < 4; r++){
+        for(int f = 0; f < 2; f++){
+            uint64_t offset = range_offsets[r];
+            size_t expected_size = (offset >= full_size[f]) ? 0 : (size_t)__min_((uint64_t)range_lengths[r], full_size[f] - offset);
+            int result = (f == 0) ? AES_decryption_range(context, "AES_range_encrypted_test.txt", offset, range_lengths[r], range, &size)
+                                  : AES_CTR_decryption_range(context, "AES_CTR_range_encrypted_test.txt", nonce, offset, range_lengths[r], range, &size);
+            ok &= (result == EXIT_SUCCESS) && (size == expected_size) && (memcmp(range, &full[f][__min_(offset, full_size[f])], size) == 0);
+        }
+    }
+
+    return ok;
+}
+
+
+
+/*
+    CBC: the multi-buffer encryption of messages of various sizes (more messages than lanes, some empty)
+    gives the same output as independent encryptions, and a buffer spread over several segments is
+    decrypted back by several threads.
+*/
+static int AES_CBC_check(const AES_KEY_CONTEXT_T *context)
+{
+    enum { MESSAGE_COUNT = 2 * AES_CBC_LANES + 3 };
+    AES_CBC_MESSAGE_T messages[MESSAGE_COUNT];
+    uint8_t plain[16 * 40], ivs[MESSAGE_COUNT][16], multi_output[MESSAGE_COUNT][16 * 41], single_output[16 * 41];
+    size_t size;
+    int ok = 1;
+
+    for(int i = 0; i < (int)sizeof(plain); i++){
+        plain[i] = (uint8_t)(i * 13 + 5);
+    }
+    for(int i = 0; i < MESSAGE_COUNT; i++){
+        for(int j = 0; j < 16; j++){
+            ivs[i][j] = (uint8_t)(i * 16 + j);
+        }
+        size_t plain_size = (size_t)(i * 37) % sizeof(plain);           // 0, 37, ... 629, then smaller sizes again
+        messages[i] = (AES_CBC_MESSAGE_T){plain, plain_size, ivs[i], multi_output[i], 0};
+    }
+    ok &= (AES_CBC_encryption_multi(context, messages, MESSAGE_COUNT) == EXIT_SUCCESS);
+    for(int i = 0; i < MESSAGE_COUNT; i++){
+        AES_CBC_encryption_buffer(context, ivs[i], plain, messages[i].plain_size, single_output, &size);
+        ok &= (size == messages[i].encrypted_size) && (memcmp(single_output, multi_output[i], size) == 0);
+    }
+
+    /* 2.5 segments of AES_CBC_MIN_BLOCKS_PER_THREAD blocks, decrypted by 4 threads */
+    size_t large_size = 16 * (5 * AES_CBC_MIN_BLOCKS_PER_THREAD / 2) + 9;
+    uint8_t *large_plain = (uint8_t*)malloc(large_size);
+    uint8_t *large_encrypted = (uint8_t*)malloc(AES_Encrypted_Size(large_size));
+    uint8_t *large_decrypted = (uint8_t*)malloc(AES_Encrypted_Size(large_size));
+    if(  (large_plain == NULL) || (large_encrypted == NULL) || (large_decrypted == NULL)  ){
+        ok = 0;
+    }
+    else{
+        for(size_t i = 0; i < large_size; i++){
+            large_plain[i] = (uint8_t)(i ^ (i >> 8));
+        }
+        AES_CBC_encryption_buffer(context, ivs[0], large_plain, large_size, large_encrypted, &size);
+        ok &= (AES_CBC_decryption_buffer(context, ivs[0], large_encrypted, size, large_decrypted, &size, 4) == EXIT_SUCCESS);
+        ok &= (size == large_size) && (memcmp(large_decrypted, large_plain, large_size) == 0);
+    }
+    free(large_plain);
+    free(large_encrypted);
+    free(large_decrypted);
+
+    return ok;
+}
+
+
+
 void AES_test(void)
 {
-   AES128_encryption("plain_data_test.txt", 0x1457896585214589, 0x4578962585412596, "AES_encrypted_data_test.txt");
-   AES128_decryption("AES_encrypted_data_test.txt", 0x1457896585214589, 0x4578962585412596, "AES_decrypted_data_test.txt");
+   printf("AES backend: %s\n", AES_Get_Backend_Name());
+
+   /*
+       FIPS-197 known answers (Appendix C) on every backend supported by the CPU. The block is repeated
+       9 times so that the bitsliced engine goes through both a full batch of 8 blocks and a partial one.
+   */
+   const AES_BACKEND_ID_T kat_backends[] = {AES_BACKEND_SOFTWARE, AES_BACKEND_AESNI, AES_BACKEND_BITSLICE, AES_BACKEND_VPAES};
+   const int kat_key_bits[] = {128, 192, 256};
+   const uint8_t kat_expected[][16] = {
+       {0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a},     // C.1
+       {0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0, 0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91},     // C.2
+       {0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89}      // C.3
+   };
+   uint8_t kat_key[32], kat_plain[9*16], kat_cipher[9*16], kat_decrypted[9*16];
+   for(int i = 0; i < 32; i++){
+       kat_key[i] = (uint8_t)i;
+   }
+   for(int i = 0; i < 9*16; i++){
+       kat_plain[i] = (uint8_t)(0x11 * (i % 16));
+   }
+   for(int b = 0; b < (int)(sizeof(kat_backends)/sizeof(kat_backends[0])); b++){
+       if(AES_Set_Backend(kat_backends[b]) != EXIT_SUCCESS){
+           continue;
+       }
+       int kat_ok = 1;
+       for(int k = 0; k < (int)(sizeof(kat_key_bits)/sizeof(kat_key_bits[0])); k++){
+           AES_KEY_CONTEXT_T kat_context;
+           AES_Init_Key_Context(&kat_context, kat_key, kat_key_bits[k]);
+           AES_ECB_Process_Blocks(&kat_context, kat_plain, kat_cipher, 9, AES_ENCRYPTION_MODE);
+           AES_ECB_Process_Blocks(&kat_context, kat_cipher, kat_decrypted, 9, AES_DECRYPTION_MODE);
+           for(int i = 0; i < 9; i++){
+               kat_ok &= (memcmp(&kat_cipher[16*i], kat_expected[k], 16) == 0);
+           }
+           kat_ok &= (memcmp(kat_decrypted, kat_plain, 9*16) == 0);
+       }
+       printf("AES FIPS-197 known answer (%s): %s\n", AES_Get_Backend_Name(), kat_ok ? "OK" : "FAILED");
+   }
+   AES_Set_Backend(AES_BACKEND_AUTO);
+
+   AES_KEY_CONTEXT_T context;
+   AES128_Init_Key_Context(&context, 0x1457896585214589, 0x4578962585412596);
+
+   AES_encryption(&context, "plain_data_test.txt", "AES_encrypted_data_test.txt");
+   AES_decryption(&context, "AES_encrypted_data_test.txt", "AES_decrypted_data_test.txt");
+
+   const uint8_t key_256[32] = {
+       0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+       0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7, 0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4
+   };
+   AES_KEY_CONTEXT_T context_256;
+   AES_Init_Key_Context(&context_256, key_256, 256);
+
+   AES_encryption(&context_256, "plain_data_test.txt", "AES256_encrypted_data_test.txt");
+   AES_decryption(&context_256, "AES256_encrypted_data_test.txt", "AES256_decrypted_data_test.txt");
+
+   const char message[] = "AES in-memory buffer test";
+   uint8_t buffer[64];
+   size_t size;
+   AES_encryption_buffer(&context, (const uint8_t*)message, sizeof(message), buffer, &size);
+   AES_decryption_in_place(&context, buffer, size, &size);
+   printf("AES buffer round trip: %s\n", (size == sizeof(message)) && (memcmp(buffer, message, size) == 0) ? "OK" : "FAILED");
+
+   const uint8_t iv[AES_GCM_IV_SIZE] = {0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88};
+   AES_GCM_encryption(&context_256, "plain_data_test.txt", iv, "AES_GCM_encrypted_data_test.txt");
+   AES_GCM_decryption(&context_256, "AES_GCM_encrypted_data_test.txt", "AES_GCM_decrypted_data_test.txt");
+
+   /* GCM known answers with each GHASH implementation */
+   const AES_GHASH_ID_T ghash_ids[] = {AES_GHASH_TABLE, AES_GHASH_CLMUL};
+   for(int g = 0; g < (int)(sizeof(ghash_ids)/sizeof(ghash_ids[0])); g++){
+       if(AES_GCM_Set_GHASH(ghash_ids[g]) == EXIT_SUCCESS){
+           printf("AES GCM known answer (%s): %s\n", AES_GCM_Get_GHASH_Name(), AES_GCM_known_answers() ? "OK" : "FAILED");
+       }
+   }
+   AES_GCM_Set_GHASH(AES_GHASH_AUTO);
+
+   AES_STREAM_T stream;
+   FILE *input_file = fopen("plain_data_test.txt", "rb");
+   FILE *output_file = fopen("AES_stream_encrypted_data_test.txt", "wb");
+   AES_ECB_Stream_Init(&stream, &context, AES_ENCRYPTION_MODE);
+   AES_Stream_File(&stream, input_file, output_file);
+   if(input_file != NULL)
+       fclose(input_file);
+   if(output_file != NULL)
+       fclose(output_file);
+
+   AES_CTR_encryption(&context, "plain_data_test.txt", 0x0123456789ABCDEF, "AES_CTR_encrypted_data_test.txt", 0);
+   AES_CTR_decryption(&context, "AES_CTR_encrypted_data_test.txt", 0x0123456789ABCDEF, "AES_CTR_decrypted_data_test.txt", 0);
+   printf("AES range decryption (ECB, CTR): %s\n", AES_range_check(&context) ? "OK" : "FAILED");
+
+   const uint8_t cbc_iv[16] = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+   AES_CBC_encryption(&context, "plain_data_test.txt", cbc_iv, "AES_CBC_encrypted_data_test.txt");
+   AES_CBC_decryption(&context, "AES_CBC_encrypted_data_test.txt", "AES_CBC_decrypted_data_test.txt", 0);
+   printf("AES CBC multi-buffer and threaded decryption: %s\n", AES_CBC_check(&context) ? "OK" : "FAILED");
+
+   AES_XTS_CONTEXT_T xts;
+   uint8_t xts_key[32], sector[4096], read_sector[4096];
+   for(int i = 0; i < 32; i++){
+       xts_key[i] = (uint8_t)(i * 7 + 1);
+   }
+   for(int i = 0; i < 4096; i++){
+       sector[i] = (uint8_t)i;
+   }
+   AES_XTS_Init_Context(&xts, xts_key, 256, 4096);
+   AES_XTS_write_sectors(&xts, "AES_XTS_image_test.img", 3, sector, 1);       // only sector 3 is encrypted and written
+   AES_XTS_read_sectors(&xts, "AES_XTS_image_test.img", 3, read_sector, 1);
+   printf("AES XTS sector round trip: %s\n", (memcmp(sector, read_sector, 4096) == 0) ? "OK" : "FAILED");
+
+   /* CTR keystream reservoir, down to a ring of a single block */
+   const size_t reservoir_capacities[3] = {1, 3, 1024};
+   int reservoir_ok = 1;
+   for(int i = 0; i < 3; i++){
+       reservoir_ok &= AES_reservoir_check(&context, reservoir_capacities[i]);
+   }
+   printf("AES CTR reservoir: %s\n", reservoir_ok ? "OK" : "FAILED");
+
+   /*
+       multi-key batch: one key per record (128, 192 and 256-bits keys mixed, odd records in place),
+       checked against the single-key function, then decrypted back
+   */
+   AES_BATCH_RECORD_T records[6];
+   const int batch_key_bits[3] = {128, 192, 256};
+   uint8_t batch_keys[6][32], batch_output[6][64], single_output[64];
+   int batch_ok = 1;
+   for(int i = 0; i < 6; i++){
+       for(int j = 0; j < 32; j++){
+           batch_keys[i][j] = (uint8_t)(i * 32 + j);
+       }
+       size_t record_size = sizeof(message) - 4*i;
+       const uint8_t *record_input = (const uint8_t*)message;
+       if(i % 2){
+           memcpy(batch_output[i], message, record_size);
+           record_input = batch_output[i];
+       }
+       records[i] = (AES_BATCH_RECORD_T){batch_keys[i], batch_key_bits[i % 3], record_input, record_size, batch_output[i], 0};
+   }
+   AES_encryption_batch(records, 6);
+   for(int i = 0; i < 6; i++){
+       AES_KEY_CONTEXT_T record_context;
+       AES_Init_Key_Context(&record_context, batch_keys[i], batch_key_bits[i % 3]);
+       AES_encryption_buffer(&record_context, (const uint8_t*)message, sizeof(message) - 4*i, single_output, &size);
+       batch_ok &= (size == records[i].output_size) && (memcmp(single_output, batch_output[i], size) == 0);
+       records[i].input = batch_output[i];          // decrypted in place
+       records[i].input_size = records[i].output_size;
+   }
+   batch_ok &= (AES_decryption_batch(records, 6) == EXIT_SUCCESS);
+   for(int i = 0; i < 6; i++){
+       batch_ok &= (records[i].output_size == sizeof(message) - 4*i) && (memcmp(batch_output[i], message, records[i].output_size) == 0);
+   }
+   printf("AES multi-key batch: %s\n", batch_ok ? "OK" : "FAILED");
+
+   /* vector permute engine, checked against the portable engine */
+   if(AES_Set_Backend(AES_BACKEND_VPAES) == EXIT_SUCCESS){
+       uint8_t vpaes_buffer[64];
+       AES128_encryption_buffer((const uint8_t*)message, sizeof(message), 0x1457896585214589, 0x4578962585412596, vpaes_buffer, &size);
+       AES_Set_Backend(AES_BACKEND_SOFTWARE);
+       AES128_encryption_buffer((const uint8_t*)message, sizeof(message), 0x1457896585214589, 0x4578962585412596, buffer, &size);
+       printf("AES vector permute engine: %s\n", (memcmp(buffer, vpaes_buffer, size) == 0) ? "OK" : "FAILED");
+       AES_Set_Backend(AES_BACKEND_AUTO);
+   }
 }
\ No newline at end of file
@@ -4,12 +4,48 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include "helpers.h"
 
 #define AES_FORWARD_S_BOX           0
 #define AES_ROUND_USE_MIXCOLUMNS    0
 #define AES_ROUND_NO_MIXCOLUMNS     1
 
+#define AES_ENCRYPTION_MODE         0
+#define AES_DECRYPTION_MODE         1
+
+#define AES_ENGINE_REFERENCE        0           // byte-wise SubBytes/ShiftRows/MixColumns (reference path)
+#define AES_ENGINE_TTABLE           1           // 32-bits T-tables, 4 lookups per column and per round
+#define AES_ENGINE                  AES_ENGINE_TTABLE       // select the software AES engine
+
+#define AES_MAX_ROUNDS              14          // AES-256 (AES-128: 10 rounds, AES-192: 12 rounds)
+
+#define AES_FILE_CHUNK_BLOCKS       1024        // number of blocks read, processed and written at once by the file functions
+#define AES_CTR_MIN_BLOCKS_PER_THREAD   65536   // CTR mode: minimum amount of work (1 MB) given to a worker thread
+#define AES_CBC_MIN_BLOCKS_PER_THREAD   65536   // CBC decryption: minimum amount of work (1 MB) given to a worker thread
+#define AES_CBC_LANES               8           // CBC multi-buffer encryption: number of messages encrypted together
+#define AES_BATCH_LANES             8           // multi-key batches: number of records (keys) in flight
+
+#define AES_GCM_IV_SIZE             12          // bytes (96-bits IV: the counter block is IV || counter)
+#define AES_GCM_TAG_SIZE            16          // bytes
+
+
+/* AES backends, selected at run-time (AES_BACKEND_AUTO picks the fastest one supported by the CPU, except the bitsliced one) */
+typedef enum {
+    AES_BACKEND_AUTO = 0,
+    AES_BACKEND_SOFTWARE,           // portable C engine selected by AES_ENGINE
+    AES_BACKEND_AESNI,              // x86 AES-NI instructions
+    AES_BACKEND_BITSLICE,           // constant-time bitsliced engine (SSSE3), 8 blocks at once (opt-in: never chosen by AUTO)
+    AES_BACKEND_VPAES               // constant-time vector permute engine (SSSE3), one block at a time
+} AES_BACKEND_ID_T;
+
+/* GHASH implementations of AES-GCM (AES_GHASH_AUTO: PCLMULQDQ when supported, 4-bits tables otherwise) */
+typedef enum {
+    AES_GHASH_AUTO = 0,
+    AES_GHASH_TABLE,                // portable 4-bits tables
+    AES_GHASH_CLMUL                 // x86 PCLMULQDQ instruction
+} AES_GHASH_ID_T;
+
 /* Each AES data block is represented by a matrix; 4 columns of 1 word (32-bits value) */
 typedef struct {
     uint32_t w0;        // first column
@@ -19,8 +55,194 @@ typedef struct {
 } AES_Block_Struct;
 
 
+/*
+    Expanded key: the key schedule is computed once by AES_Init_Key_Context() (128, 192 or 256-bits keys)
+    and the context can then be used for any number of messages. The decryption sub-keys are prepared for
+    the backend selected at that time, which stays attached to the context.
+*/
+typedef struct {
+    const struct AES_BACKEND_S *backend;
+    int rounds;                                             // 10, 12 or 14
+    AES_Block_Struct private_key;                           // initial round key (first 128 bits of the key)
+    AES_Block_Struct sub_keys[AES_MAX_ROUNDS];              // encryption round keys
+    AES_Block_Struct decryption_sub_keys[AES_MAX_ROUNDS];   // decryption round keys (equivalent inverse cipher, backend format)
+} AES_KEY_CONTEXT_T;
+
+
+/* Incremental interface (see AES_stream.c) */
+typedef enum {
+    AES_STREAM_ECB_ENCRYPTION,
+    AES_STREAM_ECB_DECRYPTION,
+    AES_STREAM_CTR
+} AES_STREAM_MODE_T;
+
+typedef struct {
+    const AES_KEY_CONTEXT_T *context;
+    AES_STREAM_MODE_T mode;
+    uint8_t buffer[16];         // ECB: pending input bytes, CTR: current keystream block
+    size_t buffered;            // ECB: number of pending bytes, CTR: number of keystream bytes already used
+    uint64_t nonce;             // CTR only
+    uint64_t counter;           // CTR only: next block number
+} AES_STREAM_T;
+
+
+/* CBC multi-buffer encryption: one independent message (encrypted_data: AES_Encrypted_Size(plain_size) bytes) */
+typedef struct {
+    const uint8_t *plain_data;
+    size_t plain_size;
+    const uint8_t *iv;                  // 16 bytes
+    uint8_t *encrypted_data;
+    size_t encrypted_size;              // set by AES_CBC_encryption_multi()
+} AES_CBC_MESSAGE_T;
+
+
+/* Multi-key batch: one record with its own key (see AES_batch.c) */
+typedef struct {
+    const uint8_t *key;
+    int key_bits;                       // 128, 192 or 256
+    const uint8_t *input;
+    size_t input_size;
+    uint8_t *output;                    // encryption: AES_Encrypted_Size(input_size) bytes, decryption: input_size bytes
+    size_t output_size;                 // set by AES_encryption_batch() / AES_decryption_batch()
+} AES_BATCH_RECORD_T;
+
+
+/* CTR keystream reservoir (see AES_reservoir.c) */
+typedef struct {
+    const AES_KEY_CONTEXT_T *context;
+    uint64_t nonce;
+    uint8_t *ring;                      // keystream blocks, block n at index n % capacity
+    size_t capacity;                    // blocks
+    uint64_t position;                  // stream offset of the next message (bytes)
+    uint64_t ring_first;                // first available block (holds the byte "position")
+    uint64_t ring_end;                  // block following the last available one
+    pthread_mutex_t mutex;
+    pthread_cond_t refill;              // signaled when the consumer frees blocks (or on exit)
+    pthread_t thread;
+    int running;
+    int thread_started;
+    uint64_t refilled_blocks;           // metrics
+    uint64_t refill_ns;
+    uint64_t inline_blocks;
+    uint64_t reservoir_bytes;
+} AES_CTR_RESERVOIR_T;
+
+typedef struct {
+    size_t capacity_blocks;
+    size_t fill_blocks;                 // keystream blocks currently available
+    uint64_t refilled_blocks;           // blocks computed by the background thread
+    double refill_rate;                 // blocks per second of the background thread (while computing)
+    uint64_t inline_blocks;             // blocks computed by the callers (reservoir empty)
+    uint64_t reservoir_bytes;           // message bytes served from the reservoir
+} AES_CTR_RESERVOIR_METRICS_T;
+
+
+/* XTS sector encryption (see AES_XTS.c) */
+typedef struct {
+    AES_KEY_CONTEXT_T data_key;
+    AES_KEY_CONTEXT_T tweak_key;
+    size_t sector_size;                 // bytes, multiple of 16
+} AES_XTS_CONTEXT_T;
+
+typedef struct {
+    uint64_t first_sector;              // sector number of input[0]
+    size_t sector_count;
+    const uint8_t *input;
+    uint8_t *output;                    // may be input itself
+} AES_XTS_RANGE_T;
+
+
+/* Scatter/gather vector element (same layout as the POSIX struct iovec) */
+typedef struct {
+    uint8_t *base;
+    size_t len;
+} AES_IOVEC_T;
+
+
+int AES_Set_Backend(AES_BACKEND_ID_T backend_id);
+const char* AES_Get_Backend_Name(void);
+
+int AES_Init_Key_Context(AES_KEY_CONTEXT_T *context, const uint8_t *key, int key_bits);
+void AES128_Init_Key_Context(AES_KEY_CONTEXT_T *context, uint64_t key_msb, uint64_t key_lsb);
+
+int AES_encryption(const AES_KEY_CONTEXT_T *context, const char* const plain_file_name, const char* const encrypted_file_name);
+int AES_decryption(const AES_KEY_CONTEXT_T *context, const char* const encrypted_file_name, const char* const decrypted_file_name);
+int AES_encryption_buffer(const AES_KEY_CONTEXT_T *context, const uint8_t *plain_data, size_t plain_size, uint8_t *encrypted_data, size_t *encrypted_size);
+int AES_decryption_buffer(const AES_KEY_CONTEXT_T *context, const uint8_t *encrypted_data, size_t encrypted_size, uint8_t *decrypted_data, size_t *decrypted_size);
+int AES_encryption_in_place(const AES_KEY_CONTEXT_T *context, uint8_t *data, size_t data_size, size_t buffer_size, size_t *encrypted_size);
+int AES_decryption_in_place(const AES_KEY_CONTEXT_T *context, uint8_t *data, size_t data_size, size_t *decrypted_size);
+int AES_encryption_iov(const AES_KEY_CONTEXT_T *context, const AES_IOVEC_T *plain_iov, int plain_iov_count,
+                       const AES_IOVEC_T *encrypted_iov, int encrypted_iov_count, size_t *encrypted_size);
+int AES_decryption_iov(const AES_KEY_CONTEXT_T *context, const AES_IOVEC_T *encrypted_iov, int encrypted_iov_count,
+                       const AES_IOVEC_T *decrypted_iov, int decrypted_iov_count, size_t *decrypted_size);
+int AES_decryption_range(const AES_KEY_CONTEXT_T *context, const char* const encrypted_file_name, uint64_t offset, size_t length,
+                         uint8_t *decrypted_data, size_t *decrypted_size);
+int AES_CTR_encryption(const AES_KEY_CONTEXT_T *context, const char* const plain_file_name, uint64_t nonce, const char* const encrypted_file_name, int threads);
+int AES_CTR_decryption(const AES_KEY_CONTEXT_T *context, const char* const encrypted_file_name, uint64_t nonce, const char* const decrypted_file_name, int threads);
+int AES_CTR_decryption_range(const AES_KEY_CONTEXT_T *context, const char* const encrypted_file_name, uint64_t nonce, uint64_t offset, size_t length,
+                             uint8_t *decrypted_data, size_t *decrypted_size);
+
+int AES_encryption_batch(AES_BATCH_RECORD_T *records, int record_count);
+int AES_decryption_batch(AES_BATCH_RECORD_T *records, int record_count);
+
+int AES_CTR_Reservoir_Init(AES_CTR_RESERVOIR_T *reservoir, const AES_KEY_CONTEXT_T *context, uint64_t nonce, size_t capacity_blocks);
+int AES_CTR_Reservoir_Process(AES_CTR_RESERVOIR_T *reservoir, const uint8_t *input, uint8_t *output, size_t size, uint64_t *stream_offset);
+void AES_CTR_Reservoir_Get_Metrics(AES_CTR_RESERVOIR_T *reservoir, AES_CTR_RESERVOIR_METRICS_T *metrics);
+void AES_CTR_Reservoir_Free(AES_CTR_RESERVOIR_T *reservoir);
+
+int AES_CBC_encryption_buffer(const AES_KEY_CONTEXT_T *context, const uint8_t *iv, const uint8_t *plain_data, size_t plain_size,
+                              uint8_t *encrypted_data, size_t *encrypted_size);
+int AES_CBC_decryption_buffer(const AES_KEY_CONTEXT_T *context, const uint8_t *iv, const uint8_t *encrypted_data, size_t encrypted_size,
+                              uint8_t *decrypted_data, size_t *decrypted_size, int threads);
+int AES_CBC_encryption_multi(const AES_KEY_CONTEXT_T *context, AES_CBC_MESSAGE_T *messages, int message_count);
+int AES_CBC_encryption(const AES_KEY_CONTEXT_T *context, const char* const plain_file_name, const uint8_t *iv, const char* const encrypted_file_name);
+int AES_CBC_decryption(const AES_KEY_CONTEXT_T *context, const char* const encrypted_file_name, const char* const decrypted_file_name, int threads);
+
+int AES_GCM_Set_GHASH(AES_GHASH_ID_T ghash_id);
+const char* AES_GCM_Get_GHASH_Name(void);
+int AES_GCM_encryption_buffer(const AES_KEY_CONTEXT_T *context, const uint8_t *iv, size_t iv_size, const uint8_t *aad, size_t aad_size,
+                              const uint8_t *plain_data, size_t size, uint8_t *encrypted_data, uint8_t *tag);
+int AES_GCM_decryption_buffer(const AES_KEY_CONTEXT_T *context, const uint8_t *iv, size_t iv_size, const uint8_t *aad, size_t aad_size,
+                              const uint8_t *encrypted_data, size_t size, uint8_t *decrypted_data, const uint8_t *tag);
+int AES_GCM_encryption(const AES_KEY_CONTEXT_T *context, const char* const plain_file_name, const uint8_t *iv, const char* const encrypted_file_name);
+int AES_GCM_decryption(const AES_KEY_CONTEXT_T *context, const char* const encrypted_file_name, const char* const decrypted_file_name);
+
+int AES_XTS_Init_Context(AES_XTS_CONTEXT_T *xts, const uint8_t *key, int key_bits, size_t sector_size);
+void AES_XTS_encryption_sectors(const AES_XTS_CONTEXT_T *xts, uint64_t first_sector, const uint8_t *input, uint8_t *output, size_t sector_count);
+void AES_XTS_decryption_sectors(const AES_XTS_CONTEXT_T *xts, uint64_t first_sector, const uint8_t *input, uint8_t *output, size_t sector_count);
+int AES_XTS_process_ranges(const AES_XTS_CONTEXT_T *xts, const AES_XTS_RANGE_T *ranges, int range_count, int mode, int threads);
+int AES_XTS_read_sectors(const AES_XTS_CONTEXT_T *xts, const char* const image_file_name, uint64_t first_sector, uint8_t *data, size_t sector_count);
+int AES_XTS_write_sectors(const AES_XTS_CONTEXT_T *xts, const char* const image_file_name, uint64_t first_sector, const uint8_t *data, size_t sector_count);
+int AES_XTS_encryption(const AES_XTS_CONTEXT_T *xts, const char* const plain_file_name, const char* const encrypted_file_name, int threads);
+int AES_XTS_decryption(const AES_XTS_CONTEXT_T *xts, const char* const encrypted_file_name, const char* const decrypted_file_name, int threads);
+
+void AES_ECB_Stream_Init(AES_STREAM_T *stream, const AES_KEY_CONTEXT_T *context, int mode);
+void AES_CTR_Stream_Init(AES_STREAM_T *stream, const AES_KEY_CONTEXT_T *context, uint64_t nonce);
+int AES_Stream_Update(AES_STREAM_T *stream, const uint8_t *input, size_t input_size, uint8_t *output, size_t *output_size);
+int AES_Stream_Final(AES_STREAM_T *stream, uint8_t *output, size_t *output_size);
+int AES_Stream_File(AES_STREAM_T *stream, FILE *input_file, FILE *output_file);
+
+/* same functions, with the key schedule computed on each call */
 int AES128_encryption(const char* const plain_file_name, uint64_t key_msb, uint64_t key_lsb, const char* const encrypted_file_name);
 int AES128_decryption(const char* const encrypted_file_name, uint64_t key_msb, uint64_t key_lsb, const char* const decrypted_file_name);
+int AES128_decryption_range(const char* const encrypted_file_name, uint64_t key_msb, uint64_t key_lsb, uint64_t offset, size_t length,
+                            uint8_t *decrypted_data, size_t *decrypted_size);
+
+size_t AES_Encrypted_Size(size_t plain_size);
+int AES128_encryption_buffer(const uint8_t *plain_data, size_t plain_size, uint64_t key_msb, uint64_t key_lsb, uint8_t *encrypted_data, size_t *encrypted_size);
+int AES128_decryption_buffer(const uint8_t *encrypted_data, size_t encrypted_size, uint64_t key_msb, uint64_t key_lsb, uint8_t *decrypted_data, size_t *decrypted_size);
+int AES128_encryption_in_place(uint8_t *data, size_t data_size, size_t buffer_size, uint64_t key_msb, uint64_t key_lsb, size_t *encrypted_size);
+int AES128_decryption_in_place(uint8_t *data, size_t data_size, uint64_t key_msb, uint64_t key_lsb, size_t *decrypted_size);
+int AES128_encryption_iov(const AES_IOVEC_T *plain_iov, int plain_iov_count, uint64_t key_msb, uint64_t key_lsb,
+                          const AES_IOVEC_T *encrypted_iov, int encrypted_iov_count, size_t *encrypted_size);
+int AES128_decryption_iov(const AES_IOVEC_T *encrypted_iov, int encrypted_iov_count, uint64_t key_msb, uint64_t key_lsb,
+                          const AES_IOVEC_T *decrypted_iov, int decrypted_iov_count, size_t *decrypted_size);
+
+int AES128_CTR_encryption(const char* const plain_file_name, uint64_t key_msb, uint64_t key_lsb, uint64_t nonce, const char* const encrypted_file_name, int threads);
+int AES128_CTR_decryption(const char* const encrypted_file_name, uint64_t key_msb, uint64_t key_lsb, uint64_t nonce, const char* const decrypted_file_name, int threads);
+int AES128_CTR_decryption_range(const char* const encrypted_file_name, uint64_t key_msb, uint64_t key_lsb, uint64_t nonce, uint64_t offset, size_t length,
+                                uint8_t *decrypted_data, size_t *decrypted_size);
+
 void AES_test(void);
 
 
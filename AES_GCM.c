@@ -0,0 +1,592 @@
+/*
+    AES-GCM authenticated encryption (NIST SP 800-38D), for any AES key size.
+
+    The data is encrypted in CTR mode (32-bits counter) and authenticated with GHASH in the same pass:
+    each chunk of blocks is encrypted and hashed while it is still in the cache.
+    GHASH uses the PCLMULQDQ instruction when available (8 blocks multiplied by H^8..H^1 and reduced
+    once), and a 4-bits table multiplication (V. Shoup) otherwise.
+
+    File format: IV (12 bytes) || encrypted data || tag (16 bytes).
+*/
+#include "AES_backends.h"
+
+#if AES_X86_BACKENDS
+#include <immintrin.h>
+#endif
+
+
+#define GHASH_TARGET            __attribute__((target("pclmul,sse2,ssse3")))
+#define GHASH_AGGREGATE         8           // number of blocks per reduction (clmul path)
+
+#define AES_GCM_MAX_BLOCKS      0xFFFFFFFEULL       // 32-bits counter: at most 2^32 - 2 blocks of data
+
+
+typedef struct {
+    int use_clmul;
+    uint64_t HL[16];                        // 4-bits tables: multiples of H (low and high halves)
+    uint64_t HH[16];
+    uint8_t H_powers[GHASH_AGGREGATE][16];  // H^1..H^8, byte-reflected (clmul path)
+} GHASH_KEY_T;
+
+
+typedef struct {
+    const AES_KEY_CONTEXT_T *context;
+    GHASH_KEY_T ghash_key;
+    AES_Block_Struct J0;                    // pre-counter block
+    uint32_t counter;                       // counter of the next data block
+    uint8_t Y[16];                          // GHASH accumulator
+    uint64_t aad_size;
+    uint64_t data_size;
+} GCM_STATE_T;
+
+
+
+/*
+    Portable GHASH: multiplication by H with 4-bits tables (16 multiples of H, 256 bytes).
+    The table lookups depend on the data: use the PCLMULQDQ path where timing attacks matter.
+*/
+static const uint64_t ghash_last4[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+
+static uint64_t load_64_be(const uint8_t *data)
+{
+    uint64_t value = 0;
+    for(int i = 0; i < 8; i++){
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+static void store_64_be(uint8_t *data, uint64_t value)
+{
+    for(int i = 7; i >= 0; i--){
+        data[i] = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+
+static void GHASH_Table_Init(GHASH_KEY_T *key, const uint8_t *H)
+{
+    uint64_t vh = load_64_be(&H[0]);
+    uint64_t vl = load_64_be(&H[8]);
+
+    key->HH[0] = 0;
+    key->HL[0] = 0;
+    key->HH[8] = vh;
+    key->HL[8] = vl;
+
+    /* H.x, H.x^2, H.x^3 (bit-reflected: multiplication by x = right shift) */
+    for(int i = 4; i > 0; i >>= 1){
+        uint64_t T = (vl & 1) * 0xe1000000ULL;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ (T << 32);
+        key->HH[i] = vh;
+        key->HL[i] = vl;
+    }
+
+    /* other entries by linearity */
+    for(int i = 2; i <= 8; i *= 2){
+        for(int j = 1; j < i; j++){
+            key->HH[i+j] = key->HH[i] ^ key->HH[j];
+            key->HL[i+j] = key->HL[i] ^ key->HL[j];
+        }
+    }
+}
+
+
+/* Y = Y.H */
+static void GHASH_Table_Multiply(const GHASH_KEY_T *key, uint8_t *Y)
+{
+    uint8_t lo = Y[15] & 0xf;
+    uint64_t zh = key->HH[lo];
+    uint64_t zl = key->HL[lo];
+
+    for(int i = 15; i >= 0; i--){
+        uint8_t hi = Y[i] >> 4;
+        uint8_t rem;
+        lo = Y[i] & 0xf;
+
+        if(i != 15){
+            rem = (uint8_t)zl & 0xf;
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ (ghash_last4[rem] << 48);
+            zh ^= key->HH[lo];
+            zl ^= key->HL[lo];
+        }
+
+        rem = (uint8_t)zl & 0xf;
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ (ghash_last4[rem] << 48);
+        zh ^= key->HH[hi];
+        zl ^= key->HL[hi];
+    }
+
+    store_64_be(&Y[0], zh);
+    store_64_be(&Y[8], zl);
+}
+
+
+
+#if AES_X86_BACKENDS
+
+/*
+    PCLMULQDQ GHASH (Intel white paper "Carry-Less Multiplication and Its Usage for Computing the GCM Mode").
+    The blocks are byte-reflected when loaded; the 256-bits products are shifted left by one bit before
+    the reduction to account for the bit reflection of GCM.
+*/
+GHASH_TARGET static inline __m128i byte_reflect(__m128i x)
+{
+    return _mm_shuffle_epi8(x, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+GHASH_TARGET static inline void clmul_accumulate(__m128i a, __m128i b, __m128i *lo, __m128i *mid, __m128i *hi)
+{
+    *lo ^= _mm_clmulepi64_si128(a, b, 0x00);
+    *hi ^= _mm_clmulepi64_si128(a, b, 0x11);
+    *mid ^= _mm_clmulepi64_si128(a, b, 0x10) ^ _mm_clmulepi64_si128(a, b, 0x01);
+}
+
+/*
+    Reduction of the (lo, mid, hi) product modulo x^128 + x^7 + x^2 + x + 1; being linear, it can be applied
+    once to the sum of several products.
+*/
+GHASH_TARGET static __m128i ghash_reduce(__m128i lo, __m128i mid, __m128i hi)
+{
+    __m128i t7, t8, t9, t2;
+
+    lo ^= _mm_slli_si128(mid, 8);
+    hi ^= _mm_srli_si128(mid, 8);
+
+    /* shift the 256-bits value (hi:lo) left by one bit */
+    t7 = _mm_srli_epi32(lo, 31);
+    t8 = _mm_srli_epi32(hi, 31);
+    lo = _mm_slli_epi32(lo, 1);
+    hi = _mm_slli_epi32(hi, 1);
+    t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    lo |= t7;
+    hi |= t8 | t9;
+
+    /* first phase */
+    t7 = _mm_slli_epi32(lo, 31) ^ _mm_slli_epi32(lo, 30) ^ _mm_slli_epi32(lo, 25);
+    t8 = _mm_srli_si128(t7, 4);
+    lo ^= _mm_slli_si128(t7, 12);
+
+    /* second phase */
+    t2 = _mm_srli_epi32(lo, 1) ^ _mm_srli_epi32(lo, 2) ^ _mm_srli_epi32(lo, 7) ^ t8;
+
+    return hi ^ lo ^ t2;
+}
+
+GHASH_TARGET static __m128i ghash_multiply(__m128i a, __m128i b)
+{
+    __m128i lo = _mm_setzero_si128(), mid = _mm_setzero_si128(), hi = _mm_setzero_si128();
+
+    clmul_accumulate(a, b, &lo, &mid, &hi);
+    return ghash_reduce(lo, mid, hi);
+}
+
+
+GHASH_TARGET static void GHASH_Clmul_Init(GHASH_KEY_T *key, const uint8_t *H)
+{
+    __m128i h = byte_reflect(_mm_loadu_si128((const __m128i*)H));
+    __m128i power = h;
+
+    for(int i = 0; i < GHASH_AGGREGATE; i++){
+        _mm_storeu_si128((__m128i*)key->H_powers[i], power);
+        power = ghash_multiply(power, h);
+    }
+}
+
+
+/*
+    Y = (...((Y ^ X1).H ^ X2).H ...).H computed as (Y ^ X1).H^8 ^ X2.H^7 ^ ... ^ X8.H for each group of 8 blocks.
+*/
+GHASH_TARGET static void GHASH_Clmul_Update(const GHASH_KEY_T *key, uint8_t *Y, const uint8_t *data, size_t block_count)
+{
+    __m128i y = byte_reflect(_mm_loadu_si128((const __m128i*)Y));
+    __m128i H_powers[GHASH_AGGREGATE];
+    size_t i = 0;
+
+    for(int j = 0; j < GHASH_AGGREGATE; j++){
+        H_powers[j] = _mm_loadu_si128((const __m128i*)key->H_powers[j]);
+    }
+
+    for(; i + GHASH_AGGREGATE <= block_count; i += GHASH_AGGREGATE){
+        __m128i lo = _mm_setzero_si128(), mid = _mm_setzero_si128(), hi = _mm_setzero_si128();
+
+        #pragma GCC unroll 8
+        for(int j = 0; j < GHASH_AGGREGATE; j++){
+            __m128i x = byte_reflect(_mm_loadu_si128((const __m128i*)&data[16*(i+j)]));
+            if(j == 0)
+                x ^= y;
+            clmul_accumulate(x, H_powers[GHASH_AGGREGATE-1-j], &lo, &mid, &hi);
+        }
+        y = ghash_reduce(lo, mid, hi);
+    }
+
+    for(; i < block_count; i++){
+        y = ghash_multiply(y ^ byte_reflect(_mm_loadu_si128((const __m128i*)&data[16*i])), H_powers[0]);
+    }
+
+    _mm_storeu_si128((__m128i*)Y, byte_reflect(y));
+}
+
+#endif      // AES_X86_BACKENDS
+
+
+
+/*
+    GHASH implementation used by the next GCM operations (the key tables are built for each message).
+*/
+static AES_GHASH_ID_T ghash_selection = AES_GHASH_AUTO;
+
+static int clmul_is_supported(void)
+{
+#if AES_X86_BACKENDS
+    return cpu_has_feature(CPU_FEATURE_PCLMULQDQ) && cpu_has_feature(CPU_FEATURE_SSSE3);
+#else
+    return 0;
+#endif
+}
+
+
+/*
+    Select the GHASH implementation (AES_GHASH_TABLE forces the portable path, mainly for testing).
+
+    Return EXIT_FAILURE if the implementation is not supported by this CPU (the current one is kept).
+*/
+int AES_GCM_Set_GHASH(AES_GHASH_ID_T ghash_id)
+{
+    if((ghash_id == AES_GHASH_CLMUL) && (clmul_is_supported() == 0)){
+        return EXIT_FAILURE;
+    }
+
+    ghash_selection = ghash_id;
+    return EXIT_SUCCESS;
+}
+
+
+const char* AES_GCM_Get_GHASH_Name(void)
+{
+    return ((ghash_selection != AES_GHASH_TABLE) && clmul_is_supported()) ? "PCLMULQDQ" : "4-bits tables";
+}
+
+
+static void GHASH_Init(GHASH_KEY_T *key, const uint8_t *H)
+{
+    key->use_clmul = 0;
+
+#if AES_X86_BACKENDS
+    if((ghash_selection != AES_GHASH_TABLE) && clmul_is_supported()){
+        key->use_clmul = 1;
+        GHASH_Clmul_Init(key, H);
+        return;
+    }
+#endif
+
+    GHASH_Table_Init(key, H);
+}
+
+
+/*
+    Hash "block_count" full blocks into Y.
+*/
+static void GHASH_Update(const GHASH_KEY_T *key, uint8_t *Y, const uint8_t *data, size_t block_count)
+{
+#if AES_X86_BACKENDS
+    if(key->use_clmul){
+        GHASH_Clmul_Update(key, Y, data, block_count);
+        return;
+    }
+#endif
+
+    for(size_t i = 0; i < block_count; i++){
+        AES_Xor_Bytes(Y, &data[16*i], 16);
+        GHASH_Table_Multiply(key, Y);
+    }
+}
+
+
+/*
+    Hash "size" bytes, the last incomplete block being padded with zeros.
+*/
+static void GHASH_Update_Padded(const GHASH_KEY_T *key, uint8_t *Y, const uint8_t *data, size_t size)
+{
+    GHASH_Update(key, Y, data, size / 16);
+
+    if(size % 16){
+        uint8_t last_block[16] = {0};
+        memcpy(last_block, &data[size - size%16], size % 16);
+        GHASH_Update(key, Y, last_block, 1);
+    }
+}
+
+
+
+/*
+    H = E(0), J0 = IV || 0^31 || 1 for a 96-bits IV (GHASH of the IV otherwise), then hash the AAD.
+*/
+static void GCM_Start(GCM_STATE_T *state, const AES_KEY_CONTEXT_T *context, const uint8_t *iv, size_t iv_size, const uint8_t *aad, size_t aad_size)
+{
+    AES_Block_Struct block = {0, 0, 0, 0};
+    uint8_t H[16];
+
+    state->context = context;
+    context->backend->encrypt_blocks(&block, 1, context);
+    AES_Store_Blocks(&block, H, 1);
+    GHASH_Init(&state->ghash_key, H);
+
+    if(iv_size == 12){
+        uint8_t J0[16] = {0};
+        memcpy(J0, iv, 12);
+        J0[15] = 1;
+        AES_Load_Blocks(J0, &state->J0, 1);
+    }
+    else{
+        uint8_t J0[16] = {0};
+        uint8_t length_block[16] = {0};
+
+        GHASH_Update_Padded(&state->ghash_key, J0, iv, iv_size);
+        store_64_be(&length_block[8], (uint64_t)iv_size * 8);
+        GHASH_Update(&state->ghash_key, J0, length_block, 1);
+        AES_Load_Blocks(J0, &state->J0, 1);
+    }
+    state->counter = state->J0.w3 + 1;
+
+    memset(state->Y, 0, 16);
+    GHASH_Update_Padded(&state->ghash_key, state->Y, aad, aad_size);
+    state->aad_size = aad_size;
+    state->data_size = 0;
+}
+
+
+/*
+    Encrypt or decrypt "size" bytes: "size" must be a multiple of 16 except for the last call.
+    The ciphertext is hashed (after the encryption, or before the decryption: input and output may be the same buffer).
+*/
+static void GCM_Process(GCM_STATE_T *state, const uint8_t *input, uint8_t *output, size_t size, int mode)
+{
+    const AES_KEY_CONTEXT_T *context = state->context;
+    AES_Block_Struct blocks[AES_FILE_CHUNK_BLOCKS];
+    uint8_t keystream[16 * AES_FILE_CHUNK_BLOCKS];
+
+    for(size_t offset = 0; offset < size; offset += 16 * AES_FILE_CHUNK_BLOCKS){
+        size_t chunk_size = __min_(16 * AES_FILE_CHUNK_BLOCKS, size - offset);
+        size_t count = (chunk_size + 15) / 16;
+
+        for(size_t i = 0; i < count; i++){
+            blocks[i] = state->J0;
+            blocks[i].w3 = state->counter + (uint32_t)i;        // inc32: the counter wraps modulo 2^32
+        }
+        state->counter += (uint32_t)count;
+
+        context->backend->encrypt_blocks(blocks, count, context);
+        AES_Store_Blocks(blocks, keystream, count);
+
+        if(mode == AES_DECRYPTION_MODE)
+            GHASH_Update_Padded(&state->ghash_key, state->Y, &input[offset], chunk_size);
+
+        if(output != input)
+            memcpy(&output[offset], &input[offset], chunk_size);
+        AES_Xor_Bytes(&output[offset], keystream, chunk_size);
+
+        if(mode == AES_ENCRYPTION_MODE)
+            GHASH_Update_Padded(&state->ghash_key, state->Y, &output[offset], chunk_size);
+    }
+
+    state->data_size += size;
+}
+
+
+/*
+    tag = E(J0) ^ GHASH(AAD, C, lengths)
+*/
+static void GCM_Finish(GCM_STATE_T *state, uint8_t *tag)
+{
+    uint8_t length_block[16];
+    AES_Block_Struct block = state->J0;
+
+    store_64_be(&length_block[0], state->aad_size * 8);
+    store_64_be(&length_block[8], state->data_size * 8);
+    GHASH_Update(&state->ghash_key, state->Y, length_block, 1);
+
+    state->context->backend->encrypt_blocks(&block, 1, state->context);
+    AES_Store_Blocks(&block, tag, 1);
+    AES_Xor_Bytes(tag, state->Y, 16);
+}
+
+
+/* constant-time comparison of two tags */
+static int tags_match(const uint8_t *a, const uint8_t *b)
+{
+    uint8_t difference = 0;
+
+    for(int i = 0; i < AES_GCM_TAG_SIZE; i++){
+        difference |= a[i] ^ b[i];
+    }
+    return difference == 0;
+}
+
+
+
+/*
+    Authenticated encryption of a memory buffer.
+
+    Parameters:
+        - iv             : initialization vector (AES_GCM_IV_SIZE bytes recommended), never reused with the same key
+        - aad            : additional data, authenticated but not encrypted (may be NULL if aad_size is 0)
+        - encrypted_data : output buffer of "size" bytes; it may be plain_data itself
+        - tag            : authentication tag (AES_GCM_TAG_SIZE bytes)
+*/
+int AES_GCM_encryption_buffer(const AES_KEY_CONTEXT_T *context, const uint8_t *iv, size_t iv_size, const uint8_t *aad, size_t aad_size,
+                              const uint8_t *plain_data, size_t size, uint8_t *encrypted_data, uint8_t *tag)
+{
+    if(  (iv == NULL) || (iv_size == 0) || ((uint64_t)size > 16 * AES_GCM_MAX_BLOCKS)  ){
+        printf("AES Error: invalid GCM parameters.\n");
+        return EXIT_FAILURE;
+    }
+
+    GCM_STATE_T state;
+    GCM_Start(&state, context, iv, iv_size, aad, aad_size);
+    GCM_Process(&state, plain_data, encrypted_data, size, AES_ENCRYPTION_MODE);
+    GCM_Finish(&state, tag);
+
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    Authenticated decryption of a memory buffer.
+    If the tag does not match, EXIT_FAILURE is returned and the output buffer is cleared.
+*/
+int AES_GCM_decryption_buffer(const AES_KEY_CONTEXT_T *context, const uint8_t *iv, size_t iv_size, const uint8_t *aad, size_t aad_size,
+                              const uint8_t *encrypted_data, size_t size, uint8_t *decrypted_data, const uint8_t *tag)
+{
+    if(  (iv == NULL) || (iv_size == 0) || ((uint64_t)size > 16 * AES_GCM_MAX_BLOCKS)  ){
+        printf("AES Error: invalid GCM parameters.\n");
+        return EXIT_FAILURE;
+    }
+
+    uint8_t computed_tag[AES_GCM_TAG_SIZE];
+    GCM_STATE_T state;
+    GCM_Start(&state, context, iv, iv_size, aad, aad_size);
+    GCM_Process(&state, encrypted_data, decrypted_data, size, AES_DECRYPTION_MODE);
+    GCM_Finish(&state, computed_tag);
+
+    if(tags_match(computed_tag, tag) == 0){
+        memset(decrypted_data, 0, size);
+        printf("AES Error: authentication failed.\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+
+/*
+    Authenticated encryption of a file: IV || encrypted data || tag.
+*/
+int AES_GCM_encryption(const AES_KEY_CONTEXT_T *context, const char* const plain_file_name, const uint8_t *iv, const char* const encrypted_file_name)
+{
+    FILE *plain_file = fopen(plain_file_name, "rb");
+    FILE *encrypted_file = fopen(encrypted_file_name, "wb");
+    int64_t filesize = get_filesize_64(plain_file_name);
+
+    if(  (plain_file == NULL) || (encrypted_file == NULL) || (filesize == -1)  ){
+        if(plain_file != NULL)
+            fclose(plain_file);
+        if(encrypted_file != NULL)
+            fclose(encrypted_file);
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+    if((uint64_t)filesize > 16 * AES_GCM_MAX_BLOCKS){
+        printf("AES Error: file too large for GCM.\n");
+        fclose(plain_file);
+        fclose(encrypted_file);
+        return EXIT_FAILURE;
+    }
+
+    GCM_STATE_T state;
+    GCM_Start(&state, context, iv, AES_GCM_IV_SIZE, NULL, 0);
+    fwrite(iv, sizeof(uint8_t), AES_GCM_IV_SIZE, encrypted_file);
+
+    uint8_t data_buffer[16 * AES_FILE_CHUNK_BLOCKS];
+    size_t size;
+
+    while(  (size = fread(data_buffer, sizeof(uint8_t), sizeof(data_buffer), plain_file)) > 0  ){
+        GCM_Process(&state, data_buffer, data_buffer, size, AES_ENCRYPTION_MODE);
+        fwrite(data_buffer, sizeof(uint8_t), size, encrypted_file);
+    }
+
+    uint8_t tag[AES_GCM_TAG_SIZE];
+    GCM_Finish(&state, tag);
+    fwrite(tag, sizeof(uint8_t), AES_GCM_TAG_SIZE, encrypted_file);
+
+    fclose(plain_file);
+    fclose(encrypted_file);
+
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    Authenticated decryption of a file.
+    The data is decrypted and authenticated in a single pass: if the tag does not match, the output
+    file is deleted and EXIT_FAILURE is returned.
+*/
+int AES_GCM_decryption(const AES_KEY_CONTEXT_T *context, const char* const encrypted_file_name, const char* const decrypted_file_name)
+{
+    FILE *encrypted_file = fopen(encrypted_file_name, "rb");
+    FILE *decrypted_file = fopen(decrypted_file_name, "wb");
+    int64_t filesize = get_filesize_64(encrypted_file_name);
+
+    if(  (encrypted_file == NULL) || (decrypted_file == NULL) || (filesize < AES_GCM_IV_SIZE + AES_GCM_TAG_SIZE)  ){
+        if(encrypted_file != NULL)
+            fclose(encrypted_file);
+        if(decrypted_file != NULL)
+            fclose(decrypted_file);
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+
+    uint8_t iv[AES_GCM_IV_SIZE];
+    fread(iv, sizeof(uint8_t), AES_GCM_IV_SIZE, encrypted_file);
+
+    GCM_STATE_T state;
+    GCM_Start(&state, context, iv, AES_GCM_IV_SIZE, NULL, 0);
+
+    uint8_t data_buffer[16 * AES_FILE_CHUNK_BLOCKS];
+    uint64_t remaining = (uint64_t)filesize - AES_GCM_IV_SIZE - AES_GCM_TAG_SIZE;
+
+    while(remaining > 0){
+        size_t size = (size_t)__min_((uint64_t)sizeof(data_buffer), remaining);
+
+        fread(data_buffer, sizeof(uint8_t), size, encrypted_file);
+        GCM_Process(&state, data_buffer, data_buffer, size, AES_DECRYPTION_MODE);
+        fwrite(data_buffer, sizeof(uint8_t), size, decrypted_file);
+        remaining -= size;
+    }
+
+    uint8_t tag[AES_GCM_TAG_SIZE], computed_tag[AES_GCM_TAG_SIZE];
+    fread(tag, sizeof(uint8_t), AES_GCM_TAG_SIZE, encrypted_file);
+    GCM_Finish(&state, computed_tag);
+
+    fclose(encrypted_file);
+    fclose(decrypted_file);
+
+    if(tags_match(computed_tag, tag) == 0){
+        remove(decrypted_file_name);
+        printf("AES Error: authentication failed.\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,404 @@
+/*
+    AES backend using the x86 AES-NI instructions (AESENC, AESDEC, AESKEYGENASSIST, AESIMC).
+
+    The AES_Block_Struct columns are big-endian words, so blocks and keys are byte-swapped word by word
+    (PSHUFB) when moved into the xmm registers.
+    Independent blocks are processed 8 at a time to hide the AESENC/AESDEC latency.
+*/
+#include "AES_backends.h"
+
+#if AES_X86_BACKENDS
+
+#include <immintrin.h>
+
+
+#define AESNI_TARGET            __attribute__((target("aes,ssse3")))
+#define AESNI_PIPELINE_DEPTH    8           // number of blocks in flight
+
+
+static int AESNI_Is_Supported(void)
+{
+    return cpu_has_feature(CPU_FEATURE_AESNI) && cpu_has_feature(CPU_FEATURE_SSSE3);
+}
+
+
+AESNI_TARGET static inline __m128i word_swap_mask(void)
+{
+    return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+}
+
+AESNI_TARGET static inline __m128i load_block(const AES_Block_Struct *block)
+{
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)block), word_swap_mask());
+}
+
+AESNI_TARGET static inline void store_block(AES_Block_Struct *block, __m128i data)
+{
+    _mm_storeu_si128((__m128i*)block, _mm_shuffle_epi8(data, word_swap_mask()));
+}
+
+/* round_keys[0] = private key, round_keys[1..rounds] = sub-keys */
+AESNI_TARGET static void load_round_keys(const AES_Block_Struct *private_key, const AES_Block_Struct *sub_keys, int rounds, __m128i *round_keys)
+{
+    round_keys[0] = load_block(private_key);
+    for(int i = 0; i < rounds; i++){
+        round_keys[i+1] = load_block(&sub_keys[i]);
+    }
+}
+
+
+
+/*
+    AES-128 key expansion: one AESKEYGENASSIST per sub-key (the rcon value must be an immediate).
+*/
+AESNI_TARGET static inline __m128i expand_step(__m128i key, __m128i assist)
+{
+    assist = _mm_shuffle_epi32(assist, _MM_SHUFFLE(3, 3, 3, 3));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+#define AESNI_EXPAND(i, rcon)       key = expand_step(key, _mm_aeskeygenassist_si128(key, rcon)); store_block(&sub_keys[i], key)
+
+AESNI_TARGET static void expand_key_128(const AES_Block_Struct *private_key, AES_Block_Struct *sub_keys)
+{
+    __m128i key = load_block(private_key);
+
+    AESNI_EXPAND(0, 0x01);
+    AESNI_EXPAND(1, 0x02);
+    AESNI_EXPAND(2, 0x04);
+    AESNI_EXPAND(3, 0x08);
+    AESNI_EXPAND(4, 0x10);
+    AESNI_EXPAND(5, 0x20);
+    AESNI_EXPAND(6, 0x40);
+    AESNI_EXPAND(7, 0x80);
+    AESNI_EXPAND(8, 0x1b);
+    AESNI_EXPAND(9, 0x36);
+}
+
+
+/*
+    S-box applied to the 4 bytes of a word: AESKEYGENASSIST returns SubWord() of its second column in the first one.
+*/
+AESNI_TARGET static uint32_t AESNI_Sub_Word(uint32_t word)
+{
+    __m128i x = _mm_set1_epi32((int)switch_endianness_32(word));
+
+    return switch_endianness_32((uint32_t)_mm_cvtsi128_si32(_mm_aeskeygenassist_si128(x, 0)));
+}
+
+
+/*
+    AES-192 and AES-256 use the generic key expansion with the AES-NI S-box.
+*/
+AESNI_TARGET static void AESNI_Expand_Key(const uint32_t *key, int key_words, AES_Block_Struct *sub_keys)
+{
+    if(key_words == 4){
+        AES_Block_Struct private_key = {key[0], key[1], key[2], key[3]};
+        expand_key_128(&private_key, sub_keys);
+    }
+    else{
+        AES_Expand_Key(key, key_words, AESNI_Sub_Word, sub_keys);
+    }
+}
+
+
+/*
+    Multi-key expansion of AES-128 keys. AESKEYGENASSIST has a low throughput on many CPUs, so the SubWord
+    step uses AESENCLAST instead (as in OpenSSL): with RotWord(w3) broadcast to the 4 columns, ShiftRows
+    has no effect and AESENCLAST returns SubWord(RotWord(w3)) ^ rcon. The chains of 8 keys are interleaved.
+*/
+AESNI_TARGET static void expand_keys_128_multi(const uint32_t *const *keys, AES_Block_Struct *const *sub_keys, int count)
+{
+    static const int rcon[10] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36};
+    const __m128i rotate_mask = _mm_set1_epi32(0x0c0f0e0d);
+    __m128i k[AESNI_PIPELINE_DEPTH];
+
+    for(int j = 0; j < count; j++){
+        AES_Block_Struct private_key = {keys[j][0], keys[j][1], keys[j][2], keys[j][3]};
+        k[j] = load_block(&private_key);
+    }
+
+    for(int i = 0; i < 10; i++){
+        for(int j = 0; j < count; j++){
+            __m128i t = _mm_aesenclast_si128(_mm_shuffle_epi8(k[j], rotate_mask), _mm_set1_epi32(rcon[i]));
+            k[j] = _mm_xor_si128(k[j], _mm_slli_si128(k[j], 4));
+            k[j] = _mm_xor_si128(k[j], _mm_slli_si128(k[j], 8));
+            k[j] = _mm_xor_si128(k[j], t);
+            store_block(&sub_keys[j][i], k[j]);
+        }
+    }
+}
+
+
+AESNI_TARGET static void AESNI_Expand_Keys_Multikey(const uint32_t *const *keys, int key_words, AES_Block_Struct *const *sub_keys, int count)
+{
+    if(key_words == 4){
+        expand_keys_128_multi(keys, sub_keys, count);
+        return;
+    }
+
+    for(int j = 0; j < count; j++)
+        AESNI_Expand_Key(keys[j], key_words, sub_keys[j]);
+}
+
+
+/*
+    AESDEC implements the equivalent inverse cipher: the inner round keys go through InvMixColumns (AESIMC).
+*/
+AESNI_TARGET static void AESNI_Decryption_Subkeys(const AES_Block_Struct *sub_keys, int rounds, AES_Block_Struct *decryption_sub_keys)
+{
+    for(int i = 0; i < rounds-1; i++){
+        store_block(&decryption_sub_keys[i], _mm_aesimc_si128(load_block(&sub_keys[i])));
+    }
+    decryption_sub_keys[rounds-1] = sub_keys[rounds-1];
+}
+
+
+
+/*
+    Encrypt/decrypt "n" blocks held in registers; n and rounds are compile-time constants at each call site
+    so the loops are fully unrolled and the n AESENC of a round are issued back-to-back.
+*/
+AESNI_TARGET static AES_ALWAYS_INLINE void encrypt_n(__m128i *b, int n, const __m128i *round_keys, int rounds)
+{
+    #pragma GCC unroll 8
+    for(int j = 0; j < n; j++)
+        b[j] = _mm_xor_si128(b[j], round_keys[0]);
+
+    #pragma GCC unroll 13
+    for(int r = 1; r < rounds; r++){
+        #pragma GCC unroll 8
+        for(int j = 0; j < n; j++)
+            b[j] = _mm_aesenc_si128(b[j], round_keys[r]);
+    }
+
+    #pragma GCC unroll 8
+    for(int j = 0; j < n; j++)
+        b[j] = _mm_aesenclast_si128(b[j], round_keys[rounds]);
+}
+
+AESNI_TARGET static AES_ALWAYS_INLINE void decrypt_n(__m128i *b, int n, const __m128i *round_keys, int rounds)
+{
+    #pragma GCC unroll 8
+    for(int j = 0; j < n; j++)
+        b[j] = _mm_xor_si128(b[j], round_keys[rounds]);
+
+    #pragma GCC unroll 13
+    for(int r = rounds-1; r >= 1; r--){
+        #pragma GCC unroll 8
+        for(int j = 0; j < n; j++)
+            b[j] = _mm_aesdec_si128(b[j], round_keys[r]);
+    }
+
+    #pragma GCC unroll 8
+    for(int j = 0; j < n; j++)
+        b[j] = _mm_aesdeclast_si128(b[j], round_keys[0]);
+}
+
+
+AESNI_TARGET static AES_ALWAYS_INLINE void encrypt_blocks_n(int rounds, AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context)
+{
+    __m128i round_keys[AES_MAX_ROUNDS+1];
+    __m128i b[AESNI_PIPELINE_DEPTH];
+    size_t i = 0;
+
+    load_round_keys(&context->private_key, context->sub_keys, rounds, round_keys);
+
+    for(; i + AESNI_PIPELINE_DEPTH <= count; i += AESNI_PIPELINE_DEPTH){
+        for(int j = 0; j < AESNI_PIPELINE_DEPTH; j++)
+            b[j] = load_block(&blocks[i+j]);
+
+        encrypt_n(b, AESNI_PIPELINE_DEPTH, round_keys, rounds);
+
+        for(int j = 0; j < AESNI_PIPELINE_DEPTH; j++)
+            store_block(&blocks[i+j], b[j]);
+    }
+
+    for(; i < count; i++){
+        b[0] = load_block(&blocks[i]);
+        encrypt_n(b, 1, round_keys, rounds);
+        store_block(&blocks[i], b[0]);
+    }
+}
+
+
+AESNI_TARGET static AES_ALWAYS_INLINE void decrypt_blocks_n(int rounds, AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context)
+{
+    __m128i round_keys[AES_MAX_ROUNDS+1];
+    __m128i b[AESNI_PIPELINE_DEPTH];
+    size_t i = 0;
+
+    load_round_keys(&context->private_key, context->decryption_sub_keys, rounds, round_keys);
+
+    for(; i + AESNI_PIPELINE_DEPTH <= count; i += AESNI_PIPELINE_DEPTH){
+        for(int j = 0; j < AESNI_PIPELINE_DEPTH; j++)
+            b[j] = load_block(&blocks[i+j]);
+
+        decrypt_n(b, AESNI_PIPELINE_DEPTH, round_keys, rounds);
+
+        for(int j = 0; j < AESNI_PIPELINE_DEPTH; j++)
+            store_block(&blocks[i+j], b[j]);
+    }
+
+    for(; i < count; i++){
+        b[0] = load_block(&blocks[i]);
+        decrypt_n(b, 1, round_keys, rounds);
+        store_block(&blocks[i], b[0]);
+    }
+}
+
+
+AESNI_TARGET static void AESNI_Encrypt_Blocks(AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context)
+{
+    AES_ROUNDS_SWITCH(context->rounds, encrypt_blocks_n, blocks, count, context);
+}
+
+
+AESNI_TARGET static void AESNI_Decrypt_Blocks(AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context)
+{
+    AES_ROUNDS_SWITCH(context->rounds, decrypt_blocks_n, blocks, count, context);
+}
+
+
+/*
+    Multi-key: block j is processed with contexts[j], the round keys being loaded from each context at every
+    round. A full group of 8 blocks with the same key size is fully unrolled (blocks kept in registers); the
+    other groups may mix key sizes, each block getting its AESENCLAST at its own last round.
+*/
+AESNI_TARGET static AES_ALWAYS_INLINE void encrypt_multikey_8(int rounds, AES_Block_Struct *blocks, const AES_KEY_CONTEXT_T *const *lane)
+{
+    __m128i b[AESNI_PIPELINE_DEPTH];
+
+    #pragma GCC unroll 8
+    for(int j = 0; j < AESNI_PIPELINE_DEPTH; j++)
+        b[j] = _mm_xor_si128(load_block(&blocks[j]), load_block(&lane[j]->private_key));
+
+    #pragma GCC unroll 13
+    for(int r = 0; r < rounds-1; r++){
+        #pragma GCC unroll 8
+        for(int j = 0; j < AESNI_PIPELINE_DEPTH; j++)
+            b[j] = _mm_aesenc_si128(b[j], load_block(&lane[j]->sub_keys[r]));
+    }
+
+    #pragma GCC unroll 8
+    for(int j = 0; j < AESNI_PIPELINE_DEPTH; j++)
+        store_block(&blocks[j], _mm_aesenclast_si128(b[j], load_block(&lane[j]->sub_keys[rounds-1])));
+}
+
+AESNI_TARGET static AES_ALWAYS_INLINE void decrypt_multikey_8(int rounds, AES_Block_Struct *blocks, const AES_KEY_CONTEXT_T *const *lane)
+{
+    __m128i b[AESNI_PIPELINE_DEPTH];
+
+    #pragma GCC unroll 8
+    for(int j = 0; j < AESNI_PIPELINE_DEPTH; j++)
+        b[j] = _mm_xor_si128(load_block(&blocks[j]), load_block(&lane[j]->decryption_sub_keys[rounds-1]));
+
+    #pragma GCC unroll 13
+    for(int r = rounds-2; r >= 0; r--){
+        #pragma GCC unroll 8
+        for(int j = 0; j < AESNI_PIPELINE_DEPTH; j++)
+            b[j] = _mm_aesdec_si128(b[j], load_block(&lane[j]->decryption_sub_keys[r]));
+    }
+
+    #pragma GCC unroll 8
+    for(int j = 0; j < AESNI_PIPELINE_DEPTH; j++)
+        store_block(&blocks[j], _mm_aesdeclast_si128(b[j], load_block(&lane[j]->private_key)));
+}
+
+
+static int same_rounds(const AES_KEY_CONTEXT_T *const *lane, int n)
+{
+    for(int j = 1; j < n; j++){
+        if(lane[j]->rounds != lane[0]->rounds)
+            return 0;
+    }
+    return 1;
+}
+
+
+AESNI_TARGET static void AESNI_Encrypt_Blocks_Multikey(AES_Block_Struct *blocks, const AES_KEY_CONTEXT_T *const *contexts, size_t count)
+{
+    __m128i b[AESNI_PIPELINE_DEPTH];
+
+    for(size_t i = 0; i < count; i += AESNI_PIPELINE_DEPTH){
+        int n = (int)__min_(AESNI_PIPELINE_DEPTH, count - i);
+        const AES_KEY_CONTEXT_T *const *lane = &contexts[i];
+
+        if(  (n == AESNI_PIPELINE_DEPTH) && same_rounds(lane, n)  ){
+            AES_ROUNDS_SWITCH(lane[0]->rounds, encrypt_multikey_8, &blocks[i], lane);
+            continue;
+        }
+
+        int max_rounds = 0;
+        for(int j = 0; j < n; j++){
+            b[j] = _mm_xor_si128(load_block(&blocks[i+j]), load_block(&lane[j]->private_key));
+            max_rounds = __max_(max_rounds, lane[j]->rounds);
+        }
+
+        for(int r = 1; r <= max_rounds; r++){
+            for(int j = 0; j < n; j++){
+                if(r < lane[j]->rounds)
+                    b[j] = _mm_aesenc_si128(b[j], load_block(&lane[j]->sub_keys[r-1]));
+                else if(r == lane[j]->rounds)
+                    b[j] = _mm_aesenclast_si128(b[j], load_block(&lane[j]->sub_keys[r-1]));
+            }
+        }
+
+        for(int j = 0; j < n; j++)
+            store_block(&blocks[i+j], b[j]);
+    }
+}
+
+
+AESNI_TARGET static void AESNI_Decrypt_Blocks_Multikey(AES_Block_Struct *blocks, const AES_KEY_CONTEXT_T *const *contexts, size_t count)
+{
+    __m128i b[AESNI_PIPELINE_DEPTH];
+
+    for(size_t i = 0; i < count; i += AESNI_PIPELINE_DEPTH){
+        int n = (int)__min_(AESNI_PIPELINE_DEPTH, count - i);
+        const AES_KEY_CONTEXT_T *const *lane = &contexts[i];
+
+        if(  (n == AESNI_PIPELINE_DEPTH) && same_rounds(lane, n)  ){
+            AES_ROUNDS_SWITCH(lane[0]->rounds, decrypt_multikey_8, &blocks[i], lane);
+            continue;
+        }
+
+        int max_rounds = 0;
+        for(int j = 0; j < n; j++){
+            b[j] = _mm_xor_si128(load_block(&blocks[i+j]), load_block(&lane[j]->decryption_sub_keys[lane[j]->rounds - 1]));
+            max_rounds = __max_(max_rounds, lane[j]->rounds);
+        }
+
+        /* step s: decryption sub-key rounds-1-s of each block (the private key at its last step) */
+        for(int s = 1; s <= max_rounds; s++){
+            for(int j = 0; j < n; j++){
+                int key_index = lane[j]->rounds - 1 - s;
+                if(key_index >= 0)
+                    b[j] = _mm_aesdec_si128(b[j], load_block(&lane[j]->decryption_sub_keys[key_index]));
+                else if(key_index == -1)
+                    b[j] = _mm_aesdeclast_si128(b[j], load_block(&lane[j]->private_key));
+            }
+        }
+
+        for(int j = 0; j < n; j++)
+            store_block(&blocks[i+j], b[j]);
+    }
+}
+
+
+const AES_BACKEND_T AES_Backend_AESNI = {
+    .name = "AES-NI",
+    .is_supported = AESNI_Is_Supported,
+    .expand_key = AESNI_Expand_Key,
+    .decryption_subkeys = AESNI_Decryption_Subkeys,
+    .expand_keys_multikey = AESNI_Expand_Keys_Multikey,
+    .encrypt_blocks = AESNI_Encrypt_Blocks,
+    .decrypt_blocks = AESNI_Decrypt_Blocks,
+    .encrypt_blocks_multikey = AESNI_Encrypt_Blocks_Multikey,
+    .decrypt_blocks_multikey = AESNI_Decrypt_Blocks_Multikey
+};
+
+#endif      // AES_X86_BACKENDS
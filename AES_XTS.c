@@ -0,0 +1,387 @@
+/*
+    AES-XTS sector encryption (IEEE 1619 / NIST SP 800-38E), for disk and volume images.
+
+    The XTS key is made of two AES keys of the same size: the data key and the tweak key.
+    The volume is divided in sectors ("data units") of a fixed size, a multiple of 16 bytes; sector n is
+    processed independently of the others, with the tweak T = E_tweak_key(n) (n as a 128-bits little-endian
+    value), multiplied by x in GF(2^128) for each following block:
+        C[j] = E_data_key(P[j] ^ T.x^j) ^ T.x^j
+    Any sector can thus be read or rewritten alone, and lists of sectors are processed by worker threads.
+*/
+#include "AES_backends.h"
+
+
+#define AES_XTS_MIN_SECTORS_PER_THREAD      256         // minimum amount of work (1 MB with 4 KB sectors) given to a worker thread
+
+
+
+static uint64_t load_64_le(const uint8_t *data)
+{
+    uint64_t value = 0;
+    for(int i = 7; i >= 0; i--){
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+static void store_64_le(uint8_t *data, uint64_t value)
+{
+    for(int i = 0; i < 8; i++){
+        data[i] = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+
+/*
+    Key = data key || tweak key.
+
+    Parameters:
+        - key_bits    : 256, 384 or 512 (two AES-128, AES-192 or AES-256 keys)
+        - sector_size : size of a data unit in bytes, a non-zero multiple of 16 (512 or 4096 for disks)
+*/
+int AES_XTS_Init_Context(AES_XTS_CONTEXT_T *xts, const uint8_t *key, int key_bits, size_t sector_size)
+{
+    if(  (key_bits != 256) && (key_bits != 384) && (key_bits != 512)  ){
+        printf("AES Error: invalid key size.\n");
+        return EXIT_FAILURE;
+    }
+    if(  (sector_size == 0) || ((sector_size % 16) > 0)  ){
+        printf("AES Error: invalid XTS sector size.\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t key_size = key_bits / 16;        // bytes per AES key
+
+    /* IEEE 1619: the two keys must be different */
+    if(memcmp(key, &key[key_size], key_size) == 0){
+        printf("AES Error: the XTS data and tweak keys must be different.\n");
+        return EXIT_FAILURE;
+    }
+
+    AES_Init_Key_Context(&xts->data_key, key, key_bits / 2);
+    AES_Init_Key_Context(&xts->tweak_key, &key[key_size], key_bits / 2);
+    xts->sector_size = sector_size;
+
+    return EXIT_SUCCESS;
+}
+
+
+
+/*
+    Encrypt or decrypt one sector: the tweaks of a chunk of blocks are computed first, then the blocks
+    go through the backend together. The input and output may be the same buffer.
+*/
+static void XTS_Process_Sector(const AES_XTS_CONTEXT_T *xts, uint64_t sector, const uint8_t *input, uint8_t *output, int mode)
+{
+    const AES_KEY_CONTEXT_T *data_key = &xts->data_key;
+    AES_Block_Struct blocks[AES_FILE_CHUNK_BLOCKS];
+    uint8_t tweaks[16 * AES_FILE_CHUNK_BLOCKS];
+    size_t block_count = xts->sector_size / 16;
+    uint64_t tweak_lo, tweak_hi;
+
+    /* T = E(sector number) */
+    uint8_t tweak[16] = {0};
+    AES_Block_Struct tweak_block;
+
+    store_64_le(tweak, sector);
+    AES_Load_Blocks(tweak, &tweak_block, 1);
+    xts->tweak_key.backend->encrypt_blocks(&tweak_block, 1, &xts->tweak_key);
+    AES_Store_Blocks(&tweak_block, tweak, 1);
+    tweak_lo = load_64_le(&tweak[0]);
+    tweak_hi = load_64_le(&tweak[8]);
+
+    for(size_t i = 0; i < block_count; i += AES_FILE_CHUNK_BLOCKS){
+        size_t n = __min_(AES_FILE_CHUNK_BLOCKS, block_count - i);
+
+        for(size_t j = 0; j < n; j++){
+            store_64_le(&tweaks[16*j], tweak_lo);
+            store_64_le(&tweaks[16*j + 8], tweak_hi);
+
+            /* T = T.x modulo x^128 + x^7 + x^2 + x + 1 */
+            uint64_t carry = tweak_hi >> 63;
+            tweak_hi = (tweak_hi << 1) | (tweak_lo >> 63);
+            tweak_lo = (tweak_lo << 1) ^ (carry * 0x87);
+        }
+
+        if(output != input)
+            memcpy(&output[16*i], &input[16*i], 16*n);
+        AES_Xor_Bytes(&output[16*i], tweaks, 16*n);
+
+        AES_Load_Blocks(&output[16*i], blocks, n);
+        if(mode == AES_ENCRYPTION_MODE)
+            data_key->backend->encrypt_blocks(blocks, n, data_key);
+        else
+            data_key->backend->decrypt_blocks(blocks, n, data_key);
+        AES_Store_Blocks(blocks, &output[16*i], n);
+
+        AES_Xor_Bytes(&output[16*i], tweaks, 16*n);
+    }
+}
+
+
+/*
+    Encrypt "sector_count" consecutive sectors, starting at sector number "first_sector".
+    "input" and "output" hold sector_count * sector_size bytes; they may be the same buffer.
+*/
+void AES_XTS_encryption_sectors(const AES_XTS_CONTEXT_T *xts, uint64_t first_sector, const uint8_t *input, uint8_t *output, size_t sector_count)
+{
+    for(size_t i = 0; i < sector_count; i++){
+        XTS_Process_Sector(xts, first_sector + i, &input[i * xts->sector_size], &output[i * xts->sector_size], AES_ENCRYPTION_MODE);
+    }
+}
+
+
+void AES_XTS_decryption_sectors(const AES_XTS_CONTEXT_T *xts, uint64_t first_sector, const uint8_t *input, uint8_t *output, size_t sector_count)
+{
+    for(size_t i = 0; i < sector_count; i++){
+        XTS_Process_Sector(xts, first_sector + i, &input[i * xts->sector_size], &output[i * xts->sector_size], AES_DECRYPTION_MODE);
+    }
+}
+
+
+
+typedef struct {
+    const AES_XTS_CONTEXT_T *xts;
+    const AES_XTS_RANGE_T *ranges;
+    int range_count;
+    const uint64_t *range_starts;       // index of the first sector of each range in the whole list
+    int mode;
+} AES_XTS_RANGES_JOB_T;
+
+
+/*
+    Worker: sectors [begin, end) of the concatenated ranges.
+*/
+static void XTS_Ranges_Task(uint64_t begin, uint64_t end, void *arg)
+{
+    AES_XTS_RANGES_JOB_T *job = (AES_XTS_RANGES_JOB_T*)arg;
+    size_t sector_size = job->xts->sector_size;
+
+    /* range holding the sector "begin" */
+    int low = 0, high = job->range_count - 1;
+    while(low < high){
+        int middle = (low + high + 1) / 2;
+        if(job->range_starts[middle] <= begin)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+
+    for(int r = low; (r < job->range_count) && (job->range_starts[r] < end); r++){
+        const AES_XTS_RANGE_T *range = &job->ranges[r];
+        uint64_t first = __max_(begin, job->range_starts[r]) - job->range_starts[r];
+        uint64_t last = __min_(end, job->range_starts[r] + range->sector_count) - job->range_starts[r];
+
+        for(uint64_t i = first; i < last; i++){
+            XTS_Process_Sector(job->xts, range->first_sector + i, &range->input[i * sector_size], &range->output[i * sector_size], job->mode);
+        }
+    }
+}
+
+
+/*
+    Encrypt or decrypt a list of sector ranges (possibly scattered over the volume) with worker threads.
+    The work is split by sectors, not by ranges: a single large range is also shared between the threads.
+
+    Parameters:
+        - mode    : AES_ENCRYPTION_MODE or AES_DECRYPTION_MODE
+        - threads : number of worker threads (0 = one per CPU)
+*/
+int AES_XTS_process_ranges(const AES_XTS_CONTEXT_T *xts, const AES_XTS_RANGE_T *ranges, int range_count, int mode, int threads)
+{
+    if(range_count <= 0){
+        return EXIT_SUCCESS;
+    }
+
+    uint64_t *range_starts = (uint64_t*)malloc(range_count * sizeof(uint64_t));
+    if(range_starts == NULL){
+        printf("AES Error: memory allocation failed.\n");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t sector_count = 0;
+    for(int r = 0; r < range_count; r++){
+        if(  (ranges[r].sector_count > 0) && ((ranges[r].input == NULL) || (ranges[r].output == NULL))  ){
+            free(range_starts);
+            printf("AES Error: invalid buffer.\n");
+            return EXIT_FAILURE;
+        }
+        range_starts[r] = sector_count;
+        sector_count += ranges[r].sector_count;
+    }
+
+    if(threads <= 0){
+        threads = get_cpu_count();
+    }
+    threads = (int)__min_((uint64_t)threads, sector_count / AES_XTS_MIN_SECTORS_PER_THREAD + 1);
+
+    AES_XTS_RANGES_JOB_T job = {xts, ranges, range_count, range_starts, mode};
+    parallel_for(sector_count, threads, XTS_Ranges_Task, &job);
+
+    free(range_starts);
+
+    return EXIT_SUCCESS;
+}
+
+
+
+/*
+    Read and decrypt "sector_count" sectors of an encrypted image file, starting at sector "first_sector"
+    (sector n is stored at the offset n * sector_size).
+*/
+int AES_XTS_read_sectors(const AES_XTS_CONTEXT_T *xts, const char* const image_file_name, uint64_t first_sector, uint8_t *data, size_t sector_count)
+{
+    FILE *image_file = fopen(image_file_name, "rb");
+
+    if(  (image_file == NULL) || (file_seek_64(image_file, (int64_t)(first_sector * xts->sector_size)) == EXIT_FAILURE)  ){
+        if(image_file != NULL)
+            fclose(image_file);
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t read_count = fread(data, xts->sector_size, sector_count, image_file);
+    fclose(image_file);
+
+    if(read_count != sector_count){
+        printf("AES Error: sectors beyond the end of the image.\n");
+        return EXIT_FAILURE;
+    }
+
+    AES_XTS_decryption_sectors(xts, first_sector, data, data, sector_count);
+
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    Encrypt and write "sector_count" sectors into an image file (created if needed), without touching
+    the other sectors.
+*/
+int AES_XTS_write_sectors(const AES_XTS_CONTEXT_T *xts, const char* const image_file_name, uint64_t first_sector, const uint8_t *data, size_t sector_count)
+{
+    FILE *image_file = fopen(image_file_name, "r+b");
+    if(image_file == NULL){
+        image_file = fopen(image_file_name, "w+b");
+    }
+
+    uint8_t *encrypted_data = (uint8_t*)malloc(sector_count * xts->sector_size);
+
+    if(  (image_file == NULL) || (encrypted_data == NULL) || (file_seek_64(image_file, (int64_t)(first_sector * xts->sector_size)) == EXIT_FAILURE)  ){
+        if(image_file != NULL)
+            fclose(image_file);
+        free(encrypted_data);
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+
+    AES_XTS_encryption_sectors(xts, first_sector, data, encrypted_data, sector_count);
+    fwrite(encrypted_data, xts->sector_size, sector_count, image_file);
+
+    fclose(image_file);
+    free(encrypted_data);
+
+    return EXIT_SUCCESS;
+}
+
+
+
+typedef struct {
+    const AES_XTS_CONTEXT_T *xts;
+    const char *input_file_name;
+    const char *output_file_name;
+    int mode;
+    int error;
+} AES_XTS_FILE_JOB_T;
+
+
+/*
+    Worker: sectors [first_sector, end_sector) of the image, with its own file handles.
+*/
+static void XTS_File_Task(uint64_t first_sector, uint64_t end_sector, void *arg)
+{
+    AES_XTS_FILE_JOB_T *job = (AES_XTS_FILE_JOB_T*)arg;
+    size_t sector_size = job->xts->sector_size;
+    size_t chunk_sectors = __max_(1, 16 * AES_FILE_CHUNK_BLOCKS / sector_size);
+
+    FILE *input_file = fopen(job->input_file_name, "rb");
+    FILE *output_file = fopen(job->output_file_name, "r+b");
+    uint8_t *data_buffer = (uint8_t*)malloc(chunk_sectors * sector_size);
+
+    if(  (input_file == NULL) || (output_file == NULL) || (data_buffer == NULL)
+      || (file_seek_64(input_file, (int64_t)(first_sector * sector_size)) == EXIT_FAILURE)
+      || (file_seek_64(output_file, (int64_t)(first_sector * sector_size)) == EXIT_FAILURE)  ){
+        job->error = 1;
+    }
+    else{
+        for(uint64_t sector = first_sector; sector < end_sector; sector += chunk_sectors){
+            size_t count = (size_t)__min_((uint64_t)chunk_sectors, end_sector - sector);
+
+            fread(data_buffer, sector_size, count, input_file);
+            if(job->mode == AES_ENCRYPTION_MODE)
+                AES_XTS_encryption_sectors(job->xts, sector, data_buffer, data_buffer, count);
+            else
+                AES_XTS_decryption_sectors(job->xts, sector, data_buffer, data_buffer, count);
+            fwrite(data_buffer, sector_size, count, output_file);
+        }
+    }
+
+    free(data_buffer);
+    if(input_file != NULL)
+        fclose(input_file);
+    if(output_file != NULL)
+        fclose(output_file);
+}
+
+
+/*
+    Whole image: the file size must be a multiple of the sector size.
+*/
+static int XTS_Process_File(const AES_XTS_CONTEXT_T *xts, const char* const input_file_name, const char* const output_file_name, int mode, int threads)
+{
+    int64_t filesize = get_filesize_64(input_file_name);
+    FILE *output_file = fopen(output_file_name, "wb");         // create (or truncate) the output file
+
+    if(  (filesize == -1) || (output_file == NULL)  ){
+        if(output_file != NULL)
+            fclose(output_file);
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+    fclose(output_file);
+
+    if((uint64_t)filesize % xts->sector_size > 0){
+        printf("AES Error: the image size is not a multiple of the sector size.\n");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t sector_count = (uint64_t)filesize / xts->sector_size;
+    AES_XTS_FILE_JOB_T job = {xts, input_file_name, output_file_name, mode, 0};
+
+    if(threads <= 0){
+        threads = get_cpu_count();
+    }
+    threads = (int)__min_((uint64_t)threads, sector_count / AES_XTS_MIN_SECTORS_PER_THREAD + 1);
+
+    parallel_for(sector_count, threads, XTS_File_Task, &job);
+
+    if(job.error){
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+int AES_XTS_encryption(const AES_XTS_CONTEXT_T *xts, const char* const plain_file_name, const char* const encrypted_file_name, int threads)
+{
+    return XTS_Process_File(xts, plain_file_name, encrypted_file_name, AES_ENCRYPTION_MODE, threads);
+}
+
+
+int AES_XTS_decryption(const AES_XTS_CONTEXT_T *xts, const char* const encrypted_file_name, const char* const decrypted_file_name, int threads)
+{
+    return XTS_Process_File(xts, encrypted_file_name, decrypted_file_name, AES_DECRYPTION_MODE, threads);
+}
@@ -0,0 +1,84 @@
+#ifndef AES_BACKENDS_H_
+#define AES_BACKENDS_H_
+
+/*
+    Internal interface between the AES modes (AES.c, AES_modes.c) and the block cipher backends.
+
+    The encryption sub-keys are the "rounds" (10, 12 or 14) round keys following the initial one (the first
+    128 bits of the private key). The decryption sub-keys are backend specific: each backend prepares
+    them from the encryption sub-keys with its own decryption_subkeys() function. Both are computed once
+    and stored in an AES_KEY_CONTEXT_T, together with the backend that produced them.
+*/
+#include "AES.h"
+
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AES_X86_BACKENDS        1
+#else
+#define AES_X86_BACKENDS        0
+#endif
+
+
+typedef struct AES_BACKEND_S {
+    const char *name;
+    int (*is_supported)(void);
+
+    /* key: "key_words" (4, 6 or 8) columns of the private key */
+    void (*expand_key)(const uint32_t *key, int key_words, AES_Block_Struct *sub_keys);
+    void (*decryption_subkeys)(const AES_Block_Struct *sub_keys, int rounds, AES_Block_Struct *decryption_sub_keys);
+
+    /* optional (NULL: one key at a time): expand "count" (at most AES_BATCH_LANES) keys of the same size */
+    void (*expand_keys_multikey)(const uint32_t *const *keys, int key_words, AES_Block_Struct *const *sub_keys, int count);
+
+    /* process "count" independent blocks, in place */
+    void (*encrypt_blocks)(AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context);
+    void (*decrypt_blocks)(AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context);
+
+    /* optional (NULL: runs of blocks with the same key): block i processed with contexts[i], all expanded by this backend */
+    void (*encrypt_blocks_multikey)(AES_Block_Struct *blocks, const AES_KEY_CONTEXT_T *const *contexts, size_t count);
+    void (*decrypt_blocks_multikey)(AES_Block_Struct *blocks, const AES_KEY_CONTEXT_T *const *contexts, size_t count);
+} AES_BACKEND_T;
+
+
+typedef uint32_t (*AES_SUB_WORD_T)(uint32_t word);
+
+
+#define AES_ALWAYS_INLINE       inline __attribute__((always_inline))
+
+/*
+    Call function(rounds, ...) with the round count as a compile-time constant: the function being inlined,
+    each key size gets its own fully unrolled round loop.
+*/
+#define AES_ROUNDS_SWITCH(rounds, function, ...)         \
+    switch(rounds){                                     \
+        case 12: function(12, __VA_ARGS__); break;      \
+        case 14: function(14, __VA_ARGS__); break;      \
+        default: function(10, __VA_ARGS__); break;      \
+    }
+
+
+/* AES.c */
+const AES_BACKEND_T* AES_Get_Backend(void);
+void AES_Expand_Key(const uint32_t *key, int key_words, AES_SUB_WORD_T sub_word, AES_Block_Struct *sub_keys);
+void AES_Load_Blocks(const uint8_t *data, AES_Block_Struct *blocks, size_t count);
+void AES_Store_Blocks(const AES_Block_Struct *blocks, uint8_t *data, size_t count);
+void AES_ECB_Process_Blocks(const AES_KEY_CONTEXT_T *context, const uint8_t *input, uint8_t *output, size_t block_count, int mode);
+void AES_Pad_Last_Block(const uint8_t *data, size_t remainder, uint8_t *last_block);
+int AES_Unpadded_Size(const uint8_t *last_block);
+int AES_Init_Key_Contexts(AES_KEY_CONTEXT_T *const *contexts, const uint8_t *const *keys, const int *key_bits, int count, int mode);
+
+/* AES_modes.c */
+void AES_Xor_Bytes(uint8_t *data, const uint8_t *keystream, size_t size);
+void AES_Xor_Keystream(const uint8_t *input, uint8_t *output, const uint8_t *keystream, size_t size);
+void AES_CTR_Keystream(const AES_KEY_CONTEXT_T *context, uint64_t nonce, uint64_t counter,
+                       AES_Block_Struct *blocks, uint8_t *keystream, size_t count);
+
+
+#if AES_X86_BACKENDS
+extern const AES_BACKEND_T AES_Backend_AESNI;
+extern const AES_BACKEND_T AES_Backend_Bitslice;
+extern const AES_BACKEND_T AES_Backend_VPAES;
+#endif
+
+
+#endif      // AES_BACKENDS_H_
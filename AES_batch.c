@@ -0,0 +1,269 @@
+/*
+    Multi-key AES: batches of small records, each one encrypted with its own key (per-user or per-message
+    keys), in the format of AES_encryption_buffer() (ECB with padding).
+
+    Encrypting many small records one by one is slow: each record is too short to fill the backend
+    pipeline. Here the keys of up to AES_BATCH_LANES records are expanded at once (each key schedule is
+    computed once per record), and the blocks of these records are gathered together, so that every
+    backend call processes AES_BATCH_BLOCKS blocks under different keys (AES-NI: 8 blocks with 8 keys
+    in flight). The next group of records is started when all the records of the group are finished.
+    Records longer than AES_BATCH_BLOCKS blocks are processed alone at bulk speed.
+*/
+#include "AES_backends.h"
+
+
+#define AES_BATCH_BLOCKS            (8 * AES_BATCH_LANES)       // blocks gathered per backend call
+
+
+typedef struct {
+    AES_BATCH_RECORD_T *record;
+    AES_KEY_CONTEXT_T context;
+    size_t block_index;             // next block to gather
+    size_t block_count;             // including the padding block (encryption)
+} BATCH_LANE_T;
+
+
+
+static int has_multikey(const AES_BACKEND_T *backend, int mode)
+{
+    return (mode == AES_ENCRYPTION_MODE) ? (backend->encrypt_blocks_multikey != NULL) : (backend->decrypt_blocks_multikey != NULL);
+}
+
+
+/*
+    Block i is processed with contexts[i]. Backends without a multi-key implementation process the runs of
+    consecutive blocks having the same key.
+*/
+static void process_blocks_multikey(AES_Block_Struct *blocks, const AES_KEY_CONTEXT_T *const *contexts, size_t count, int mode)
+{
+    const AES_BACKEND_T *backend = contexts[0]->backend;
+
+    if(has_multikey(backend, mode)){
+        if(mode == AES_ENCRYPTION_MODE)
+            backend->encrypt_blocks_multikey(blocks, contexts, count);
+        else
+            backend->decrypt_blocks_multikey(blocks, contexts, count);
+        return;
+    }
+
+    for(size_t i = 0; i < count; ){
+        size_t n = 1;
+        while(  (i + n < count) && (contexts[i+n] == contexts[i])  ){
+            n++;
+        }
+
+        if(mode == AES_ENCRYPTION_MODE)
+            backend->encrypt_blocks(&blocks[i], n, contexts[i]);
+        else
+            backend->decrypt_blocks(&blocks[i], n, contexts[i]);
+        i += n;
+    }
+}
+
+
+static int batch_check_record(const AES_BATCH_RECORD_T *record, int mode)
+{
+    if(  (record->key_bits != 128) && (record->key_bits != 192) && (record->key_bits != 256)  ){
+        printf("AES Error: invalid key size.\n");
+        return EXIT_FAILURE;
+    }
+
+    if(  (record->key == NULL) || (record->output == NULL) || ((record->input == NULL) && (record->input_size > 0))  ){
+        printf("AES Error: invalid buffer.\n");
+        return EXIT_FAILURE;
+    }
+
+    if(  (mode == AES_DECRYPTION_MODE) && ((record->input_size == 0) || ((record->input_size % 16) > 0))  ){
+        printf("AES Error: invalid buffer.\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+static size_t batch_block_count(const AES_BATCH_RECORD_T *record, int mode)
+{
+    return (mode == AES_ENCRYPTION_MODE) ? record->input_size / 16 + 1 : record->input_size / 16;
+}
+
+
+/*
+    Long record: processed alone with its own key.
+*/
+static int batch_process_alone(AES_BATCH_RECORD_T *record, int mode)
+{
+    AES_KEY_CONTEXT_T context;
+    int result;
+
+    AES_Init_Key_Context(&context, record->key, record->key_bits);
+
+    if(mode == AES_ENCRYPTION_MODE)
+        result = AES_encryption_buffer(&context, record->input, record->input_size, record->output, &record->output_size);
+    else
+        result = AES_decryption_buffer(&context, record->input, record->input_size, record->output, &record->output_size);
+
+    memset(&context, 0, sizeof(context));
+
+    if(result != EXIT_SUCCESS){
+        record->output_size = 0;
+    }
+    return result;
+}
+
+
+static int batch_lane_finish(BATCH_LANE_T *lane, int mode)
+{
+    AES_BATCH_RECORD_T *record = lane->record;
+
+    if(mode == AES_ENCRYPTION_MODE){
+        record->output_size = 16 * lane->block_count;
+        return EXIT_SUCCESS;
+    }
+
+    int last_bytes_count = AES_Unpadded_Size(&record->output[16*(lane->block_count-1)]);
+    if(last_bytes_count == -1){
+        printf("AES Error: wrong padding.\n");
+        record->output_size = 0;
+        return EXIT_FAILURE;
+    }
+
+    record->output_size = 16*(lane->block_count-1) + last_bytes_count;
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    Process the records of the lanes, AES_BATCH_BLOCKS blocks at a time. The blocks are gathered round-robin
+    (one block per lane) for the multi-key backends, record by record for the others.
+*/
+static void batch_process_lanes(BATCH_LANE_T *lanes, int active, int mode)
+{
+    AES_Block_Struct blocks[AES_BATCH_BLOCKS];
+    const AES_KEY_CONTEXT_T *contexts[AES_BATCH_BLOCKS];
+    uint8_t *destinations[AES_BATCH_BLOCKS];
+    size_t blocks_per_lane = has_multikey(lanes[0].context.backend, mode) ? 1 : AES_BATCH_BLOCKS;
+
+    for(;;){
+        size_t n = 0;
+        int pending = 1;
+
+        while(  (n < AES_BATCH_BLOCKS) && pending  ){
+            pending = 0;
+
+            for(int l = 0; (l < active) && (n < AES_BATCH_BLOCKS); l++){
+                BATCH_LANE_T *lane = &lanes[l];
+                AES_BATCH_RECORD_T *record = lane->record;
+
+                for(size_t b = 0; (b < blocks_per_lane) && (lane->block_index < lane->block_count) && (n < AES_BATCH_BLOCKS); b++){
+                    size_t index = lane->block_index;
+
+                    if(  (mode == AES_ENCRYPTION_MODE) && (index == lane->block_count - 1)  ){
+                        uint8_t last_block[16];
+                        AES_Pad_Last_Block(&record->input[16*index], record->input_size % 16, last_block);
+                        AES_Load_Blocks(last_block, &blocks[n], 1);
+                    }
+                    else{
+                        AES_Load_Blocks(&record->input[16*index], &blocks[n], 1);
+                    }
+
+                    contexts[n] = &lane->context;
+                    destinations[n] = &record->output[16*index];
+                    lane->block_index++;
+                    n++;
+                    pending = 1;
+                }
+            }
+        }
+
+        if(n == 0)
+            break;
+
+        process_blocks_multikey(blocks, contexts, n, mode);
+
+        for(size_t i = 0; i < n; i++){
+            AES_Store_Blocks(&blocks[i], destinations[i], 1);
+        }
+    }
+
+    memset(blocks, 0, sizeof(blocks));
+}
+
+
+static int batch_process(AES_BATCH_RECORD_T *records, int record_count, int mode)
+{
+    BATCH_LANE_T lanes[AES_BATCH_LANES];
+    AES_KEY_CONTEXT_T *contexts[AES_BATCH_LANES];
+    const uint8_t *keys[AES_BATCH_LANES];
+    int key_bits[AES_BATCH_LANES];
+    int next_record = 0;
+    int result = EXIT_SUCCESS;
+
+    for(int i = 0; i < record_count; i++){
+        if(batch_check_record(&records[i], mode) != EXIT_SUCCESS)
+            return EXIT_FAILURE;
+    }
+
+    while(next_record < record_count){
+        /* next AES_BATCH_LANES short records (the long ones met on the way are processed alone) */
+        int active = 0;
+
+        while(  (active < AES_BATCH_LANES) && (next_record < record_count)  ){
+            AES_BATCH_RECORD_T *record = &records[next_record++];
+            size_t block_count = batch_block_count(record, mode);
+
+            if(block_count > AES_BATCH_BLOCKS){
+                if(batch_process_alone(record, mode) != EXIT_SUCCESS)
+                    result = EXIT_FAILURE;
+                continue;
+            }
+
+            lanes[active].record = record;
+            lanes[active].block_index = 0;
+            lanes[active].block_count = block_count;
+            contexts[active] = &lanes[active].context;
+            keys[active] = record->key;
+            key_bits[active] = record->key_bits;
+            active++;
+        }
+
+        if(active == 0)
+            continue;
+
+        /* all the keys of the group are expanded together (decryption sub-keys only when decrypting) */
+        AES_Init_Key_Contexts(contexts, keys, key_bits, active, mode);
+
+        batch_process_lanes(lanes, active, mode);
+
+        for(int l = 0; l < active; l++){
+            if(batch_lane_finish(&lanes[l], mode) != EXIT_SUCCESS)
+                result = EXIT_FAILURE;
+        }
+    }
+
+    memset(lanes, 0, sizeof(lanes));
+
+    return result;
+}
+
+
+
+/*
+    Encryption of a batch of records, each one with its own key: records[i].output receives the same data
+    as AES_encryption_buffer() with the key of the record. The output of a record may be its input.
+*/
+int AES_encryption_batch(AES_BATCH_RECORD_T *records, int record_count)
+{
+    return batch_process(records, record_count, AES_ENCRYPTION_MODE);
+}
+
+
+/*
+    Decryption of a batch of records, each one with its own key (see AES_decryption_buffer()).
+    A record with a wrong padding gets an output_size of 0; the other records are still decrypted and
+    EXIT_FAILURE is returned at the end.
+*/
+int AES_decryption_batch(AES_BATCH_RECORD_T *records, int record_count)
+{
+    return batch_process(records, record_count, AES_DECRYPTION_MODE);
+}
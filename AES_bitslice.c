@@ -0,0 +1,600 @@
+/*
+    Bitsliced, constant-time AES backend: 8 blocks are processed at once in 8 SSE registers ("bit planes").
+
+    Plane j holds bit j of the 128 state bytes of the 8 blocks: byte p of the plane (p = 4*column + row,
+    the standard AES byte order) gathers, in its bit b, the bit j of the state byte p of block b.
+    With this layout:
+        - SubBytes is the Boyar-Peralta boolean circuit evaluated on the 8 planes,
+        - ShiftRows and the column rotations of MixColumns are the same byte shuffle (PSHUFB) on every plane,
+        - multiplication by 2 in GF(2^8) is a renaming of the planes plus 4 XORs.
+    No memory access depends on the data or on the key (the key expansion also uses the S-box circuit).
+
+    AES_BACKEND_AUTO picks the vector permute engine instead (same CPU features, no 8-block batches needed):
+    this backend is only used after AES_Set_Backend(AES_BACKEND_BITSLICE).
+*/
+#include "AES_backends.h"
+
+#if AES_X86_BACKENDS
+
+#include <immintrin.h>
+
+
+#define BITSLICE_TARGET         __attribute__((target("sse2,ssse3")))
+#define BITSLICE_BLOCKS         8           // number of blocks processed in parallel
+
+
+typedef struct {
+    __m128i plane[8];
+} BITSLICED_STATE_T;
+
+
+static int Bitslice_Is_Supported(void)
+{
+    return cpu_has_feature(CPU_FEATURE_SSE2) && cpu_has_feature(CPU_FEATURE_SSSE3);
+}
+
+
+
+BITSLICE_TARGET static inline __m128i word_swap_mask(void)
+{
+    return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+}
+
+
+/*
+    Transpose the 8x8 matrix of 16-bits elements stored in r[0..7].
+*/
+BITSLICE_TARGET static void transpose_8x8_epi16(__m128i *r)
+{
+    __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+    __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+    __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+    __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+    __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+    __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+    __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+    __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    r[0] = _mm_unpacklo_epi64(b0, b4);
+    r[1] = _mm_unpackhi_epi64(b0, b4);
+    r[2] = _mm_unpacklo_epi64(b1, b5);
+    r[3] = _mm_unpackhi_epi64(b1, b5);
+    r[4] = _mm_unpacklo_epi64(b2, b6);
+    r[5] = _mm_unpackhi_epi64(b2, b6);
+    r[6] = _mm_unpacklo_epi64(b3, b7);
+    r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+
+/*
+    Transpose the 8x8 bit matrix held in each 64-bits half of x (bit 8*i+j <-> bit 8*j+i).
+*/
+BITSLICE_TARGET static inline __m128i transpose_8x8_bits(__m128i x)
+{
+    __m128i t;
+
+    t = _mm_and_si128(x ^ _mm_srli_epi64(x, 7), _mm_set1_epi64x(0x00AA00AA00AA00AALL));
+    x = x ^ t ^ _mm_slli_epi64(t, 7);
+    t = _mm_and_si128(x ^ _mm_srli_epi64(x, 14), _mm_set1_epi64x(0x0000CCCC0000CCCCLL));
+    x = x ^ t ^ _mm_slli_epi64(t, 14);
+    t = _mm_and_si128(x ^ _mm_srli_epi64(x, 28), _mm_set1_epi64x(0x00000000F0F0F0F0LL));
+    x = x ^ t ^ _mm_slli_epi64(t, 28);
+
+    return x;
+}
+
+
+/*
+    Convert 8 blocks (r[b] = bytes of block b, in the standard AES order) to the 8 bit planes, and back:
+    the transformation is its own inverse.
+
+    1) 16-bits transpose: r[k] = pairs of bytes (2k, 2k+1) of the 8 blocks
+    2) byte shuffle: r[k] = byte 2k of the 8 blocks, then byte 2k+1 of the 8 blocks
+    3) 8x8 bit transpose of each half: r[k] = bit j of byte 2k (resp. 2k+1) of the 8 blocks, for j = 0..7
+    4) inverse byte shuffle and 16-bits transpose: r[j] = plane j
+*/
+BITSLICE_TARGET static void transpose_state(__m128i *r)
+{
+    const __m128i pairs_to_halves = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+    const __m128i halves_to_pairs = _mm_setr_epi8(0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15);
+
+    transpose_8x8_epi16(r);
+    for(int k = 0; k < 8; k++){
+        r[k] = _mm_shuffle_epi8(transpose_8x8_bits(_mm_shuffle_epi8(r[k], pairs_to_halves)), halves_to_pairs);
+    }
+    transpose_8x8_epi16(r);
+}
+
+
+/*
+    8 blocks (AES matrix form) -> 8 bit planes.
+*/
+BITSLICE_TARGET static void bitslice(const AES_Block_Struct *blocks, BITSLICED_STATE_T *state)
+{
+    for(int b = 0; b < BITSLICE_BLOCKS; b++){
+        state->plane[b] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[b]), word_swap_mask());
+    }
+    transpose_state(state->plane);
+}
+
+
+/*
+    8 bit planes -> 8 blocks (AES matrix form).
+*/
+BITSLICE_TARGET static void unbitslice(const BITSLICED_STATE_T *state, AES_Block_Struct *blocks)
+{
+    __m128i r[8];
+
+    for(int j = 0; j < 8; j++){
+        r[j] = state->plane[j];
+    }
+    transpose_state(r);
+
+    for(int b = 0; b < BITSLICE_BLOCKS; b++){
+        _mm_storeu_si128((__m128i*)&blocks[b], _mm_shuffle_epi8(r[b], word_swap_mask()));
+    }
+}
+
+
+/*
+    Round key -> bit planes (the same key is used for the 8 blocks).
+*/
+BITSLICE_TARGET static void bitslice_key(const AES_Block_Struct *key, BITSLICED_STATE_T *bitsliced_key)
+{
+    AES_Block_Struct keys[BITSLICE_BLOCKS];
+
+    for(int b = 0; b < BITSLICE_BLOCKS; b++){
+        keys[b] = *key;
+    }
+    bitslice(keys, bitsliced_key);
+}
+
+
+
+/*
+    AES S-box as a boolean circuit (J. Boyar, R. Peralta, "A depth-16 circuit for the AES S-box", 2011):
+    113 XOR/AND/XNOR gates, x0 being the most significant bit.
+*/
+BITSLICE_TARGET static void SubBytes_Bitsliced(__m128i *q)
+{
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7;
+    __m128i y1, y2, y3, y4, y5, y6, y7, y8, y9;
+    __m128i y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+    __m128i y20, y21;
+    __m128i z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+    __m128i z10, z11, z12, z13, z14, z15, z16, z17;
+    __m128i t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+    __m128i t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+    __m128i t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+    __m128i t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+    __m128i t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+    __m128i t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+    __m128i t60, t61, t62, t63, t64, t65, t66, t67;
+    __m128i s0, s1, s2, s3, s4, s5, s6, s7;
+
+    x0 = q[7];
+    x1 = q[6];
+    x2 = q[5];
+    x3 = q[4];
+    x4 = q[3];
+    x5 = q[2];
+    x6 = q[1];
+    x7 = q[0];
+
+    /* top linear transformation */
+    y14 = x3 ^ x5;
+    y13 = x0 ^ x6;
+    y9 = x0 ^ x3;
+    y8 = x0 ^ x5;
+    t0 = x1 ^ x2;
+    y1 = t0 ^ x7;
+    y4 = y1 ^ x3;
+    y12 = y13 ^ y14;
+    y2 = y1 ^ x0;
+    y5 = y1 ^ x6;
+    y3 = y5 ^ y8;
+    t1 = x4 ^ y12;
+    y15 = t1 ^ x5;
+    y20 = t1 ^ x1;
+    y6 = y15 ^ x7;
+    y10 = y15 ^ t0;
+    y11 = y20 ^ y9;
+    y7 = x7 ^ y11;
+    y17 = y10 ^ y11;
+    y19 = y10 ^ y8;
+    y16 = t0 ^ y11;
+    y21 = y13 ^ y16;
+    y18 = x0 ^ y16;
+
+    /* non-linear section */
+    t2 = y12 & y15;
+    t3 = y3 & y6;
+    t4 = t3 ^ t2;
+    t5 = y4 & x7;
+    t6 = t5 ^ t2;
+    t7 = y13 & y16;
+    t8 = y5 & y1;
+    t9 = t8 ^ t7;
+    t10 = y2 & y7;
+    t11 = t10 ^ t7;
+    t12 = y9 & y11;
+    t13 = y14 & y17;
+    t14 = t13 ^ t12;
+    t15 = y8 & y10;
+    t16 = t15 ^ t12;
+    t17 = t4 ^ t14;
+    t18 = t6 ^ t16;
+    t19 = t9 ^ t14;
+    t20 = t11 ^ t16;
+    t21 = t17 ^ y20;
+    t22 = t18 ^ y19;
+    t23 = t19 ^ y21;
+    t24 = t20 ^ y18;
+
+    t25 = t21 ^ t22;
+    t26 = t21 & t23;
+    t27 = t24 ^ t26;
+    t28 = t25 & t27;
+    t29 = t28 ^ t22;
+    t30 = t23 ^ t24;
+    t31 = t22 ^ t26;
+    t32 = t31 & t30;
+    t33 = t32 ^ t24;
+    t34 = t23 ^ t33;
+    t35 = t27 ^ t33;
+    t36 = t24 & t35;
+    t37 = t36 ^ t34;
+    t38 = t27 ^ t36;
+    t39 = t29 & t38;
+    t40 = t25 ^ t39;
+
+    t41 = t40 ^ t37;
+    t42 = t29 ^ t33;
+    t43 = t29 ^ t40;
+    t44 = t33 ^ t37;
+    t45 = t42 ^ t41;
+    z0 = t44 & y15;
+    z1 = t37 & y6;
+    z2 = t33 & x7;
+    z3 = t43 & y16;
+    z4 = t40 & y1;
+    z5 = t29 & y7;
+    z6 = t42 & y11;
+    z7 = t45 & y17;
+    z8 = t41 & y10;
+    z9 = t44 & y12;
+    z10 = t37 & y3;
+    z11 = t33 & y4;
+    z12 = t43 & y13;
+    z13 = t40 & y5;
+    z14 = t29 & y2;
+    z15 = t42 & y9;
+    z16 = t45 & y14;
+    z17 = t41 & y8;
+
+    /* bottom linear transformation */
+    t46 = z15 ^ z16;
+    t47 = z10 ^ z11;
+    t48 = z5 ^ z13;
+    t49 = z9 ^ z10;
+    t50 = z2 ^ z12;
+    t51 = z2 ^ z5;
+    t52 = z7 ^ z8;
+    t53 = z0 ^ z3;
+    t54 = z6 ^ z7;
+    t55 = z16 ^ z17;
+    t56 = z12 ^ t48;
+    t57 = t50 ^ t53;
+    t58 = z4 ^ t46;
+    t59 = z3 ^ t54;
+    t60 = t46 ^ t57;
+    t61 = z14 ^ t57;
+    t62 = t52 ^ t58;
+    t63 = t49 ^ t58;
+    t64 = z4 ^ t59;
+    t65 = t61 ^ t62;
+    t66 = z1 ^ t63;
+    s0 = t59 ^ t63;
+    s6 = t56 ^ ~t62;
+    s7 = t48 ^ ~t60;
+    t67 = t64 ^ t65;
+    s3 = t53 ^ t66;
+    s4 = t51 ^ t66;
+    s5 = t47 ^ t65;
+    s1 = t64 ^ ~s3;
+    s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+
+/*
+    Inverse affine transformation of the S-box: y -> (y <<< 1) ^ (y <<< 3) ^ (y <<< 6) ^ 0x05.
+*/
+BITSLICE_TARGET static void InvAffine_Bitsliced(__m128i *q)
+{
+    __m128i y[8];
+    __m128i ones = _mm_set1_epi8(-1);
+
+    for(int j = 0; j < 8; j++){
+        y[j] = q[j];
+    }
+    for(int j = 0; j < 8; j++){
+        q[j] = y[(j+7) & 7] ^ y[(j+5) & 7] ^ y[(j+2) & 7];
+    }
+    q[0] ^= ones;
+    q[2] ^= ones;
+}
+
+
+/*
+    Inverse S-box from the forward circuit: with S(x) = A(x^-1), Si(y) = A^-1(S(A^-1(y))).
+*/
+BITSLICE_TARGET static void InvSubBytes_Bitsliced(__m128i *q)
+{
+    InvAffine_Bitsliced(q);
+    SubBytes_Bitsliced(q);
+    InvAffine_Bitsliced(q);
+}
+
+
+
+BITSLICE_TARGET static void shuffle_planes(__m128i *q, __m128i mask)
+{
+    for(int j = 0; j < 8; j++){
+        q[j] = _mm_shuffle_epi8(q[j], mask);
+    }
+}
+
+BITSLICE_TARGET static inline __m128i shift_rows_mask(void)
+{
+    return _mm_setr_epi8(0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11);
+}
+
+BITSLICE_TARGET static inline __m128i inv_shift_rows_mask(void)
+{
+    return _mm_setr_epi8(0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3);
+}
+
+/* rotation of each column by 1 and 2 rows: byte (column, row) <- byte (column, row+1 or row+2) */
+BITSLICE_TARGET static inline __m128i rotate_1_mask(void)
+{
+    return _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+}
+
+BITSLICE_TARGET static inline __m128i rotate_2_mask(void)
+{
+    return _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+}
+
+
+/*
+    out = 2.a in GF(2^8) (reduction by x^8 + x^4 + x^3 + x + 1 = 0x11b)
+*/
+BITSLICE_TARGET static void xtime_planes(const __m128i *a, __m128i *out)
+{
+    out[0] = a[7];
+    out[1] = a[0] ^ a[7];
+    out[2] = a[1];
+    out[3] = a[2] ^ a[7];
+    out[4] = a[3] ^ a[7];
+    out[5] = a[4];
+    out[6] = a[5];
+    out[7] = a[6];
+}
+
+
+/*
+    out_i = 2.a_i ^ 3.a_i+1 ^ a_i+2 ^ a_i+3 = 2.(a_i ^ a_i+1) ^ a_i+1 ^ (a_i+2 ^ a_i+3)
+*/
+BITSLICE_TARGET static void MixColumns_Bitsliced(__m128i *q)
+{
+    __m128i r1[8], t[8], xt[8];
+
+    for(int j = 0; j < 8; j++){
+        r1[j] = _mm_shuffle_epi8(q[j], rotate_1_mask());
+        t[j] = q[j] ^ r1[j];
+    }
+
+    xtime_planes(t, xt);
+
+    for(int j = 0; j < 8; j++){
+        q[j] = xt[j] ^ r1[j] ^ _mm_shuffle_epi8(t[j], rotate_2_mask());
+    }
+}
+
+
+/*
+    InvMixColumns = MixColumns o (multiplication of each column by {04}.x^2 + {05}):
+    a_i ^= 4.(a_i ^ a_i+2)
+*/
+BITSLICE_TARGET static void InvMixColumns_Bitsliced(__m128i *q)
+{
+    __m128i t[8], t2[8], t4[8];
+
+    for(int j = 0; j < 8; j++){
+        t[j] = q[j] ^ _mm_shuffle_epi8(q[j], rotate_2_mask());
+    }
+
+    xtime_planes(t, t2);
+    xtime_planes(t2, t4);
+
+    for(int j = 0; j < 8; j++){
+        q[j] ^= t4[j];
+    }
+
+    MixColumns_Bitsliced(q);
+}
+
+
+BITSLICE_TARGET static inline void AddRoundKey_Bitsliced(__m128i *q, const BITSLICED_STATE_T *key)
+{
+    for(int j = 0; j < 8; j++){
+        q[j] ^= key->plane[j];
+    }
+}
+
+
+
+/*
+    The round loop is not unrolled: a bitsliced round is already several hundred instructions long.
+*/
+BITSLICE_TARGET static void EncryptBlocks_Bitsliced(BITSLICED_STATE_T *state, const BITSLICED_STATE_T *round_keys, int rounds)
+{
+    __m128i *q = state->plane;
+
+    AddRoundKey_Bitsliced(q, &round_keys[0]);
+
+    for(int r = 1; r < rounds; r++){
+        SubBytes_Bitsliced(q);
+        shuffle_planes(q, shift_rows_mask());
+        MixColumns_Bitsliced(q);
+        AddRoundKey_Bitsliced(q, &round_keys[r]);
+    }
+
+    SubBytes_Bitsliced(q);
+    shuffle_planes(q, shift_rows_mask());
+    AddRoundKey_Bitsliced(q, &round_keys[rounds]);
+}
+
+
+BITSLICE_TARGET static void DecryptBlocks_Bitsliced(BITSLICED_STATE_T *state, const BITSLICED_STATE_T *round_keys, int rounds)
+{
+    __m128i *q = state->plane;
+
+    AddRoundKey_Bitsliced(q, &round_keys[rounds]);
+
+    for(int r = rounds-1; r >= 1; r--){
+        shuffle_planes(q, inv_shift_rows_mask());
+        InvSubBytes_Bitsliced(q);
+        AddRoundKey_Bitsliced(q, &round_keys[r]);
+        InvMixColumns_Bitsliced(q);
+    }
+
+    shuffle_planes(q, inv_shift_rows_mask());
+    InvSubBytes_Bitsliced(q);
+    AddRoundKey_Bitsliced(q, &round_keys[0]);
+}
+
+
+
+/*
+    Apply the S-box to the 4 bytes of a word with the boolean circuit (key expansion).
+*/
+BITSLICE_TARGET static uint32_t SubWord_Bitsliced(uint32_t word)
+{
+    AES_Block_Struct blocks[BITSLICE_BLOCKS] = {{0}};
+    BITSLICED_STATE_T state;
+
+    blocks[0].w0 = word;
+    bitslice(blocks, &state);
+    SubBytes_Bitsliced(state.plane);
+    unbitslice(&state, blocks);
+
+    return blocks[0].w0;
+}
+
+
+BITSLICE_TARGET static void Bitslice_Expand_Key(const uint32_t *key, int key_words, AES_Block_Struct *sub_keys)
+{
+    AES_Expand_Key(key, key_words, SubWord_Bitsliced, sub_keys);      // rcon values do not depend on the key
+}
+
+
+/*
+    The bitsliced engine runs the straightforward inverse cipher: the decryption sub-keys are the encryption ones.
+*/
+static void Bitslice_Decryption_Subkeys(const AES_Block_Struct *sub_keys, int rounds, AES_Block_Struct *decryption_sub_keys)
+{
+    for(int i = 0; i < rounds; i++){
+        decryption_sub_keys[i] = sub_keys[i];
+    }
+}
+
+
+BITSLICE_TARGET static void bitslice_round_keys(const AES_Block_Struct *private_key, const AES_Block_Struct *sub_keys, int rounds, BITSLICED_STATE_T *round_keys)
+{
+    bitslice_key(private_key, &round_keys[0]);
+    for(int i = 0; i < rounds; i++){
+        bitslice_key(&sub_keys[i], &round_keys[i+1]);
+    }
+}
+
+
+/*
+    Process the blocks by groups of 8; the last group is completed with dummy blocks so that the
+    amount of work never depends on the data.
+*/
+BITSLICE_TARGET static void process_blocks(AES_Block_Struct *blocks, size_t count, const BITSLICED_STATE_T *round_keys, int rounds, int decrypt)
+{
+    BITSLICED_STATE_T state;
+    AES_Block_Struct group[BITSLICE_BLOCKS];
+
+    for(size_t i = 0; i < count; i += BITSLICE_BLOCKS){
+        size_t n = __min_(BITSLICE_BLOCKS, count - i);
+
+        for(size_t b = 0; b < BITSLICE_BLOCKS; b++){
+            if(b < n)
+                group[b] = blocks[i+b];
+            else
+                group[b].w0 = group[b].w1 = group[b].w2 = group[b].w3 = 0;
+        }
+
+        bitslice(group, &state);
+        if(decrypt)
+            DecryptBlocks_Bitsliced(&state, round_keys, rounds);
+        else
+            EncryptBlocks_Bitsliced(&state, round_keys, rounds);
+        unbitslice(&state, group);
+
+        for(size_t b = 0; b < n; b++){
+            blocks[i+b] = group[b];
+        }
+    }
+}
+
+
+BITSLICE_TARGET static void Bitslice_Encrypt_Blocks(AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context)
+{
+    BITSLICED_STATE_T round_keys[AES_MAX_ROUNDS+1];
+
+    bitslice_round_keys(&context->private_key, context->sub_keys, context->rounds, round_keys);
+    process_blocks(blocks, count, round_keys, context->rounds, 0);
+}
+
+
+BITSLICE_TARGET static void Bitslice_Decrypt_Blocks(AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context)
+{
+    BITSLICED_STATE_T round_keys[AES_MAX_ROUNDS+1];
+
+    bitslice_round_keys(&context->private_key, context->decryption_sub_keys, context->rounds, round_keys);
+    process_blocks(blocks, count, round_keys, context->rounds, 1);
+}
+
+
+const AES_BACKEND_T AES_Backend_Bitslice = {
+    .name = "bitsliced (SSSE3, 8 blocks)",
+    .is_supported = Bitslice_Is_Supported,
+    .expand_key = Bitslice_Expand_Key,
+    .decryption_subkeys = Bitslice_Decryption_Subkeys,
+    .encrypt_blocks = Bitslice_Encrypt_Blocks,
+    .decrypt_blocks = Bitslice_Decrypt_Blocks
+};
+
+#endif      // AES_X86_BACKENDS
@@ -0,0 +1,658 @@
+/*
+    AES modes of operation other than ECB.
+
+    - CTR: counter block = 64-bits nonce (columns w0, w1) || 64-bits block counter (columns w2, w3),
+      no padding. Large files are split in contiguous ranges of blocks processed by worker threads.
+    - CBC: ANSI X9.23 padding (as ECB). The decryption is parallel (each plaintext block only depends on two
+      ciphertext blocks); the encryption is serial for one message, several messages can be interleaved.
+*/
+#include "AES_backends.h"
+
+
+/*
+    Generate "count" blocks of keystream, starting at the block number "counter".
+*/
+void AES_CTR_Keystream(const AES_KEY_CONTEXT_T *context, uint64_t nonce, uint64_t counter,
+                       AES_Block_Struct *blocks, uint8_t *keystream, size_t count)
+{
+    for(size_t i = 0; i < count; i++){
+        blocks[i].w0 = (uint32_t)(nonce >> 32);
+        blocks[i].w1 = (uint32_t)(nonce);
+        blocks[i].w2 = (uint32_t)((counter + i) >> 32);
+        blocks[i].w3 = (uint32_t)(counter + i);
+    }
+
+    context->backend->encrypt_blocks(blocks, count, context);
+    AES_Store_Blocks(blocks, keystream, count);
+}
+
+
+/*
+    output = input ^ keystream. The input and the output are either the same buffer or do not overlap.
+*/
+void AES_Xor_Keystream(const uint8_t *input, uint8_t *output, const uint8_t *keystream, size_t size)
+{
+    size_t i = 0;
+
+    for(; i + 8 <= size; i += 8){
+        uint64_t d, k;
+        memcpy(&d, &input[i], sizeof(uint64_t));
+        memcpy(&k, &keystream[i], sizeof(uint64_t));
+        d ^= k;
+        memcpy(&output[i], &d, sizeof(uint64_t));
+    }
+    for(; i < size; i++){
+        output[i] = input[i] ^ keystream[i];
+    }
+}
+
+
+void AES_Xor_Bytes(uint8_t *data, const uint8_t *keystream, size_t size)
+{
+    AES_Xor_Keystream(data, data, keystream, size);
+}
+
+
+
+/*
+    Shared state of the CTR file workers.
+*/
+typedef struct {
+    const char *input_file_name;
+    const char *output_file_name;
+    const AES_KEY_CONTEXT_T *context;
+    uint64_t nonce;
+    int error;
+} AES_CTR_FILE_JOB_T;
+
+
+/*
+    Worker: encrypt the blocks [first_block, end_block) of the input file.
+    Each worker has its own file handles, the counter of each block being known there is no
+    coordination between the workers.
+*/
+static void CTR_File_Task(uint64_t first_block, uint64_t end_block, void *arg)
+{
+    AES_CTR_FILE_JOB_T *job = (AES_CTR_FILE_JOB_T*)arg;
+
+    FILE *input_file = fopen(job->input_file_name, "rb");
+    FILE *output_file = fopen(job->output_file_name, "r+b");
+
+    if(  (input_file == NULL) || (output_file == NULL)
+      || (file_seek_64(input_file, (int64_t)first_block * 16) == EXIT_FAILURE)
+      || (file_seek_64(output_file, (int64_t)first_block * 16) == EXIT_FAILURE)  ){
+        job->error = 1;
+    }
+    else{
+        AES_Block_Struct blocks[AES_FILE_CHUNK_BLOCKS];
+        uint8_t keystream[16 * AES_FILE_CHUNK_BLOCKS];
+        uint8_t data_buffer[16 * AES_FILE_CHUNK_BLOCKS];
+
+        for(uint64_t block = first_block; block < end_block; block += AES_FILE_CHUNK_BLOCKS){
+            size_t count = (size_t)__min_((uint64_t)AES_FILE_CHUNK_BLOCKS, end_block - block);
+            size_t size = fread(data_buffer, sizeof(uint8_t), 16 * count, input_file);        // the last block may be incomplete
+
+            AES_CTR_Keystream(job->context, job->nonce, block, blocks, keystream, count);
+            AES_Xor_Bytes(data_buffer, keystream, size);
+            fwrite(data_buffer, sizeof(uint8_t), size, output_file);
+        }
+    }
+
+    if(input_file != NULL)
+        fclose(input_file);
+    if(output_file != NULL)
+        fclose(output_file);
+}
+
+
+/*
+    Encryption of a file in CTR mode (no padding: the output has the size of the input).
+
+    Parameters:
+        - nonce  : must never be reused with the same key
+        - threads: number of worker threads (0 = one per CPU)
+*/
+int AES_CTR_encryption(const AES_KEY_CONTEXT_T *context, const char* const plain_file_name, uint64_t nonce, const char* const encrypted_file_name, int threads)
+{
+    int64_t filesize = get_filesize_64(plain_file_name);
+    FILE *encrypted_file = fopen(encrypted_file_name, "wb");         // create (or truncate) the output file
+
+    if(  (filesize == -1) || (encrypted_file == NULL)  ){
+        if(encrypted_file != NULL)
+            fclose(encrypted_file);
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+    fclose(encrypted_file);
+
+    AES_CTR_FILE_JOB_T job;
+    job.input_file_name = plain_file_name;
+    job.output_file_name = encrypted_file_name;
+    job.context = context;
+    job.nonce = nonce;
+    job.error = 0;
+
+    /* do not start more workers than useful for small files */
+    uint64_t block_count = ((uint64_t)filesize + 15) / 16;
+    if(threads <= 0){
+        threads = get_cpu_count();
+    }
+    threads = (int)__min_((uint64_t)threads, block_count / AES_CTR_MIN_BLOCKS_PER_THREAD + 1);
+
+    parallel_for(block_count, threads, CTR_File_Task, &job);
+
+    if(job.error){
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    Decryption of a file in CTR mode (same operation as the encryption).
+*/
+int AES_CTR_decryption(const AES_KEY_CONTEXT_T *context, const char* const encrypted_file_name, uint64_t nonce, const char* const decrypted_file_name, int threads)
+{
+    return AES_CTR_encryption(context, encrypted_file_name, nonce, decrypted_file_name, threads);
+}
+
+
+/*
+    Random access: decrypt "length" bytes starting at "offset" from a CTR encrypted file, reading only
+    these bytes and generating the keystream from the block offset/16.
+
+    Parameters:
+        - decrypted_data : output buffer of "length" bytes
+        - decrypted_size : number of bytes written (less than "length" if the range goes past the end of the file)
+*/
+int AES_CTR_decryption_range(const AES_KEY_CONTEXT_T *context, const char* const encrypted_file_name, uint64_t nonce, uint64_t offset, size_t length,
+                             uint8_t *decrypted_data, size_t *decrypted_size)
+{
+    FILE *encrypted_file = fopen(encrypted_file_name, "rb");
+
+    if(encrypted_file == NULL){
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+
+    length = file_read_at(encrypted_file, decrypted_data, length, (int64_t)offset);
+    fclose(encrypted_file);
+
+    AES_Block_Struct blocks[AES_FILE_CHUNK_BLOCKS];
+    uint8_t keystream[16 * AES_FILE_CHUNK_BLOCKS];
+    size_t done = 0;
+
+    while(done < length){
+        uint64_t block = (offset + done) / 16;
+        size_t skip = (offset + done) % 16;
+        size_t count = __min_(AES_FILE_CHUNK_BLOCKS, (skip + length - done + 15) / 16);
+        size_t size = __min_(16*count - skip, length - done);
+
+        AES_CTR_Keystream(context, nonce, block, blocks, keystream, count);
+        AES_Xor_Bytes(&decrypted_data[done], &keystream[skip], size);
+        done += size;
+    }
+
+    if(decrypted_size != NULL){
+        *decrypted_size = length;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+
+int AES128_CTR_encryption(const char* const plain_file_name, uint64_t key_msb, uint64_t key_lsb, uint64_t nonce, const char* const encrypted_file_name, int threads)
+{
+    AES_KEY_CONTEXT_T context;
+    AES128_Init_Key_Context(&context, key_msb, key_lsb);
+
+    return AES_CTR_encryption(&context, plain_file_name, nonce, encrypted_file_name, threads);
+}
+
+int AES128_CTR_decryption(const char* const encrypted_file_name, uint64_t key_msb, uint64_t key_lsb, uint64_t nonce, const char* const decrypted_file_name, int threads)
+{
+    AES_KEY_CONTEXT_T context;
+    AES128_Init_Key_Context(&context, key_msb, key_lsb);
+
+    return AES_CTR_decryption(&context, encrypted_file_name, nonce, decrypted_file_name, threads);
+}
+
+int AES128_CTR_decryption_range(const char* const encrypted_file_name, uint64_t key_msb, uint64_t key_lsb, uint64_t nonce, uint64_t offset, size_t length,
+                                uint8_t *decrypted_data, size_t *decrypted_size)
+{
+    AES_KEY_CONTEXT_T context;
+    AES128_Init_Key_Context(&context, key_msb, key_lsb);
+
+    return AES_CTR_decryption_range(&context, encrypted_file_name, nonce, offset, length, decrypted_data, decrypted_size);
+}
+
+
+
+
+
+/*
+    CBC: C[i] = E(P[i] ^ C[i-1]), C[-1] = IV, with the ANSI X9.23 padding of the ECB functions
+    (PKCS#7 padded data is also accepted by the decryption: only the last byte is checked).
+*/
+static inline void xor_block(AES_Block_Struct *block, const AES_Block_Struct *other)
+{
+    block->w0 ^= other->w0;
+    block->w1 ^= other->w1;
+    block->w2 ^= other->w2;
+    block->w3 ^= other->w3;
+}
+
+
+/*
+    Decrypt "count" blocks; "previous" is the ciphertext block that precedes input[0] (or the IV).
+    Every plaintext block only depends on two ciphertext blocks: the blocks are decrypted by chunks, so that
+    the backend works on many independent blocks at once. The input and output may be the same buffer.
+*/
+static void CBC_Decrypt_Blocks(const AES_KEY_CONTEXT_T *context, const uint8_t *previous, const uint8_t *input, uint8_t *output, size_t count)
+{
+    AES_Block_Struct blocks[AES_FILE_CHUNK_BLOCKS];
+    AES_Block_Struct chaining[AES_FILE_CHUNK_BLOCKS];
+    uint8_t last_block[16];
+
+    memcpy(last_block, previous, 16);
+
+    for(size_t i = 0; i < count; i += AES_FILE_CHUNK_BLOCKS){
+        size_t n = __min_(AES_FILE_CHUNK_BLOCKS, count - i);
+
+        AES_Load_Blocks(&input[16*i], blocks, n);
+        AES_Load_Blocks(last_block, &chaining[0], 1);
+        for(size_t j = 1; j < n; j++){
+            chaining[j] = blocks[j-1];
+        }
+        memcpy(last_block, &input[16*(i+n-1)], 16);
+
+        context->backend->decrypt_blocks(blocks, n, context);
+
+        for(size_t j = 0; j < n; j++){
+            xor_block(&blocks[j], &chaining[j]);
+        }
+        AES_Store_Blocks(blocks, &output[16*i], n);
+    }
+}
+
+
+/*
+    Encrypt "count" blocks of a single message (serial), "chaining" being the previous ciphertext block (or the IV).
+*/
+static void CBC_Encrypt_Blocks(const AES_KEY_CONTEXT_T *context, AES_Block_Struct *chaining, const uint8_t *input, uint8_t *output, size_t count)
+{
+    AES_Block_Struct block;
+
+    for(size_t i = 0; i < count; i++){
+        AES_Load_Blocks(&input[16*i], &block, 1);
+        xor_block(&block, chaining);
+        context->backend->encrypt_blocks(&block, 1, context);
+        AES_Store_Blocks(&block, &output[16*i], 1);
+        *chaining = block;
+    }
+}
+
+
+/*
+    Encryption of a memory buffer in CBC mode.
+
+    Parameters:
+        - iv             : 16 bytes, unpredictable for each message
+        - encrypted_data : output buffer, at least AES_Encrypted_Size(plain_size) bytes; it may be plain_data itself
+*/
+int AES_CBC_encryption_buffer(const AES_KEY_CONTEXT_T *context, const uint8_t *iv, const uint8_t *plain_data, size_t plain_size,
+                              uint8_t *encrypted_data, size_t *encrypted_size)
+{
+    if(  (iv == NULL) || ((plain_data == NULL) && (plain_size > 0)) || (encrypted_data == NULL)  ){
+        printf("AES Error: invalid buffer.\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t q = plain_size / 16;
+    AES_Block_Struct chaining;
+    uint8_t last_block[16];
+
+    /* the last bytes are copied first, in case the encryption is done in place */
+    AES_Pad_Last_Block(&plain_data[16*q], plain_size % 16, last_block);
+    AES_Load_Blocks(iv, &chaining, 1);
+
+    CBC_Encrypt_Blocks(context, &chaining, plain_data, encrypted_data, q);
+    CBC_Encrypt_Blocks(context, &chaining, last_block, &encrypted_data[16*q], 1);
+
+    if(encrypted_size != NULL){
+        *encrypted_size = 16 * (q+1);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+
+typedef struct {
+    const AES_KEY_CONTEXT_T *context;
+    const uint8_t *input;
+    uint8_t *output;
+    uint64_t block_count;
+    const uint8_t *previous_blocks;         // ciphertext block preceding each segment, saved before any output is written
+} AES_CBC_BUFFER_JOB_T;
+
+
+static void CBC_Buffer_Task(uint64_t first_segment, uint64_t end_segment, void *arg)
+{
+    AES_CBC_BUFFER_JOB_T *job = (AES_CBC_BUFFER_JOB_T*)arg;
+
+    for(uint64_t segment = first_segment; segment < end_segment; segment++){
+        uint64_t first_block = segment * AES_CBC_MIN_BLOCKS_PER_THREAD;
+        uint64_t count = __min_((uint64_t)AES_CBC_MIN_BLOCKS_PER_THREAD, job->block_count - first_block);
+
+        CBC_Decrypt_Blocks(job->context, &job->previous_blocks[16*segment], &job->input[16*first_block], &job->output[16*first_block], count);
+    }
+}
+
+
+/*
+    Decryption of a memory buffer in CBC mode; large buffers are split in segments decrypted by worker threads.
+
+    Parameters:
+        - decrypted_data : output buffer, at least encrypted_size bytes; it may be encrypted_data itself
+        - threads        : number of worker threads (0 = one per CPU)
+*/
+int AES_CBC_decryption_buffer(const AES_KEY_CONTEXT_T *context, const uint8_t *iv, const uint8_t *encrypted_data, size_t encrypted_size,
+                              uint8_t *decrypted_data, size_t *decrypted_size, int threads)
+{
+    if(  (iv == NULL) || (encrypted_data == NULL) || (decrypted_data == NULL) || (encrypted_size == 0) || ((encrypted_size % 16) > 0)  ){
+        printf("AES Error: invalid buffer.\n");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t q = encrypted_size / 16;
+    uint64_t segment_count = (q + AES_CBC_MIN_BLOCKS_PER_THREAD - 1) / AES_CBC_MIN_BLOCKS_PER_THREAD;
+
+    if(threads <= 0){
+        threads = get_cpu_count();
+    }
+
+    if(  (threads == 1) || (segment_count == 1)  ){
+        CBC_Decrypt_Blocks(context, iv, encrypted_data, decrypted_data, q);
+    }
+    else{
+        uint8_t *previous_blocks = (uint8_t*)malloc(16 * segment_count);
+        if(previous_blocks == NULL){
+            printf("AES Error: memory allocation failed.\n");
+            return EXIT_FAILURE;
+        }
+
+        memcpy(previous_blocks, iv, 16);
+        for(uint64_t segment = 1; segment < segment_count; segment++){
+            memcpy(&previous_blocks[16*segment], &encrypted_data[16*(segment * AES_CBC_MIN_BLOCKS_PER_THREAD - 1)], 16);
+        }
+
+        AES_CBC_BUFFER_JOB_T job = {context, encrypted_data, decrypted_data, q, previous_blocks};
+        parallel_for(segment_count, threads, CBC_Buffer_Task, &job);
+
+        free(previous_blocks);
+    }
+
+    int last_bytes_count = AES_Unpadded_Size(&decrypted_data[16*(q-1)]);
+    if(last_bytes_count == -1){
+        printf("AES Error: wrong padding.\n");
+        return EXIT_FAILURE;
+    }
+
+    if(decrypted_size != NULL){
+        *decrypted_size = 16*(q-1) + last_bytes_count;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+
+/*
+    Multi-buffer CBC encryption: each message is serial, but up to AES_CBC_LANES independent messages are
+    encrypted together, one block of each per backend call, so that the backend pipeline stays full.
+    A lane is given the next pending message as soon as its message is finished.
+*/
+typedef struct {
+    AES_CBC_MESSAGE_T *message;
+    AES_Block_Struct chaining;
+    size_t block_index;
+    size_t block_count;             // including the padding block
+} CBC_LANE_T;
+
+
+static void cbc_lane_start(CBC_LANE_T *lane, AES_CBC_MESSAGE_T *message)
+{
+    lane->message = message;
+    lane->block_index = 0;
+    lane->block_count = message->plain_size / 16 + 1;
+    AES_Load_Blocks(message->iv, &lane->chaining, 1);
+}
+
+
+int AES_CBC_encryption_multi(const AES_KEY_CONTEXT_T *context, AES_CBC_MESSAGE_T *messages, int message_count)
+{
+    CBC_LANE_T lanes[AES_CBC_LANES];
+    AES_Block_Struct blocks[AES_CBC_LANES];
+    int active = 0;
+    int next_message = 0;
+
+    for(int i = 0; i < message_count; i++){
+        if(  (messages[i].iv == NULL) || ((messages[i].plain_data == NULL) && (messages[i].plain_size > 0)) || (messages[i].encrypted_data == NULL)  ){
+            printf("AES Error: invalid buffer.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    while(  (active < AES_CBC_LANES) && (next_message < message_count)  ){
+        cbc_lane_start(&lanes[active++], &messages[next_message++]);
+    }
+
+    while(active > 0){
+        /* gather the next block of every lane */
+        for(int l = 0; l < active; l++){
+            AES_CBC_MESSAGE_T *message = lanes[l].message;
+            size_t index = lanes[l].block_index;
+
+            if(index < lanes[l].block_count - 1){
+                AES_Load_Blocks(&message->plain_data[16*index], &blocks[l], 1);
+            }
+            else{
+                uint8_t last_block[16];
+                AES_Pad_Last_Block(&message->plain_data[16*index], message->plain_size % 16, last_block);
+                AES_Load_Blocks(last_block, &blocks[l], 1);
+            }
+            xor_block(&blocks[l], &lanes[l].chaining);
+        }
+
+        context->backend->encrypt_blocks(blocks, active, context);
+
+        /* scatter, and replace the finished messages */
+        for(int l = 0; l < active; l++){
+            AES_CBC_MESSAGE_T *message = lanes[l].message;
+
+            AES_Store_Blocks(&blocks[l], &message->encrypted_data[16 * lanes[l].block_index], 1);
+            lanes[l].chaining = blocks[l];
+            lanes[l].block_index++;
+
+            if(lanes[l].block_index == lanes[l].block_count){
+                message->encrypted_size = 16 * lanes[l].block_count;
+
+                if(next_message < message_count){
+                    cbc_lane_start(&lanes[l], &messages[next_message++]);
+                }
+                else{
+                    /* move the last lane here (its block is processed below) */
+                    active--;
+                    lanes[l] = lanes[active];
+                    blocks[l] = blocks[active];
+                    l--;
+                }
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+
+/*
+    Encryption of a file in CBC mode: IV (16 bytes) || encrypted data.
+*/
+int AES_CBC_encryption(const AES_KEY_CONTEXT_T *context, const char* const plain_file_name, const uint8_t *iv, const char* const encrypted_file_name)
+{
+    FILE *plain_file = fopen(plain_file_name, "rb");
+    FILE *encrypted_file = fopen(encrypted_file_name, "wb");
+
+    if(  (plain_file == NULL) || (encrypted_file == NULL)  ){
+        if(plain_file != NULL)
+            fclose(plain_file);
+        if(encrypted_file != NULL)
+            fclose(encrypted_file);
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+
+    AES_Block_Struct chaining;
+    AES_Load_Blocks(iv, &chaining, 1);
+    fwrite(iv, sizeof(uint8_t), 16, encrypted_file);
+
+    uint8_t data_buffer[16 * AES_FILE_CHUNK_BLOCKS];
+    size_t size;
+
+    /* a short read is the end of the file: the remaining bytes are padded */
+    do{
+        size = fread(data_buffer, sizeof(uint8_t), sizeof(data_buffer), plain_file);
+        size_t q = size / 16;
+
+        if(size < sizeof(data_buffer)){
+            uint8_t last_block[16];
+            AES_Pad_Last_Block(&data_buffer[16*q], size % 16, last_block);
+            memcpy(&data_buffer[16*q], last_block, 16);
+            q++;
+        }
+
+        CBC_Encrypt_Blocks(context, &chaining, data_buffer, data_buffer, q);
+        fwrite(data_buffer, 16, q, encrypted_file);
+    } while(size == sizeof(data_buffer));
+
+    fclose(plain_file);
+    fclose(encrypted_file);
+
+    return EXIT_SUCCESS;
+}
+
+
+
+typedef struct {
+    const char *input_file_name;
+    const char *output_file_name;
+    const AES_KEY_CONTEXT_T *context;
+    int error;
+} AES_CBC_FILE_JOB_T;
+
+
+/*
+    Worker: decrypt the blocks [first_block, end_block) of the encrypted data (the IV is at the beginning of the file).
+*/
+static void CBC_File_Task(uint64_t first_block, uint64_t end_block, void *arg)
+{
+    AES_CBC_FILE_JOB_T *job = (AES_CBC_FILE_JOB_T*)arg;
+
+    FILE *input_file = fopen(job->input_file_name, "rb");
+    FILE *output_file = fopen(job->output_file_name, "r+b");
+
+    if(  (input_file == NULL) || (output_file == NULL)
+      || (file_seek_64(input_file, (int64_t)first_block * 16) == EXIT_FAILURE)
+      || (file_seek_64(output_file, (int64_t)first_block * 16) == EXIT_FAILURE)  ){
+        job->error = 1;
+    }
+    else{
+        uint8_t previous[16];
+        uint8_t data_buffer[16 * AES_FILE_CHUNK_BLOCKS];
+
+        fread(previous, sizeof(uint8_t), 16, input_file);         // block preceding first_block (or the IV)
+
+        for(uint64_t block = first_block; block < end_block; block += AES_FILE_CHUNK_BLOCKS){
+            size_t count = (size_t)__min_((uint64_t)AES_FILE_CHUNK_BLOCKS, end_block - block);
+            uint8_t chunk_previous[16];
+
+            memcpy(chunk_previous, previous, 16);
+
+            fread(data_buffer, 16, count, input_file);
+            memcpy(previous, &data_buffer[16*(count-1)], 16);
+            CBC_Decrypt_Blocks(job->context, chunk_previous, data_buffer, data_buffer, count);
+            fwrite(data_buffer, 16, count, output_file);
+        }
+    }
+
+    if(input_file != NULL)
+        fclose(input_file);
+    if(output_file != NULL)
+        fclose(output_file);
+}
+
+
+/*
+    Decryption of a file in CBC mode. The last block is decrypted first to find the size of the output,
+    then the other blocks are split in contiguous ranges processed by worker threads.
+
+    Parameters:
+        - threads: number of worker threads (0 = one per CPU)
+*/
+int AES_CBC_decryption(const AES_KEY_CONTEXT_T *context, const char* const encrypted_file_name, const char* const decrypted_file_name, int threads)
+{
+    int64_t filesize = get_filesize_64(encrypted_file_name);
+    FILE *encrypted_file = fopen(encrypted_file_name, "rb");
+    FILE *decrypted_file = fopen(decrypted_file_name, "wb");         // create (or truncate) the output file
+
+    if(  (encrypted_file == NULL) || (decrypted_file == NULL) || (filesize < 32) || ((filesize % 16) > 0)  ){
+        if(encrypted_file != NULL)
+            fclose(encrypted_file);
+        if(decrypted_file != NULL)
+            fclose(decrypted_file);
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+
+    /* last block (padding) */
+    uint64_t q = (uint64_t)filesize / 16 - 1;        // number of encrypted blocks
+    uint8_t last_blocks[32];
+    uint8_t last_block[16];
+
+    file_seek_64(encrypted_file, (int64_t)(q-1) * 16);
+    fread(last_blocks, sizeof(uint8_t), 32, encrypted_file);
+    fclose(encrypted_file);
+    CBC_Decrypt_Blocks(context, &last_blocks[0], &last_blocks[16], last_block, 1);
+
+    int last_bytes_count = AES_Unpadded_Size(last_block);
+    if(last_bytes_count == -1){
+        fclose(decrypted_file);
+        printf("AES Error: wrong padding.\n");
+        return EXIT_FAILURE;
+    }
+    file_seek_64(decrypted_file, (int64_t)(q-1) * 16);
+    fwrite(last_block, sizeof(uint8_t), last_bytes_count, decrypted_file);
+    fclose(decrypted_file);
+
+    /* other blocks */
+    AES_CBC_FILE_JOB_T job = {encrypted_file_name, decrypted_file_name, context, 0};
+
+    if(threads <= 0){
+        threads = get_cpu_count();
+    }
+    threads = (int)__min_((uint64_t)threads, (q-1) / AES_CBC_MIN_BLOCKS_PER_THREAD + 1);
+
+    parallel_for(q-1, threads, CBC_File_Task, &job);
+
+    if(job.error){
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,244 @@
+/*
+    AES-CTR keystream reservoir, for latency-sensitive small messages.
+
+    A background thread computes the future keystream blocks of a CTR stream ahead of time into a ring
+    buffer; encrypting a message is then only a XOR with keystream bytes already in memory.
+    The messages are consecutive parts of a single CTR stream (same counter blocks as AES_CTR_encryption(),
+    starting at block 0): each call returns the stream offset of its message so that the receiver can find
+    its keystream. When the reservoir is empty, the caller computes AES_RESERVOIR_INLINE_BLOCKS blocks
+    itself ("inline"), keeps the unused ones in the ring, and the background thread resumes after them.
+
+    A single background thread produces at most one core's worth of keystream. The reservoir absorbs bursts
+    and keeps the latency of occasional messages low; several consumer threads that are busy all the time
+    consume faster than that, and most of their blocks are then generated inline (see the inline_blocks
+    and refilled_blocks metrics).
+
+    Ring state (protected by the mutex): keystream blocks [ring_first, ring_end) are available, block n
+    being stored at index n % capacity; ring_first is the block holding the next unused byte.
+*/
+#include "AES_backends.h"
+#include <time.h>
+
+
+#define AES_RESERVOIR_REFILL_BLOCKS     256         // blocks computed by the background thread per batch
+#define AES_RESERVOIR_INLINE_BLOCKS     16          // blocks computed by a caller when the reservoir is empty
+
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+
+/*
+    Copy "count" keystream blocks starting at block "first" into the ring (the mutex is held).
+*/
+static void ring_store(AES_CTR_RESERVOIR_T *reservoir, uint64_t first, const uint8_t *keystream, size_t count)
+{
+    for(size_t i = 0; i < count; ){
+        size_t index = (size_t)((first + i) % reservoir->capacity);
+        size_t n = __min_(count - i, reservoir->capacity - index);
+
+        memcpy(&reservoir->ring[16*index], &keystream[16*i], 16*n);
+        i += n;
+    }
+}
+
+
+static void* Reservoir_Refill_Thread(void *arg)
+{
+    AES_CTR_RESERVOIR_T *reservoir = (AES_CTR_RESERVOIR_T*)arg;
+    AES_Block_Struct blocks[AES_RESERVOIR_REFILL_BLOCKS];
+    uint8_t keystream[16 * AES_RESERVOIR_REFILL_BLOCKS];
+
+    pthread_mutex_lock(&reservoir->mutex);
+
+    while(reservoir->running){
+        size_t free_blocks = reservoir->capacity - (size_t)(reservoir->ring_end - reservoir->ring_first);
+
+        if(free_blocks == 0){
+            pthread_cond_wait(&reservoir->refill, &reservoir->mutex);
+            continue;
+        }
+
+        /* the keystream is computed without holding the mutex */
+        uint64_t first = reservoir->ring_end;
+        size_t count = __min_(AES_RESERVOIR_REFILL_BLOCKS, free_blocks);
+        pthread_mutex_unlock(&reservoir->mutex);
+
+        uint64_t start = monotonic_ns();
+        AES_CTR_Keystream(reservoir->context, reservoir->nonce, first, blocks, keystream, count);
+        uint64_t duration = monotonic_ns() - start;
+
+        pthread_mutex_lock(&reservoir->mutex);
+
+        /*
+            Consumers may have generated some of these blocks inline meanwhile: the keystream being the same,
+            only the blocks still ahead of ring_end are stored (the ring had room for all of them).
+        */
+        uint64_t keep_first = __max_(reservoir->ring_end, first);
+        if(keep_first < first + count){
+            ring_store(reservoir, keep_first, &keystream[16*(keep_first - first)], (size_t)(first + count - keep_first));
+            reservoir->refilled_blocks += first + count - keep_first;
+            reservoir->ring_end = first + count;
+        }
+        reservoir->refill_ns += duration;
+    }
+
+    pthread_mutex_unlock(&reservoir->mutex);
+    memset(keystream, 0, sizeof(keystream));
+
+    return NULL;
+}
+
+
+
+/*
+    Parameters:
+        - context         : expanded key, must stay valid until AES_CTR_Reservoir_Free()
+        - nonce           : same counter block format as AES_CTR_encryption(), the stream starts at block 0
+        - capacity_blocks : size of the ring buffer, in 16-bytes keystream blocks
+    If the background thread cannot be started, the reservoir still works with inline generation only.
+*/
+int AES_CTR_Reservoir_Init(AES_CTR_RESERVOIR_T *reservoir, const AES_KEY_CONTEXT_T *context, uint64_t nonce, size_t capacity_blocks)
+{
+    if(capacity_blocks == 0){
+        printf("AES Error: invalid reservoir capacity.\n");
+        return EXIT_FAILURE;
+    }
+
+    reservoir->ring = (uint8_t*)malloc(16 * capacity_blocks);
+    if(reservoir->ring == NULL){
+        printf("AES Error: memory allocation failed.\n");
+        return EXIT_FAILURE;
+    }
+
+    reservoir->context = context;
+    reservoir->nonce = nonce;
+    reservoir->capacity = capacity_blocks;
+    reservoir->position = 0;
+    reservoir->ring_first = 0;
+    reservoir->ring_end = 0;
+    reservoir->refilled_blocks = 0;
+    reservoir->refill_ns = 0;
+    reservoir->inline_blocks = 0;
+    reservoir->reservoir_bytes = 0;
+
+    pthread_mutex_init(&reservoir->mutex, NULL);
+    pthread_cond_init(&reservoir->refill, NULL);
+
+    reservoir->running = 1;
+    if(pthread_create(&reservoir->thread, NULL, Reservoir_Refill_Thread, reservoir) != 0){
+        reservoir->running = 0;
+    }
+    reservoir->thread_started = reservoir->running;
+
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    Encrypt (or decrypt) the next "size" bytes of the stream: output = input ^ keystream.
+    The input and output are either the same buffer or do not overlap; stream_offset (may be NULL) receives the offset of the
+    message in the CTR stream.
+*/
+int AES_CTR_Reservoir_Process(AES_CTR_RESERVOIR_T *reservoir, const uint8_t *input, uint8_t *output, size_t size, uint64_t *stream_offset)
+{
+    if(  ((input == NULL) || (output == NULL)) && (size > 0)  ){
+        printf("AES Error: invalid buffer.\n");
+        return EXIT_FAILURE;
+    }
+
+    pthread_mutex_lock(&reservoir->mutex);
+
+    if(stream_offset != NULL){
+        *stream_offset = reservoir->position;
+    }
+
+    size_t done = 0;
+    while(done < size){
+        uint64_t block = reservoir->position / 16;
+        size_t skip = (size_t)(reservoir->position % 16);
+        size_t available = (size_t)(reservoir->ring_end - block);
+
+        if(available > 0){
+            /* keystream from the ring (contiguous part) */
+            size_t index = (size_t)(block % reservoir->capacity);
+            size_t count = __min_(available, reservoir->capacity - index);
+            size_t n = __min_(16*count - skip, size - done);
+
+            AES_Xor_Keystream(&input[done], &output[done], &reservoir->ring[16*index + skip], n);
+            reservoir->reservoir_bytes += n;
+            done += n;
+            reservoir->position += n;
+        }
+        else{
+            /*
+                reservoir empty (then the whole ring is free): compute a full pipeline of blocks here, even for
+                a short message, and keep the unused ones in the ring for the next messages
+            */
+            AES_Block_Struct blocks[AES_RESERVOIR_INLINE_BLOCKS];
+            uint8_t keystream[16 * AES_RESERVOIR_INLINE_BLOCKS];
+            size_t count = __min_(AES_RESERVOIR_INLINE_BLOCKS, reservoir->capacity);
+            size_t n = __min_(16*count - skip, size - done);
+
+            AES_CTR_Keystream(reservoir->context, reservoir->nonce, block, blocks, keystream, count);
+            AES_Xor_Keystream(&input[done], &output[done], &keystream[skip], n);
+            reservoir->inline_blocks += count;
+            done += n;
+            reservoir->position += n;
+
+            ring_store(reservoir, block, keystream, count);
+            reservoir->ring_end = block + count;
+            memset(keystream, 0, sizeof(keystream));
+        }
+
+        reservoir->ring_first = reservoir->position / 16;
+    }
+
+    pthread_cond_signal(&reservoir->refill);
+    pthread_mutex_unlock(&reservoir->mutex);
+
+    return EXIT_SUCCESS;
+}
+
+
+void AES_CTR_Reservoir_Get_Metrics(AES_CTR_RESERVOIR_T *reservoir, AES_CTR_RESERVOIR_METRICS_T *metrics)
+{
+    pthread_mutex_lock(&reservoir->mutex);
+
+    metrics->capacity_blocks = reservoir->capacity;
+    metrics->fill_blocks = (size_t)(reservoir->ring_end - reservoir->ring_first);
+    metrics->refilled_blocks = reservoir->refilled_blocks;
+    metrics->refill_rate = (reservoir->refill_ns > 0) ? (double)reservoir->refilled_blocks * 1e9 / (double)reservoir->refill_ns : 0.0;
+    metrics->inline_blocks = reservoir->inline_blocks;
+    metrics->reservoir_bytes = reservoir->reservoir_bytes;
+
+    pthread_mutex_unlock(&reservoir->mutex);
+}
+
+
+/*
+    Stop the background thread and erase the keystream.
+*/
+void AES_CTR_Reservoir_Free(AES_CTR_RESERVOIR_T *reservoir)
+{
+    pthread_mutex_lock(&reservoir->mutex);
+    reservoir->running = 0;
+    pthread_cond_signal(&reservoir->refill);
+    pthread_mutex_unlock(&reservoir->mutex);
+
+    if(reservoir->thread_started){
+        pthread_join(reservoir->thread, NULL);
+    }
+
+    pthread_mutex_destroy(&reservoir->mutex);
+    pthread_cond_destroy(&reservoir->refill);
+
+    memset(reservoir->ring, 0, 16 * reservoir->capacity);
+    free(reservoir->ring);
+    reservoir->ring = NULL;
+}
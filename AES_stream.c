@@ -0,0 +1,208 @@
+/*
+    Incremental (init/update/final) AES interface, for data whose size is not known in advance
+    (pipes, sockets, growing files).
+
+    - ECB: the partial block is kept in the stream; the X9.23 padding is added (or checked) by AES_Stream_Final().
+      The decryption always holds back the last complete block, which may be the padding block.
+    - CTR: the output has the size of the input; the unused bytes of the last keystream block are kept
+      for the next update.
+*/
+#include "AES_backends.h"
+
+
+static void stream_init(AES_STREAM_T *stream, const AES_KEY_CONTEXT_T *context, AES_STREAM_MODE_T mode, uint64_t nonce)
+{
+    stream->context = context;
+    stream->mode = mode;
+    stream->buffered = 0;
+    stream->nonce = nonce;
+    stream->counter = 0;
+    memset(stream->buffer, 0, 16);
+}
+
+
+/*
+    mode: AES_ENCRYPTION_MODE or AES_DECRYPTION_MODE
+*/
+void AES_ECB_Stream_Init(AES_STREAM_T *stream, const AES_KEY_CONTEXT_T *context, int mode)
+{
+    stream_init(stream, context, (mode == AES_ENCRYPTION_MODE) ? AES_STREAM_ECB_ENCRYPTION : AES_STREAM_ECB_DECRYPTION, 0);
+}
+
+
+/*
+    nonce: same counter block format as AES_CTR_encryption(), the stream starts at block 0
+*/
+void AES_CTR_Stream_Init(AES_STREAM_T *stream, const AES_KEY_CONTEXT_T *context, uint64_t nonce)
+{
+    stream_init(stream, context, AES_STREAM_CTR, nonce);
+    stream->buffered = 16;          // no keystream byte available
+}
+
+
+
+static size_t ECB_Stream_Update(AES_STREAM_T *stream, const uint8_t *input, size_t input_size, uint8_t *output)
+{
+    int mode = (stream->mode == AES_STREAM_ECB_ENCRYPTION) ? AES_ENCRYPTION_MODE : AES_DECRYPTION_MODE;
+    size_t output_size = 0;
+
+    while(input_size > 0){
+        /* complete blocks are processed directly from the input */
+        if(stream->buffered == 0 && input_size >= 16){
+            size_t block_count = input_size / 16;
+
+            if(  (mode == AES_DECRYPTION_MODE) && (input_size % 16 == 0)  )
+                block_count--;          // hold back the last block
+
+            if(block_count > 0){
+                AES_ECB_Process_Blocks(stream->context, input, &output[output_size], block_count, mode);
+                input += 16 * block_count;
+                input_size -= 16 * block_count;
+                output_size += 16 * block_count;
+                continue;
+            }
+        }
+
+        size_t size = __min_(16 - stream->buffered, input_size);
+        memcpy(&stream->buffer[stream->buffered], input, size);
+        stream->buffered += size;
+        input += size;
+        input_size -= size;
+
+        /* a full buffer is processed, unless it may be the last block of a decryption */
+        if(  (stream->buffered == 16) && ((mode == AES_ENCRYPTION_MODE) || (input_size > 0))  ){
+            AES_ECB_Process_Blocks(stream->context, stream->buffer, &output[output_size], 1, mode);
+            output_size += 16;
+            stream->buffered = 0;
+        }
+    }
+
+    return output_size;
+}
+
+
+static size_t CTR_Stream_Update(AES_STREAM_T *stream, const uint8_t *input, size_t input_size, uint8_t *output)
+{
+    AES_Block_Struct blocks[AES_FILE_CHUNK_BLOCKS];
+    uint8_t keystream[16 * AES_FILE_CHUNK_BLOCKS];
+    size_t done = 0;
+
+    /* remaining bytes of the current keystream block */
+    size_t size = __min_(16 - stream->buffered, input_size);
+    AES_Xor_Keystream(input, output, &stream->buffer[stream->buffered], size);
+    stream->buffered += size;
+    done = size;
+
+    /* complete blocks */
+    while(input_size - done >= 16){
+        size_t count = __min_(AES_FILE_CHUNK_BLOCKS, (input_size - done) / 16);
+
+        AES_CTR_Keystream(stream->context, stream->nonce, stream->counter, blocks, keystream, count);
+        stream->counter += count;
+
+        AES_Xor_Keystream(&input[done], &output[done], keystream, 16 * count);
+        done += 16 * count;
+    }
+
+    /* tail: the rest of the keystream block is kept */
+    if(done < input_size){
+        AES_CTR_Keystream(stream->context, stream->nonce, stream->counter, blocks, stream->buffer, 1);
+        stream->counter++;
+
+        size = input_size - done;
+        AES_Xor_Keystream(&input[done], &output[done], stream->buffer, size);
+        stream->buffered = size;
+    }
+
+    return input_size;
+}
+
+
+/*
+    Process "input_size" bytes (any size).
+    The output buffer must have room for input_size + 16 bytes; output_size receives the number of bytes written.
+    In CTR mode, the output may be the input buffer (in-place processing). In ECB mode, the buffers must not
+    overlap: the bytes kept from the previous update put the output up to 15 bytes ahead of the input.
+*/
+int AES_Stream_Update(AES_STREAM_T *stream, const uint8_t *input, size_t input_size, uint8_t *output, size_t *output_size)
+{
+    if(  ((input == NULL) && (input_size > 0)) || (output == NULL)  ){
+        printf("AES Error: invalid buffer.\n");
+        return EXIT_FAILURE;
+    }
+
+    if(stream->mode == AES_STREAM_CTR)
+        *output_size = CTR_Stream_Update(stream, input, input_size, output);
+    else
+        *output_size = ECB_Stream_Update(stream, input, input_size, output);
+
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    End of the data: ECB encryption writes the padding block (16 bytes), ECB decryption writes the 0 to 15
+    data bytes of the last block after checking the padding, CTR writes nothing.
+*/
+int AES_Stream_Final(AES_STREAM_T *stream, uint8_t *output, size_t *output_size)
+{
+    int status = EXIT_SUCCESS;
+    *output_size = 0;
+
+    if(stream->mode == AES_STREAM_ECB_ENCRYPTION){
+        uint8_t last_block[16];
+
+        AES_Pad_Last_Block(stream->buffer, stream->buffered, last_block);
+        AES_ECB_Process_Blocks(stream->context, last_block, output, 1, AES_ENCRYPTION_MODE);
+        *output_size = 16;
+    }
+    else if(stream->mode == AES_STREAM_ECB_DECRYPTION){
+        int last_bytes_count = -1;
+
+        if(stream->buffered == 16){
+            AES_ECB_Process_Blocks(stream->context, stream->buffer, stream->buffer, 1, AES_DECRYPTION_MODE);
+            last_bytes_count = AES_Unpadded_Size(stream->buffer);
+        }
+
+        if(last_bytes_count == -1){
+            printf("AES Error: wrong padding.\n");
+            status = EXIT_FAILURE;
+        }
+        else{
+            memcpy(output, stream->buffer, last_bytes_count);
+            *output_size = last_bytes_count;
+        }
+    }
+
+    /* the stream must be initialized again before reuse */
+    memset(stream->buffer, 0, 16);
+    stream->buffered = 0;
+
+    return status;
+}
+
+
+/*
+    Process a whole FILE (which may be a pipe or a socket) until the end of the input, then call AES_Stream_Final().
+*/
+int AES_Stream_File(AES_STREAM_T *stream, FILE *input_file, FILE *output_file)
+{
+    uint8_t input_buffer[16 * AES_FILE_CHUNK_BLOCKS];
+    uint8_t output_buffer[16 * AES_FILE_CHUNK_BLOCKS + 16];
+    size_t input_size, output_size;
+
+    if(  (input_file == NULL) || (output_file == NULL)  ){
+        printf("AES Error: cannot open files.\n");
+        return EXIT_FAILURE;
+    }
+
+    while(  (input_size = fread(input_buffer, sizeof(uint8_t), sizeof(input_buffer), input_file)) > 0  ){
+        AES_Stream_Update(stream, input_buffer, input_size, output_buffer, &output_size);
+        fwrite(output_buffer, sizeof(uint8_t), output_size, output_file);
+    }
+
+    int status = AES_Stream_Final(stream, output_buffer, &output_size);
+    fwrite(output_buffer, sizeof(uint8_t), output_size, output_file);
+
+    return status;
+}
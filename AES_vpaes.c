@@ -0,0 +1,451 @@
+/*
+    Vector-permute AES backend (after M. Hamburg, "Accelerating AES with Vector Permute Instructions", CHES 2009):
+    constant-time AES on one block at a time, for CPUs with SSSE3 but without AES-NI.
+
+    SubBytes is computed with 16-entries lookups done by PSHUFB on the nibbles of the state, so that no
+    memory access depends on the data or on the key. The inversion in GF(2^8) uses the tower field
+    GF(16)[y]/(y^2 + c.y + c): a byte x = i.y + k is split in two GF(16) nibbles (i, k), and with j = i + k,
+        io = 1/(1/(1/i + c/k)) + j = N/(k + c.i)       N = x.conj(x) = c.i^2 + c.i.k + k^2
+        jo = 1/(1/(1/j + c/k)) + i = N/(k + c.j)
+    1/x is then a linear function of 1/io and 1/jo, so the S-box output is Tu[io] ^ Tt[jo] ^ 0x63 with
+    two more lookups. Divisions by 0 give 0x80, which makes the next PSHUFB return 0: this handles the
+    zero nibbles and x = 0 without branches.
+    The lookup tables (basis change, inverses, outputs) are computed from the field arithmetic at
+    initialization.
+
+    Encryption: the S-box constant 0x63 is folded into the round keys (it goes unchanged through MixColumns)
+    and the tables also give 2.S(x) for MixColumns. Decryption runs the straightforward inverse cipher
+    (the decryption sub-keys are the encryption ones).
+*/
+#include "AES_backends.h"
+
+#if AES_X86_BACKENDS
+
+#include <immintrin.h>
+
+
+#define VPAES_TARGET            __attribute__((target("sse2,ssse3")))
+
+
+typedef struct {
+    uint8_t ipt_lo[16];             // x -> (i, k) basis change, low and high nibbles of x
+    uint8_t ipt_hi[16];
+    uint8_t dipt_lo[16];            // x -> (i, k) of the inverse affine transformation of x (decryption)
+    uint8_t dipt_hi[16];
+    uint8_t inv[16];                // 1/n in GF(16), 1/0 = 0x80
+    uint8_t inv_c[16];              // c/n in GF(16), c/0 = 0x80
+    uint8_t sbu[16];                // encryption output: S(x) ^ 0x63 = sbu[io] ^ sbt[jo]
+    uint8_t sbt[16];
+    uint8_t sb2u[16];               // 2.(S(x) ^ 0x63)
+    uint8_t sb2t[16];
+    uint8_t dsbu[16];               // decryption output: 1/x = dsbu[io] ^ dsbt[jo]
+    uint8_t dsbt[16];
+} VPAES_TABLES_T;
+
+static VPAES_TABLES_T vpaes_tables;
+static pthread_once_t vpaes_tables_once = PTHREAD_ONCE_INIT;
+
+
+
+static uint8_t gf_multiply(uint8_t a, uint8_t b)
+{
+    uint8_t result = 0;
+
+    while(b){
+        if(b & 1)
+            result ^= a;
+        a = (uint8_t)((a << 1) ^ ((a & 0x80) ? 0x1b : 0));
+        b >>= 1;
+    }
+    return result;
+}
+
+static uint8_t gf_power(uint8_t a, int exponent)
+{
+    uint8_t result = 1;
+
+    for(int i = 0; i < exponent; i++){
+        result = gf_multiply(result, a);
+    }
+    return result;
+}
+
+static uint8_t gf_inverse(uint8_t a)
+{
+    return gf_power(a, 254);            // 0 -> 0
+}
+
+
+/* linear part of the S-box affine transformation, and its inverse */
+static uint8_t affine(uint8_t b)
+{
+    uint8_t result = b;
+    for(int i = 1; i <= 4; i++){
+        result ^= (uint8_t)((b << i) | (b >> (8-i)));
+    }
+    return result;
+}
+
+static uint8_t inv_affine(uint8_t b)
+{
+    return (uint8_t)(((b << 1) | (b >> 7)) ^ ((b << 3) | (b >> 5)) ^ ((b << 6) | (b >> 2)));
+}
+
+
+/*
+    GF(16) is the subfield {x : x^16 = x} of GF(2^8); its elements are written on 4 bits in the basis
+    (1, b, b^2, b^3), b = 0x03^17 being of order 15. y is an element of GF(2^8) outside GF(16) with
+    y + y^16 = y^17 (= c): its minimal polynomial over GF(16) is y^2 + c.y + c.
+*/
+static void VPAES_Init_Tables(void)
+{
+    VPAES_TABLES_T *t = &vpaes_tables;
+    uint8_t nibble_to_field[16], field_to_nibble[256];
+    uint8_t to_tower[256];
+    uint8_t b = gf_power(0x03, 17);
+    uint8_t y = 0, c = 0;
+
+    for(int n = 0; n < 16; n++){
+        uint8_t value = 0;
+        for(int bit = 0; bit < 4; bit++){
+            if((n >> bit) & 1)
+                value ^= gf_power(b, bit);
+        }
+        nibble_to_field[n] = value;
+        field_to_nibble[value] = (uint8_t)n;
+    }
+
+    for(int candidate = 2; candidate < 256; candidate++){
+        uint8_t y16 = gf_power((uint8_t)candidate, 16);
+        if(  (y16 != candidate) && ((candidate ^ y16) == gf_multiply(y16, (uint8_t)candidate))  ){
+            y = (uint8_t)candidate;
+            c = (uint8_t)(candidate ^ y16);
+            break;
+        }
+    }
+
+    /* x = i.y + k  ->  (i << 4) | k */
+    for(int i = 0; i < 16; i++){
+        for(int k = 0; k < 16; k++){
+            to_tower[gf_multiply(nibble_to_field[i], y) ^ nibble_to_field[k]] = (uint8_t)((i << 4) | k);
+        }
+    }
+
+    /*
+        With u = 1/io = (k + c.i)/N and v = 1/jo = (k + c.i + c.k)/N:
+        1/x = conj(x)/N = (i/N).y + u, and i/N = (u + (u + v)/c)/c
+    */
+    uint8_t c_inverse = gf_inverse(c);
+    uint8_t c_inverse_2 = gf_multiply(c_inverse, c_inverse);
+
+    for(int n = 0; n < 16; n++){
+        t->ipt_lo[n] = to_tower[n];
+        t->ipt_hi[n] = to_tower[n << 4];
+        t->dipt_lo[n] = to_tower[inv_affine((uint8_t)n) ^ inv_affine(0x63)];
+        t->dipt_hi[n] = to_tower[inv_affine((uint8_t)(n << 4))];
+
+        if(n == 0){
+            t->inv[n] = t->inv_c[n] = 0x80;
+            t->sbu[n] = t->sbt[n] = t->sb2u[n] = t->sb2t[n] = t->dsbu[n] = t->dsbt[n] = 0;
+            continue;
+        }
+
+        uint8_t inverse = gf_inverse(nibble_to_field[n]);
+        t->inv[n] = field_to_nibble[inverse];
+        t->inv_c[n] = field_to_nibble[gf_multiply(c, inverse)];
+
+        /* inverse = 1/io (resp. 1/jo) */
+        uint8_t from_io = gf_multiply(gf_multiply(inverse, c_inverse) ^ gf_multiply(inverse, c_inverse_2), y) ^ inverse;
+        uint8_t from_jo = gf_multiply(gf_multiply(inverse, c_inverse_2), y);
+
+        t->dsbu[n] = from_io;
+        t->dsbt[n] = from_jo;
+        t->sbu[n] = affine(from_io);
+        t->sbt[n] = affine(from_jo);
+        t->sb2u[n] = gf_multiply(2, t->sbu[n]);
+        t->sb2t[n] = gf_multiply(2, t->sbt[n]);
+    }
+}
+
+
+static int VPAES_Is_Supported(void)
+{
+    return cpu_has_feature(CPU_FEATURE_SSE2) && cpu_has_feature(CPU_FEATURE_SSSE3);
+}
+
+
+
+typedef struct {
+    __m128i mask_0f;
+    __m128i ipt_lo, ipt_hi;
+    __m128i inv, inv_c;
+    __m128i out_u, out_t;           // sbu/sbt (encryption) or dsbu/dsbt (decryption)
+    __m128i out2_u, out2_t;         // sb2u/sb2t (encryption only)
+} VPAES_REGISTERS_T;
+
+
+VPAES_TARGET static inline __m128i load_table(const uint8_t *table)
+{
+    return _mm_loadu_si128((const __m128i*)table);
+}
+
+VPAES_TARGET static inline __m128i word_swap_mask(void)
+{
+    return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+}
+
+VPAES_TARGET static inline __m128i shift_rows_mask(void)
+{
+    return _mm_setr_epi8(0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11);
+}
+
+VPAES_TARGET static inline __m128i inv_shift_rows_mask(void)
+{
+    return _mm_setr_epi8(0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3);
+}
+
+/* rotation of each column by 1 and 2 rows: byte (column, row) <- byte (column, row+1 or row+2) */
+VPAES_TARGET static inline __m128i rotate_1_mask(void)
+{
+    return _mm_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12);
+}
+
+VPAES_TARGET static inline __m128i rotate_2_mask(void)
+{
+    return _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+}
+
+
+/*
+    Basis change and tower field inversion: x -> (io, jo), 6 lookups.
+*/
+VPAES_TARGET static inline void invert_nibbles(const VPAES_REGISTERS_T *r, __m128i x, __m128i *io, __m128i *jo)
+{
+    __m128i t = _mm_shuffle_epi8(r->ipt_lo, x & r->mask_0f) ^ _mm_shuffle_epi8(r->ipt_hi, _mm_srli_epi32(x, 4) & r->mask_0f);
+    __m128i k = t & r->mask_0f;
+    __m128i i = _mm_srli_epi32(t, 4) & r->mask_0f;
+    __m128i j = i ^ k;
+    __m128i ak = _mm_shuffle_epi8(r->inv_c, k);
+    __m128i iak = _mm_shuffle_epi8(r->inv, i) ^ ak;
+    __m128i jak = _mm_shuffle_epi8(r->inv, j) ^ ak;
+
+    *io = _mm_shuffle_epi8(r->inv, iak) ^ j;
+    *jo = _mm_shuffle_epi8(r->inv, jak) ^ i;
+}
+
+
+VPAES_TARGET static inline __m128i xtime(__m128i x)
+{
+    __m128i carry = _mm_cmpgt_epi8(_mm_setzero_si128(), x);
+    return _mm_add_epi8(x, x) ^ (carry & _mm_set1_epi8(0x1b));
+}
+
+
+/*
+    Middle round: ShiftRows (before SubBytes, they commute), SubBytes with s and 2.s from the tables,
+    MixColumns: out_i = 2.s_i ^ 3.s_i+1 ^ s_i+2 ^ s_i+3, then AddRoundKey.
+*/
+VPAES_TARGET static inline __m128i encrypt_round(const VPAES_REGISTERS_T *r, __m128i x, __m128i round_key)
+{
+    __m128i io, jo;
+
+    invert_nibbles(r, _mm_shuffle_epi8(x, shift_rows_mask()), &io, &jo);
+
+    __m128i s = _mm_shuffle_epi8(r->out_u, io) ^ _mm_shuffle_epi8(r->out_t, jo);
+    __m128i s2 = _mm_shuffle_epi8(r->out2_u, io) ^ _mm_shuffle_epi8(r->out2_t, jo);
+    __m128i s_1 = _mm_shuffle_epi8(s, rotate_1_mask());
+
+    return s2 ^ _mm_shuffle_epi8(s2, rotate_1_mask()) ^ s_1 ^ _mm_shuffle_epi8(s ^ s_1, rotate_2_mask()) ^ round_key;
+}
+
+VPAES_TARGET static inline __m128i encrypt_last_round(const VPAES_REGISTERS_T *r, __m128i x, __m128i round_key)
+{
+    __m128i io, jo;
+
+    invert_nibbles(r, _mm_shuffle_epi8(x, shift_rows_mask()), &io, &jo);
+
+    return _mm_shuffle_epi8(r->out_u, io) ^ _mm_shuffle_epi8(r->out_t, jo) ^ round_key;
+}
+
+
+/*
+    InvMixColumns = MixColumns o (a_i ^= 4.(a_i ^ a_i+2)), MixColumns: out_i = 2.(a_i ^ a_i+1) ^ a_i+1 ^ (a_i+2 ^ a_i+3)
+*/
+VPAES_TARGET static inline __m128i inv_mix_columns(__m128i a)
+{
+    a ^= xtime(xtime(a ^ _mm_shuffle_epi8(a, rotate_2_mask())));
+
+    __m128i a_1 = _mm_shuffle_epi8(a, rotate_1_mask());
+    __m128i t = a ^ a_1;
+
+    return xtime(t) ^ a_1 ^ _mm_shuffle_epi8(t, rotate_2_mask());
+}
+
+/* InvShiftRows, InvSubBytes, AddRoundKey */
+VPAES_TARGET static inline __m128i decrypt_last_round(const VPAES_REGISTERS_T *r, __m128i x, __m128i round_key)
+{
+    __m128i io, jo;
+
+    invert_nibbles(r, _mm_shuffle_epi8(x, inv_shift_rows_mask()), &io, &jo);
+
+    return _mm_shuffle_epi8(r->out_u, io) ^ _mm_shuffle_epi8(r->out_t, jo) ^ round_key;
+}
+
+
+
+/*
+    round_keys[0] = private key, round_keys[1..rounds] = sub-keys (standard byte order);
+    fold_sbox_constant: 0x63 added to the keys of the rounds following a SubBytes (encryption).
+*/
+VPAES_TARGET static void load_round_keys(const AES_Block_Struct *private_key, const AES_Block_Struct *sub_keys, int rounds, int fold_sbox_constant, __m128i *round_keys)
+{
+    __m128i constant = fold_sbox_constant ? _mm_set1_epi8(0x63) : _mm_setzero_si128();
+
+    round_keys[0] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)private_key), word_swap_mask());
+    for(int i = 0; i < rounds; i++){
+        round_keys[i+1] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&sub_keys[i]), word_swap_mask()) ^ constant;
+    }
+}
+
+
+VPAES_TARGET static void VPAES_Encrypt_Blocks(AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context)
+{
+    const VPAES_TABLES_T *t = &vpaes_tables;
+    VPAES_REGISTERS_T r = {
+        _mm_set1_epi8(0x0f),
+        load_table(t->ipt_lo), load_table(t->ipt_hi),
+        load_table(t->inv), load_table(t->inv_c),
+        load_table(t->sbu), load_table(t->sbt),
+        load_table(t->sb2u), load_table(t->sb2t)
+    };
+    __m128i round_keys[AES_MAX_ROUNDS+1];
+    int rounds = context->rounds;
+
+    load_round_keys(&context->private_key, context->sub_keys, rounds, 1, round_keys);
+
+    size_t b = 0;
+
+    /* 2 independent blocks interleaved to hide the PSHUFB latency */
+    for(; b + 2 <= count; b += 2){
+        __m128i x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[b]), word_swap_mask()) ^ round_keys[0];
+        __m128i x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[b+1]), word_swap_mask()) ^ round_keys[0];
+
+        for(int i = 1; i < rounds; i++){
+            x0 = encrypt_round(&r, x0, round_keys[i]);
+            x1 = encrypt_round(&r, x1, round_keys[i]);
+        }
+        x0 = encrypt_last_round(&r, x0, round_keys[rounds]);
+        x1 = encrypt_last_round(&r, x1, round_keys[rounds]);
+
+        _mm_storeu_si128((__m128i*)&blocks[b], _mm_shuffle_epi8(x0, word_swap_mask()));
+        _mm_storeu_si128((__m128i*)&blocks[b+1], _mm_shuffle_epi8(x1, word_swap_mask()));
+    }
+
+    if(b < count){
+        __m128i x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[b]), word_swap_mask()) ^ round_keys[0];
+
+        for(int i = 1; i < rounds; i++){
+            x = encrypt_round(&r, x, round_keys[i]);
+        }
+        x = encrypt_last_round(&r, x, round_keys[rounds]);
+
+        _mm_storeu_si128((__m128i*)&blocks[b], _mm_shuffle_epi8(x, word_swap_mask()));
+    }
+}
+
+
+VPAES_TARGET static void VPAES_Decrypt_Blocks(AES_Block_Struct *blocks, size_t count, const AES_KEY_CONTEXT_T *context)
+{
+    const VPAES_TABLES_T *t = &vpaes_tables;
+    VPAES_REGISTERS_T r = {
+        _mm_set1_epi8(0x0f),
+        load_table(t->dipt_lo), load_table(t->dipt_hi),
+        load_table(t->inv), load_table(t->inv_c),
+        load_table(t->dsbu), load_table(t->dsbt),
+        _mm_setzero_si128(), _mm_setzero_si128()
+    };
+    __m128i round_keys[AES_MAX_ROUNDS+1];
+    int rounds = context->rounds;
+
+    load_round_keys(&context->private_key, context->decryption_sub_keys, rounds, 0, round_keys);
+
+    size_t b = 0;
+
+    for(; b + 2 <= count; b += 2){
+        __m128i x0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[b]), word_swap_mask()) ^ round_keys[rounds];
+        __m128i x1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[b+1]), word_swap_mask()) ^ round_keys[rounds];
+
+        for(int i = rounds-1; i >= 1; i--){
+            x0 = inv_mix_columns(decrypt_last_round(&r, x0, round_keys[i]));
+            x1 = inv_mix_columns(decrypt_last_round(&r, x1, round_keys[i]));
+        }
+        x0 = decrypt_last_round(&r, x0, round_keys[0]);
+        x1 = decrypt_last_round(&r, x1, round_keys[0]);
+
+        _mm_storeu_si128((__m128i*)&blocks[b], _mm_shuffle_epi8(x0, word_swap_mask()));
+        _mm_storeu_si128((__m128i*)&blocks[b+1], _mm_shuffle_epi8(x1, word_swap_mask()));
+    }
+
+    if(b < count){
+        __m128i x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[b]), word_swap_mask()) ^ round_keys[rounds];
+
+        for(int i = rounds-1; i >= 1; i--){
+            x = inv_mix_columns(decrypt_last_round(&r, x, round_keys[i]));
+        }
+        x = decrypt_last_round(&r, x, round_keys[0]);
+
+        _mm_storeu_si128((__m128i*)&blocks[b], _mm_shuffle_epi8(x, word_swap_mask()));
+    }
+}
+
+
+
+/*
+    Apply the S-box to the 4 bytes of a word (key expansion).
+*/
+VPAES_TARGET static uint32_t VPAES_Sub_Word(uint32_t word)
+{
+    const VPAES_TABLES_T *t = &vpaes_tables;
+    VPAES_REGISTERS_T r = {
+        _mm_set1_epi8(0x0f),
+        load_table(t->ipt_lo), load_table(t->ipt_hi),
+        load_table(t->inv), load_table(t->inv_c),
+        load_table(t->sbu), load_table(t->sbt),
+        _mm_setzero_si128(), _mm_setzero_si128()
+    };
+    __m128i io, jo;
+
+    invert_nibbles(&r, _mm_cvtsi32_si128((int)word), &io, &jo);
+
+    return (uint32_t)_mm_cvtsi128_si32(_mm_shuffle_epi8(r.out_u, io) ^ _mm_shuffle_epi8(r.out_t, jo) ^ _mm_set1_epi8(0x63));
+}
+
+
+static void VPAES_Expand_Key(const uint32_t *key, int key_words, AES_Block_Struct *sub_keys)
+{
+    pthread_once(&vpaes_tables_once, VPAES_Init_Tables);
+    AES_Expand_Key(key, key_words, VPAES_Sub_Word, sub_keys);
+}
+
+
+/*
+    Straightforward inverse cipher: the decryption sub-keys are the encryption ones.
+*/
+static void VPAES_Decryption_Subkeys(const AES_Block_Struct *sub_keys, int rounds, AES_Block_Struct *decryption_sub_keys)
+{
+    for(int i = 0; i < rounds; i++){
+        decryption_sub_keys[i] = sub_keys[i];
+    }
+}
+
+
+const AES_BACKEND_T AES_Backend_VPAES = {
+    .name = "vector permute (SSSE3)",
+    .is_supported = VPAES_Is_Supported,
+    .expand_key = VPAES_Expand_Key,
+    .decryption_subkeys = VPAES_Decryption_Subkeys,
+    .encrypt_blocks = VPAES_Encrypt_Blocks,
+    .decrypt_blocks = VPAES_Decrypt_Blocks
+};
+
+#endif      // AES_X86_BACKENDS
@@ -1,11 +1,12 @@
 /* 
-    DES in ECB mode with ANSI X9.23 Padding.
+    DES and Triple-DES (EDE) in ECB mode with ANSI X9.23 Padding (CTR mode for streams).
     All values are in little-endian format.
 */
-#include "DES.h"
+#include "DES_backends.h"
+#include <pthread.h>
 
 
-static int IP_table[64] = {
+const int DES_IP_table[64] = {
     58, 50, 42, 34, 26, 18, 10, 2,
     60, 52, 44, 36, 28, 20, 12, 4,
     62, 54, 46, 38, 30, 22, 14, 6,
@@ -16,7 +17,7 @@ static int IP_table[64] = {
     63, 55, 47, 39, 31, 23, 15, 7
 };
 
-static int IP_INV_table[64] = {
+const int DES_IP_INV_table[64] = {
     40, 8, 48, 16, 56, 24, 64, 32,
     39, 7, 47, 15, 55, 23, 63, 31,
     38, 6, 46, 14, 54, 22, 62, 30,
@@ -201,7 +202,7 @@ static int S8[64] = {
     7, 2, 8, 11
 };
 
-static int E_table[48] = {
+const int DES_E_table[48] = {
     32, 1, 2, 3, 4, 5,
     4, 5, 6, 7, 8, 9,
     8, 9, 10, 11, 12, 13,
@@ -212,7 +213,7 @@ static int E_table[48] = {
     28, 29, 30, 31, 32, 1
 };
 
-static int P_table[32] = {
+const int DES_P_table[32] = {
     16, 7, 20, 21, 29, 12, 28, 17,
     1, 15, 23, 26, 5, 18, 31, 10,
     2, 8, 24, 14, 32, 27, 3, 9,
@@ -225,9 +226,9 @@ static uint64_t IP(uint64_t data)
     uint64_t result = 0;
 
     for(int i = 0; i < 64; i++){
-        // bit at pos (64-1-i) in the output is taken from the bit at pos (64 - IP_table[i]) in the input
+        // bit at pos (64-1-i) in the output is taken from the bit at pos (64 - DES_IP_table[i]) in the input
         result <<= 1;
-        result |= (data >> (    64 - IP_table[i]    )   ) & 1;
+        result |= (data >> (    64 - DES_IP_table[i]    )   ) & 1;
     }
 
     return result;
@@ -240,9 +241,9 @@ static uint64_t IP_INV(uint64_t data)
     uint64_t result = 0;
 
     for(int i = 0; i < 64; i++){
-        // bit at pos (64-1-i) in the output is taken from the bit at pos (64 - IP_INV_table[i]) in the input
+        // bit at pos (64-1-i) in the output is taken from the bit at pos (64 - DES_IP_INV_table[i]) in the input
         result <<= 1;
-        result |= (data >> (    64 - IP_INV_table[i]    )   ) & 1;
+        result |= (data >> (    64 - DES_IP_INV_table[i]    )   ) & 1;
     }
 
     return result;
@@ -281,9 +282,9 @@ static uint64_t E(uint64_t input_block)
     uint64_t output_block = 0;
 
     for(int i = 0; i < 48; i++){
-        // bit at pos (48-1-i) in the output block is taken from the bit at pos (32 - E_table[i]) in the input block
+        // bit at pos (48-1-i) in the output block is taken from the bit at pos (32 - DES_E_table[i]) in the input block
         output_block <<= 1;
-        output_block |= (input_block >> (    32 - E_table[i]    )   ) & 1;
+        output_block |= (input_block >> (    32 - DES_E_table[i]    )   ) & 1;
     }
 
     return output_block;
@@ -296,9 +297,9 @@ static uint64_t P(uint64_t input_block)
     uint64_t output_block = 0;
 
     for(int i = 0; i < 32; i++){
-        // bit at pos (32-1-i) in the output block is taken from the bit at pos (32 - P_table[i]) in the input block
+        // bit at pos (32-1-i) in the output block is taken from the bit at pos (32 - DES_P_table[i]) in the input block
         output_block <<= 1;
-        output_block |= (input_block >> (    32 - P_table[i]    )   ) & 1;
+        output_block |= (input_block >> (    32 - DES_P_table[i]    )   ) & 1;
     }
 
     return output_block;
@@ -345,19 +346,107 @@ static uint64_t Round(uint64_t data, uint64_t sub_key)
 }
 
 
-static uint64_t DES_block(uint64_t data, uint64_t key, int mode)
+/*
+    Table-driven engine (DES_ENGINE_TABLES), the tables being computed at initialization from the
+    reference functions above (so that both engines use the same definitions):
+        - SP[j][x] = P(S_j+1(x)) at the output position of S-box j+1: a round function is 8 lookups
+        - IP_bytes[i][b] (resp. FP_bytes) = IP (resp. IP_INV) of the byte b at position i (0: most significant
+          byte): both permutations being linear, IP(x) is the XOR of the 8 entries of the bytes of x
+    E is computed with rotations: the 6-bits input of S-box j (1 to 8) is made of the bits 4j-4 to 4j+1
+    of the right half (bit 0 being bit 32).
+*/
+static uint32_t SP[8][64];
+static uint64_t IP_bytes[8][256];
+static uint64_t FP_bytes[8][256];
+static pthread_once_t DES_tables_once = PTHREAD_ONCE_INIT;
+
+
+static void DES_Init_Tables(void)
 {
-    uint64_t result;
-    uint64_t initial_sub_key;
+    for(int j = 0; j < 8; j++){
+        for(int x = 0; x < 64; x++){
+            SP[j][x] = (uint32_t)P(  (uint64_t)S_box((uint8_t)x, (uint8_t)(j+1)) << (4*(7-j))  );
+        }
+    }
+
+    for(int i = 0; i < 8; i++){
+        for(int b = 0; b < 256; b++){
+            IP_bytes[i][b] = IP((uint64_t)b << (8*(7-i)));
+            FP_bytes[i][b] = IP_INV((uint64_t)b << (8*(7-i)));
+        }
+    }
+}
+
+
+static inline uint64_t permute_bytes(const uint64_t table[8][256], uint64_t data)
+{
+    return table[0][data >> 56] ^ table[1][(data >> 48) & 0xFF] ^ table[2][(data >> 40) & 0xFF] ^ table[3][(data >> 32) & 0xFF] ^
+           table[4][(data >> 24) & 0xFF] ^ table[5][(data >> 16) & 0xFF] ^ table[6][(data >> 8) & 0xFF] ^ table[7][data & 0xFF];
+}
 
-    result = IP(data);
 
-    initial_sub_key = PC1(key);
+static inline uint32_t rotate_right_32(uint32_t x, int shift)
+{
+    return (x >> shift) | (x << ((32 - shift) & 31));
+}
+
+
+/* f(R, K): expansion, key mixing and S+P lookups */
+static inline uint32_t F_tables(uint32_t right, uint64_t sub_key)
+{
+    return SP[0][(rotate_right_32(right, 27) ^ (uint32_t)(sub_key >> 42)) & 0x3F] ^
+           SP[1][(rotate_right_32(right, 23) ^ (uint32_t)(sub_key >> 36)) & 0x3F] ^
+           SP[2][(rotate_right_32(right, 19) ^ (uint32_t)(sub_key >> 30)) & 0x3F] ^
+           SP[3][(rotate_right_32(right, 15) ^ (uint32_t)(sub_key >> 24)) & 0x3F] ^
+           SP[4][(rotate_right_32(right, 11) ^ (uint32_t)(sub_key >> 18)) & 0x3F] ^
+           SP[5][(rotate_right_32(right, 7) ^ (uint32_t)(sub_key >> 12)) & 0x3F] ^
+           SP[6][(rotate_right_32(right, 3) ^ (uint32_t)(sub_key >> 6)) & 0x3F] ^
+           SP[7][(rotate_right_32(right, 31) ^ (uint32_t)sub_key) & 0x3F];
+}
+
+
+static uint64_t DES_block_tables(uint64_t data, const uint64_t *sub_keys)
+{
+    uint64_t x = permute_bytes(IP_bytes, data);
+    uint32_t left = (uint32_t)(x >> 32);
+    uint32_t right = (uint32_t)x;
+
+    for(int i = 0; i < 16; i += 2){
+        left ^= F_tables(right, sub_keys[i]);
+        right ^= F_tables(left, sub_keys[i+1]);
+    }
+
+    /* the last swap is cancelled */
+    return permute_bytes(FP_bytes, ((uint64_t)right << 32) | left);
+}
+
+
+static uint64_t DES_block_reference(uint64_t data, const uint64_t *sub_keys)
+{
+    uint64_t result = IP(data);
+
+    for(int i = 0; i < 16; i++){
+        result = Round(result, sub_keys[i]);
+    }
+
+    result = (  ((result & 0xFFFFFFFF) << 32) | (result >> 32) );
+
+    return IP_INV(result);
+}
+
+
+
+/*
+    Key schedule: PC1, then 16 rotations of the two 28-bits halves, each followed by PC2.
+*/
+void DES_Init_Key_Context(DES_KEY_CONTEXT_T *context, uint64_t key)
+{
+    pthread_once(&DES_tables_once, DES_Init_Tables);
+
+    uint64_t initial_sub_key = PC1(key);
     uint64_t left_sub_key = (initial_sub_key & 0xFFFFFFF0000000) >> 28;
     uint64_t right_sub_key = initial_sub_key & 0xFFFFFFF;
 
-    /* generate all sub-keys */
-    uint64_t sub_keys[16];
     for(int i = 1; i <= 16; i++){
         int shift;
 
@@ -383,32 +472,309 @@ static uint64_t DES_block(uint64_t data, uint64_t key, int mode)
         right_sub_key = (    (right_sub_key << shift) | (  right_sub_key >> (28-shift)  )   ) & 0xFFFFFFF;
 
         uint64_t temp = ((left_sub_key << 28) | right_sub_key);
-        sub_keys[i-1] = PC2(temp);
+        context->sub_keys[i-1] = PC2(temp);
+    }
+
+    /* use sub-keys in reverse-order for decryption */
+    for(int i = 0; i < 16; i++){
+        context->decryption_sub_keys[i] = context->sub_keys[15-i];
     }
+}
+
+
+static uint64_t DES_block(uint64_t data, const DES_KEY_CONTEXT_T *context, int mode)
+{
+    const uint64_t *sub_keys = (mode == DES_ENCRYPTION_MODE) ? context->sub_keys : context->decryption_sub_keys;
+
+    if(DES_ENGINE == DES_ENGINE_TABLES)
+        return DES_block_tables(data, sub_keys);
+    else
+        return DES_block_reference(data, sub_keys);
+}
+
 
-    if(mode == DES_ENCRYPTION_MODE){
-        for(int i = 1; i <= 16; i++){
-            result = Round(result, sub_keys[i-1]);
+
+/*
+    Triple-DES: FP at the end of a stage followed by IP at the start of the next one is the identity, so
+    the halves go from one stage to the next with only the swap of the last round (IP and FP are done once).
+    Three independent blocks are processed together, their rounds interleaved.
+*/
+static void DES3_blocks_tables_3(uint64_t *data, const uint64_t *sub_keys)
+{
+    uint32_t left[3], right[3];
+
+    for(int b = 0; b < 3; b++){
+        uint64_t x = permute_bytes(IP_bytes, data[b]);
+        left[b] = (uint32_t)(x >> 32);
+        right[b] = (uint32_t)x;
+    }
+
+    for(int stage = 0; stage < 3; stage++){
+        const uint64_t *stage_keys = &sub_keys[16*stage];
+
+        for(int i = 0; i < 16; i += 2){
+            left[0] ^= F_tables(right[0], stage_keys[i]);
+            left[1] ^= F_tables(right[1], stage_keys[i]);
+            left[2] ^= F_tables(right[2], stage_keys[i]);
+            right[0] ^= F_tables(left[0], stage_keys[i+1]);
+            right[1] ^= F_tables(left[1], stage_keys[i+1]);
+            right[2] ^= F_tables(left[2], stage_keys[i+1]);
+        }
+
+        for(int b = 0; b < 3; b++){
+            uint32_t temp = left[b];
+            left[b] = right[b];
+            right[b] = temp;
         }
     }
-    else{
-        for(int i = 1; i <= 16; i++){
-            /* use sub-keys in reverse-order for decryption */
-            result = Round(result, sub_keys[16-i]);
+
+    for(int b = 0; b < 3; b++){
+        data[b] = permute_bytes(FP_bytes, ((uint64_t)left[b] << 32) | right[b]);
+    }
+}
+
+
+static uint64_t DES3_block_tables(uint64_t data, const uint64_t *sub_keys)
+{
+    uint64_t x = permute_bytes(IP_bytes, data);
+    uint32_t left = (uint32_t)(x >> 32);
+    uint32_t right = (uint32_t)x;
+
+    for(int stage = 0; stage < 3; stage++){
+        const uint64_t *stage_keys = &sub_keys[16*stage];
+
+        for(int i = 0; i < 16; i += 2){
+            left ^= F_tables(right, stage_keys[i]);
+            right ^= F_tables(left, stage_keys[i+1]);
         }
+
+        uint32_t temp = left;
+        left = right;
+        right = temp;
     }
 
-    result = (  ((result & 0xFFFFFFFF) << 32) | (result >> 32) );
+    return permute_bytes(FP_bytes, ((uint64_t)left << 32) | right);
+}
 
-    return IP_INV(result);
+
+/* "count" blocks (1 to 3) */
+static void DES3_blocks(uint64_t *data, size_t count, const DES3_KEY_CONTEXT_T *context, int mode)
+{
+    const uint64_t *sub_keys = (mode == DES_ENCRYPTION_MODE) ? context->sub_keys : context->decryption_sub_keys;
+
+    if(  (DES_ENGINE == DES_ENGINE_TABLES) && (count == 3)  ){
+        DES3_blocks_tables_3(data, sub_keys);
+        return;
+    }
+
+    for(size_t b = 0; b < count; b++){
+        if(DES_ENGINE == DES_ENGINE_TABLES){
+            data[b] = DES3_block_tables(data[b], sub_keys);
+        }
+        else{
+            for(int stage = 0; stage < 3; stage++){
+                data[b] = DES_block_reference(data[b], &sub_keys[16*stage]);
+            }
+        }
+    }
 }
 
 
 
+static uint64_t load_block(const uint8_t *data)
+{
+    uint64_t block;
+    memcpy(&block, data, sizeof(uint64_t));
+    return switch_endianness_64(block);
+}
+
+static void store_block(uint8_t *data, uint64_t block)
+{
+    block = switch_endianness_64(block);
+    memcpy(data, &block, sizeof(uint64_t));
+}
+
+
 /*
-    Encryption of a file using the DES algorithm.
+    ECB processing of "block_count" 8-bytes blocks (input and output may be the same buffer).
+    Full batches of DES_BITSLICE_BLOCKS blocks go through the bitsliced engine, the remaining blocks
+    through the single-block engine.
 */
-int DES_encryption(const char* const plain_file_name, uint64_t key, const char* const encrypted_file_name)
+void DES_ECB_Process_Blocks(const DES_KEY_CONTEXT_T *context, const uint8_t *input, uint8_t *output, size_t block_count, int mode)
+{
+    size_t i = 0;
+
+    if(block_count >= DES_BITSLICE_BLOCKS){
+        DES_BITSLICE_KEY_T key;
+        uint64_t blocks[DES_BITSLICE_BLOCKS];
+
+        DES_Bitslice_Init_Key(&key, (mode == DES_ENCRYPTION_MODE) ? context->sub_keys : context->decryption_sub_keys);
+
+        for(; i + DES_BITSLICE_BLOCKS <= block_count; i += DES_BITSLICE_BLOCKS){
+            for(int b = 0; b < DES_BITSLICE_BLOCKS; b++){
+                blocks[b] = load_block(&input[8*(i+b)]);
+            }
+
+            DES_Bitslice_Blocks(&key, blocks);
+
+            for(int b = 0; b < DES_BITSLICE_BLOCKS; b++){
+                store_block(&output[8*(i+b)], blocks[b]);
+            }
+        }
+    }
+
+    for(; i < block_count; i++){
+        store_block(&output[8*i], DES_block(load_block(&input[8*i]), context, mode));
+    }
+}
+
+
+/*
+    CTR mode: output = input ^ keystream, the keystream being the encryption of the counter blocks
+    counter, counter+1, ... (64-bits big-endian increment). Encryption and decryption are the same operation.
+*/
+void DES_CTR_Process(const DES_KEY_CONTEXT_T *context, uint64_t counter, const uint8_t *input, uint8_t *output, size_t size)
+{
+    DES_BITSLICE_KEY_T key;
+    uint64_t blocks[DES_BITSLICE_BLOCKS];
+    uint8_t keystream[8];
+    size_t done = 0;
+
+    if(size >= 8 * DES_BITSLICE_BLOCKS){
+        DES_Bitslice_Init_Key(&key, context->sub_keys);
+    }
+
+    for(; done + 8 * DES_BITSLICE_BLOCKS <= size; done += 8 * DES_BITSLICE_BLOCKS){
+        for(int b = 0; b < DES_BITSLICE_BLOCKS; b++){
+            blocks[b] = counter++;
+        }
+
+        DES_Bitslice_Blocks(&key, blocks);
+
+        for(int b = 0; b < DES_BITSLICE_BLOCKS; b++){
+            store_block(keystream, blocks[b]);
+            for(int j = 0; j < 8; j++){
+                output[done + 8*b + j] = input[done + 8*b + j] ^ keystream[j];
+            }
+        }
+    }
+
+    for(; done < size; done += 8){
+        store_block(keystream, DES_block(counter++, context, DES_ENCRYPTION_MODE));
+
+        for(size_t j = 0; (j < 8) && (done + j < size); j++){
+            output[done + j] = input[done + j] ^ keystream[j];
+        }
+    }
+}
+
+
+
+/*
+    Triple-DES key schedule: the three DES key schedules are computed once, the second one being used in
+    decryption order. Two keys (EDE2): key3 = key1.
+*/
+void DES3_Init_Key_Context(DES3_KEY_CONTEXT_T *context, uint64_t key1, uint64_t key2, uint64_t key3)
+{
+    DES_KEY_CONTEXT_T keys[3];
+
+    DES_Init_Key_Context(&keys[0], key1);
+    DES_Init_Key_Context(&keys[1], key2);
+    DES_Init_Key_Context(&keys[2], key3);
+
+    memcpy(&context->sub_keys[0], keys[0].sub_keys, sizeof(keys[0].sub_keys));
+    memcpy(&context->sub_keys[16], keys[1].decryption_sub_keys, sizeof(keys[1].decryption_sub_keys));
+    memcpy(&context->sub_keys[32], keys[2].sub_keys, sizeof(keys[2].sub_keys));
+
+    /* decryption: D(key3), E(key2), D(key1) = encryption sub-keys in reverse order */
+    for(int i = 0; i < 48; i++){
+        context->decryption_sub_keys[i] = context->sub_keys[47-i];
+    }
+
+    memset(keys, 0, sizeof(keys));
+}
+
+
+/*
+    Triple-DES ECB processing of "block_count" 8-bytes blocks, 3 blocks at a time (input and output may be
+    the same buffer).
+*/
+void DES3_ECB_Process_Blocks(const DES3_KEY_CONTEXT_T *context, const uint8_t *input, uint8_t *output, size_t block_count, int mode)
+{
+    const uint64_t *sub_keys = (mode == DES_ENCRYPTION_MODE) ? context->sub_keys : context->decryption_sub_keys;
+    uint64_t blocks[3];
+    size_t i = 0;
+
+    if(DES_ENGINE == DES_ENGINE_TABLES){
+        for(; i + 3 <= block_count; i += 3){
+            blocks[0] = load_block(&input[8*i]);
+            blocks[1] = load_block(&input[8*i + 8]);
+            blocks[2] = load_block(&input[8*i + 16]);
+
+            DES3_blocks_tables_3(blocks, sub_keys);
+
+            store_block(&output[8*i], blocks[0]);
+            store_block(&output[8*i + 8], blocks[1]);
+            store_block(&output[8*i + 16], blocks[2]);
+        }
+    }
+
+    for(; i < block_count; i++){
+        blocks[0] = load_block(&input[8*i]);
+        DES3_blocks(blocks, 1, context, mode);
+        store_block(&output[8*i], blocks[0]);
+    }
+}
+
+
+/*
+    Triple-DES CTR mode (same counter blocks as DES_CTR_Process()).
+*/
+void DES3_CTR_Process(const DES3_KEY_CONTEXT_T *context, uint64_t counter, const uint8_t *input, uint8_t *output, size_t size)
+{
+    uint64_t blocks[3];
+    uint8_t keystream[8];
+
+    for(size_t done = 0; done < size; done += 8*3){
+        size_t count = __min_(3, (size - done + 7) / 8);
+
+        for(size_t b = 0; b < count; b++){
+            blocks[b] = counter++;
+        }
+
+        DES3_blocks(blocks, count, context, DES_ENCRYPTION_MODE);
+
+        for(size_t b = 0; b < count; b++){
+            store_block(keystream, blocks[b]);
+
+            for(size_t j = 0; (j < 8) && (done + 8*b + j < size); j++){
+                output[done + 8*b + j] = input[done + 8*b + j] ^ keystream[j];
+            }
+        }
+    }
+}
+
+
+
+/*
+    File format shared by DES and Triple-DES: ECB with ANSI X9.23 padding, processed DES_FILE_CHUNK_BLOCKS
+    blocks at a time by the ECB function of the algorithm.
+*/
+typedef void (*DES_PROCESS_BLOCKS_T)(const void *context, const uint8_t *input, uint8_t *output, size_t block_count, int mode);
+
+
+static void DES_process_blocks(const void *context, const uint8_t *input, uint8_t *output, size_t block_count, int mode)
+{
+    DES_ECB_Process_Blocks((const DES_KEY_CONTEXT_T*)context, input, output, block_count, mode);
+}
+
+static void DES3_process_blocks(const void *context, const uint8_t *input, uint8_t *output, size_t block_count, int mode)
+{
+    DES3_ECB_Process_Blocks((const DES3_KEY_CONTEXT_T*)context, input, output, block_count, mode);
+}
+
+
+static int file_encryption(const char* const plain_file_name, const char* const encrypted_file_name, DES_PROCESS_BLOCKS_T process_blocks, const void *context)
 {
     FILE *plain_file = fopen(plain_file_name, "rb");
     FILE *encrypted_file = fopen(encrypted_file_name, "wb");
@@ -419,31 +785,28 @@ int DES_encryption(const char* const plain_file_name, uint64_t key, const char*
         return EXIT_FAILURE;
     }
 
-
     /* DES operates on 64-bits (8-bytes) wide blocks */
     int remainder = filesize % 8;      // number of bytes to pad (if necessary)
     int q = filesize / 8;           // number of 64-bits blocks
 
-    uint64_t data;
+    uint8_t data_buffer[8 * DES_FILE_CHUNK_BLOCKS];
 
     /* Process all blocks except the last one (special case) */
-    for(int i = 0; i < q; i++){
-        fread(&data, sizeof(uint64_t), 1, plain_file);
-        data = switch_endianness_64(data);
-        data = DES_block(data, key, DES_ENCRYPTION_MODE);
-        data = switch_endianness_64(data);
-        fwrite(&data, sizeof(uint64_t), 1, encrypted_file);
+    for(int i = 0; i < q; i += DES_FILE_CHUNK_BLOCKS){
+        int count = __min_(DES_FILE_CHUNK_BLOCKS, q - i);
+
+        fread(data_buffer, 8, count, plain_file);
+        process_blocks(context, data_buffer, data_buffer, count, DES_ENCRYPTION_MODE);
+        fwrite(data_buffer, 8, count, encrypted_file);
     }
 
     /* Last block: Padding */
-    data = 0;
-    fread(&data, sizeof(uint8_t), remainder, plain_file);
-    data = switch_endianness_64(data);
-    data |= (8-remainder  );                  // padded last block with (8 - remainder - 1) null bytes + 1 byte for the length
+    memset(data_buffer, 0, 8);
+    fread(data_buffer, sizeof(uint8_t), remainder, plain_file);
+    data_buffer[7] = 8-remainder;             // padded last block with (8 - remainder - 1) null bytes + 1 byte for the length
 
-    data = DES_block(data, key, DES_ENCRYPTION_MODE);
-    data = switch_endianness_64(data);
-    fwrite(&data, sizeof(uint64_t), 1, encrypted_file);
+    process_blocks(context, data_buffer, data_buffer, 1, DES_ENCRYPTION_MODE);
+    fwrite(data_buffer, 8, 1, encrypted_file);
 
 
     fclose(plain_file);
@@ -453,13 +816,7 @@ int DES_encryption(const char* const plain_file_name, uint64_t key, const char*
 }
 
 
-
-
-
-/*
-    Decryption of a file using the DES algorithm.
-*/
-int DES_decryption(const char* const encrypted_file_name, uint64_t key, const char* const decrypted_file_name)
+static int file_decryption(const char* const encrypted_file_name, const char* const decrypted_file_name, DES_PROCESS_BLOCKS_T process_blocks, const void *context)
 {
     FILE *encrypted_file = fopen(encrypted_file_name, "rb");
     FILE *decrypted_file = fopen(decrypted_file_name, "wb");
@@ -473,25 +830,23 @@ int DES_decryption(const char* const encrypted_file_name, uint64_t key, const ch
     /* DES operates on 64-bits (8-bytes) wide blocks */
     int q = filesize / 8;           // number of 64-bits blocks (no remainder because a DES encrypted file is necessary padded to a multiple of 64-bits)
 
-    uint64_t data;
+    uint8_t data_buffer[8 * DES_FILE_CHUNK_BLOCKS];
 
     /* Process all blocks except the last one (special case) */
-    for(int i = 0; i < q-1; i++){
-        fread(&data, sizeof(uint64_t), 1, encrypted_file);
-        data = switch_endianness_64(data);
-        data = DES_block(data, key, DES_DECRYPTION_MODE);
-        data = switch_endianness_64(data);
-        fwrite(&data, sizeof(uint64_t), 1, decrypted_file);
+    for(int i = 0; i < q-1; i += DES_FILE_CHUNK_BLOCKS){
+        int count = __min_(DES_FILE_CHUNK_BLOCKS, q-1 - i);
+
+        fread(data_buffer, 8, count, encrypted_file);
+        process_blocks(context, data_buffer, data_buffer, count, DES_DECRYPTION_MODE);
+        fwrite(data_buffer, 8, count, decrypted_file);
     }
 
     /* Last block: Padded block */
-    fread(&data, sizeof(uint64_t), 1, encrypted_file);
-    data = switch_endianness_64(data);
-    data = DES_block(data, key, DES_DECRYPTION_MODE);
+    fread(data_buffer, 8, 1, encrypted_file);
+    process_blocks(context, data_buffer, data_buffer, 1, DES_DECRYPTION_MODE);
 
-    int padded_bytes_count = data & 0xFF;
-    data = switch_endianness_64(data);
-    fwrite(&data, sizeof(uint8_t), 8-padded_bytes_count, decrypted_file);
+    int padded_bytes_count = data_buffer[7];
+    fwrite(data_buffer, sizeof(uint8_t), 8-padded_bytes_count, decrypted_file);
 
 
     fclose(encrypted_file);
@@ -502,6 +857,55 @@ int DES_decryption(const char* const encrypted_file_name, uint64_t key, const ch
 
 
 
+/*
+    Encryption of a file using the DES algorithm.
+*/
+int DES_encryption(const char* const plain_file_name, uint64_t key, const char* const encrypted_file_name)
+{
+    DES_KEY_CONTEXT_T context;
+    DES_Init_Key_Context(&context, key);
+
+    return file_encryption(plain_file_name, encrypted_file_name, DES_process_blocks, &context);
+}
+
+
+/*
+    Decryption of a file using the DES algorithm.
+*/
+int DES_decryption(const char* const encrypted_file_name, uint64_t key, const char* const decrypted_file_name)
+{
+    DES_KEY_CONTEXT_T context;
+    DES_Init_Key_Context(&context, key);
+
+    return file_decryption(encrypted_file_name, decrypted_file_name, DES_process_blocks, &context);
+}
+
+
+/*
+    Encryption of a file using Triple-DES (EDE). Two keys (EDE2): key3 = key1.
+*/
+int DES3_encryption(const char* const plain_file_name, uint64_t key1, uint64_t key2, uint64_t key3, const char* const encrypted_file_name)
+{
+    DES3_KEY_CONTEXT_T context;
+    DES3_Init_Key_Context(&context, key1, key2, key3);
+
+    return file_encryption(plain_file_name, encrypted_file_name, DES3_process_blocks, &context);
+}
+
+
+/*
+    Decryption of a file using Triple-DES (EDE).
+*/
+int DES3_decryption(const char* const encrypted_file_name, uint64_t key1, uint64_t key2, uint64_t key3, const char* const decrypted_file_name)
+{
+    DES3_KEY_CONTEXT_T context;
+    DES3_Init_Key_Context(&context, key1, key2, key3);
+
+    return file_decryption(encrypted_file_name, decrypted_file_name, DES3_process_blocks, &context);
+}
+
+
+
 
 
 
@@ -509,4 +913,26 @@ void DES_test(void)
 {
     DES_encryption("plain_data_test.txt", 0x1654987456258526, "DES_encrypted_data_test.txt");
     DES_decryption("DES_encrypted_data_test.txt", 0x1654987456258526, "DES_decrypted_data_test.txt");
+
+    /* Triple-DES known answer (NIST SP 800-67 example) */
+    DES3_KEY_CONTEXT_T context;
+    const uint8_t plain[24] = "The qufck brown fox jump";
+    const uint8_t expected[24] = {
+        0xA8, 0x26, 0xFD, 0x8C, 0xE5, 0x3B, 0x85, 0x5F, 0xCC, 0xE2, 0x1C, 0x81,
+        0x12, 0x25, 0x6F, 0xE6, 0x68, 0xD5, 0xC0, 0x5D, 0xD9, 0xB6, 0xB9, 0x00
+    };
+    uint8_t buffer[24];
+
+    DES3_Init_Key_Context(&context, 0x0123456789ABCDEF, 0x23456789ABCDEF01, 0x456789ABCDEF0123);
+    DES3_ECB_Process_Blocks(&context, plain, buffer, 3, DES_ENCRYPTION_MODE);
+    printf("3DES known answer: %s\n", (memcmp(buffer, expected, 24) == 0) ? "OK" : "FAILED");
+
+    DES3_encryption("plain_data_test.txt", 0x1654987456258526, 0x0123456789ABCDEF, 0x1654987456258526, "DES3_encrypted_data_test.txt");
+    DES3_decryption("DES3_encrypted_data_test.txt", 0x1654987456258526, 0x0123456789ABCDEF, 0x1654987456258526, "DES3_decrypted_data_test.txt");
+
+    /* bitsliced key search over a short range around the key (the load test is DES_Key_Search_Benchmark(), run by "main --benchmark") */
+    DES_KEY_SEARCH_RESULT_T search;
+    uint64_t key_index = DES_Key_To_Index(DES_KEY_SEARCH_TEST_KEY);
+    int search_ok = (DES_Key_Search(DES_KEY_SEARCH_TEST_PLAINTEXT, DES_KEY_SEARCH_TEST_CIPHERTEXT, key_index - 100, 200, 1, &search) == EXIT_SUCCESS);
+    printf("DES key search: %s\n", (search_ok && search.found && (search.key == DES_KEY_SEARCH_TEST_KEY)) ? "OK" : "FAILED");
 }
\ No newline at end of file
@@ -9,9 +9,74 @@
 #define DES_ENCRYPTION_MODE         0
 #define DES_DECRYPTION_MODE         1
 
+#define DES_ENGINE_REFERENCE        0           // bit-by-bit permutations (reference path)
+#define DES_ENGINE_TABLES           1           // combined S+P tables, byte-indexed IP/FP tables
+#define DES_ENGINE                  DES_ENGINE_TABLES       // select the DES engine
+#define DES_BITSLICE_WORDS          2           // batches: 64-bits words per bit plane (64 blocks each; 2: SSE2, 4: AVX2)
+
+#define DES_FILE_CHUNK_BLOCKS       1024        // number of blocks read, processed and written at once by the file functions
+
+#define DES_KEY_SEARCH_MAX_THREADS  256         // key search: maximum number of threads (per-thread statistics)
+
+/* FIPS 46 worked example: the key search test and benchmark search a range holding this key */
+#define DES_KEY_SEARCH_TEST_KEY             0x133457799BBCDFF1
+#define DES_KEY_SEARCH_TEST_PLAINTEXT       0x0123456789ABCDEF
+#define DES_KEY_SEARCH_TEST_CIPHERTEXT      0x85E813540F0AB405
+
+
+/*
+    Expanded key: the 16 sub-keys (48-bits) are computed once by DES_Init_Key_Context(), in encryption
+    order and in reverse order for decryption.
+*/
+typedef struct {
+    uint64_t sub_keys[16];
+    uint64_t decryption_sub_keys[16];
+} DES_KEY_CONTEXT_T;
+
+/*
+    Triple-DES (EDE) expanded key: the 48 sub-keys of the three stages, E(key1), D(key2), E(key3), and the
+    same sequence in reverse order for decryption. With two keys (EDE2), key3 is key1.
+*/
+typedef struct {
+    uint64_t sub_keys[48];
+    uint64_t decryption_sub_keys[48];
+} DES3_KEY_CONTEXT_T;
+
+/*
+    Result of a known-plaintext key search. Keys are numbered by their 56 effective bits ("key index",
+    see DES_Key_From_Index()).
+*/
+typedef struct {
+    int found;                          // 1 if a key of the range maps the plaintext to the ciphertext
+    uint64_t key;                       // key found (odd parity)
+    uint64_t keys_tested;
+    double seconds;
+    double keys_per_second;             // whole search
+    int thread_count;
+    uint64_t thread_keys_tested[DES_KEY_SEARCH_MAX_THREADS];
+    double thread_keys_per_second[DES_KEY_SEARCH_MAX_THREADS];
+} DES_KEY_SEARCH_RESULT_T;
+
+
+void DES_Init_Key_Context(DES_KEY_CONTEXT_T *context, uint64_t key);
+void DES_ECB_Process_Blocks(const DES_KEY_CONTEXT_T *context, const uint8_t *input, uint8_t *output, size_t block_count, int mode);
+void DES_CTR_Process(const DES_KEY_CONTEXT_T *context, uint64_t counter, const uint8_t *input, uint8_t *output, size_t size);
+
 
 int DES_encryption(const char* const plain_file_name, uint64_t key, const char* const encrypted_file_name);
 int DES_decryption(const char* const encrypted_file_name, uint64_t key, const char* const decrypted_file_name);
+
+void DES3_Init_Key_Context(DES3_KEY_CONTEXT_T *context, uint64_t key1, uint64_t key2, uint64_t key3);
+void DES3_ECB_Process_Blocks(const DES3_KEY_CONTEXT_T *context, const uint8_t *input, uint8_t *output, size_t block_count, int mode);
+void DES3_CTR_Process(const DES3_KEY_CONTEXT_T *context, uint64_t counter, const uint8_t *input, uint8_t *output, size_t size);
+
+int DES3_encryption(const char* const plain_file_name, uint64_t key1, uint64_t key2, uint64_t key3, const char* const encrypted_file_name);
+int DES3_decryption(const char* const encrypted_file_name, uint64_t key1, uint64_t key2, uint64_t key3, const char* const decrypted_file_name);
+uint64_t DES_Key_From_Index(uint64_t index);
+uint64_t DES_Key_To_Index(uint64_t key);
+int DES_Key_Search(uint64_t plaintext, uint64_t ciphertext, uint64_t first_index, uint64_t key_count, int thread_count, DES_KEY_SEARCH_RESULT_T *result);
+void DES_Key_Search_Benchmark(uint64_t key_count, int thread_count);
+
 void DES_test(void);
 
 #endif      // DES_H_
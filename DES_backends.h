@@ -0,0 +1,35 @@
+#ifndef DES_BACKENDS_H_
+#define DES_BACKENDS_H_
+
+/*
+    Internal interface between the DES modes (DES.c), the key search (DES_keysearch.c) and the bitsliced
+    engine (DES_bitslice.c).
+    Blocks are 64-bits values with DES bit 1 as the most significant bit (big-endian data).
+*/
+#include "DES.h"
+
+
+#define DES_BITSLICE_BLOCKS         (64 * DES_BITSLICE_WORDS)       // blocks processed per pass
+
+
+/* one bit plane: bit b of word w holds a bit of block ("lane") 64*w + 63-b */
+typedef uint64_t DES_SLICE_T __attribute__((vector_size(8 * DES_BITSLICE_WORDS)));
+
+/* sub-keys spread to bit planes (all-zeros or all-ones, the key being the same for all the blocks) */
+typedef struct {
+    DES_SLICE_T key_planes[16][48];
+} DES_BITSLICE_KEY_T;
+
+
+/* DES.c */
+extern const int DES_IP_table[64];
+extern const int DES_IP_INV_table[64];
+extern const int DES_E_table[48];
+extern const int DES_P_table[32];
+
+/* DES_bitslice.c */
+void DES_Bitslice_Init_Key(DES_BITSLICE_KEY_T *key, const uint64_t *sub_keys);
+void DES_Bitslice_Planes(const DES_BITSLICE_KEY_T *key, DES_SLICE_T *planes);
+void DES_Bitslice_Blocks(const DES_BITSLICE_KEY_T *key, uint64_t *blocks);
+
+#endif      // DES_BACKENDS_H_
@@ -0,0 +1,628 @@
+/*
+    Bitsliced DES: DES_BITSLICE_BLOCKS blocks (64 per 64-bits word of a plane) are processed at once, one
+    variable ("bit plane") per bit position, with GCC vector types (DES_BITSLICE_WORDS words per plane:
+    SSE2 with 2 words, AVX2 with 4 words when the compiler targets it).
+
+    With this layout the permutations (IP, E, P, FP) are only a choice of planes, and the S-boxes are
+    boolean circuits: no table lookup, no memory access depending on the data or on the key.
+    The circuits below were generated from S1..S8 (DES.c): for each S-box, a shared decision diagram of
+    its 4 outputs, the input order giving the smallest circuit (about 100 gates per S-box).
+    Inputs a1..a6 are the 6 S-box input bits in DES order (a1: row MSB), out1..out4 the 4 output bits
+    (out1: MSB); the outputs are XORed into their destination.
+*/
+#include "DES_backends.h"
+
+
+
+static inline void des_s1(DES_SLICE_T a1, DES_SLICE_T a2, DES_SLICE_T a3, DES_SLICE_T a4, DES_SLICE_T a5, DES_SLICE_T a6,
+                           DES_SLICE_T *out1, DES_SLICE_T *out2, DES_SLICE_T *out3, DES_SLICE_T *out4)
+{
+    DES_SLICE_T x0 = ~a6 ^ a5;
+    DES_SLICE_T x1 = x0 ^ a2;
+    DES_SLICE_T x2 = a6 & a5;
+    DES_SLICE_T x3 = x1 ^ (x2 & a4);
+    DES_SLICE_T x4 = ~a2 ^ (x1 & a4);
+    DES_SLICE_T x5 = x3 ^ (x4 & a3);
+    DES_SLICE_T x6 = ~a5 ^ (x2 & a2);
+    DES_SLICE_T x7 = ~a6 ^ (x0 & a2);
+    DES_SLICE_T x8 = x6 ^ (x7 & a4);
+    DES_SLICE_T x9 = a5 ^ (~x2 & a2);
+    DES_SLICE_T x10 = x0 ^ (~a6 & a2);
+    DES_SLICE_T x11 = x9 ^ (x10 & a4);
+    DES_SLICE_T x12 = x8 ^ (x11 & a3);
+    DES_SLICE_T x13 = x5 ^ (x12 & a1);
+    DES_SLICE_T x14 = ~a6 | a5;
+    DES_SLICE_T x15 = x14 ^ (~a6 & a2);
+    DES_SLICE_T x16 = ~x0 | a2;
+    DES_SLICE_T x17 = x15 ^ (x16 & a4);
+    DES_SLICE_T x18 = a6 | ~a5;
+    DES_SLICE_T x19 = x18 ^ (a6 & a2);
+    DES_SLICE_T x20 = x19 ^ (~x14 & a4);
+    DES_SLICE_T x21 = x17 ^ (x20 & a3);
+    DES_SLICE_T x22 = x16 ^ (~x6 & a4);
+    DES_SLICE_T x23 = ~a6 & ~a5;
+    DES_SLICE_T x24 = ~x2 ^ (x23 & a2);
+    DES_SLICE_T x25 = ~x2 ^ (~a6 & a2);
+    DES_SLICE_T x26 = x24 ^ (x25 & a4);
+    DES_SLICE_T x27 = x22 ^ (x26 & a3);
+    DES_SLICE_T x28 = x21 ^ (x27 & a1);
+    DES_SLICE_T x29 = x0 | a2;
+    DES_SLICE_T x30 = x18 ^ (x14 & a2);
+    DES_SLICE_T x31 = x29 ^ (x30 & a4);
+    DES_SLICE_T x32 = ~a6 & ~a2;
+    DES_SLICE_T x33 = x16 ^ (x32 & a4);
+    DES_SLICE_T x34 = x31 ^ (x33 & a3);
+    DES_SLICE_T x35 = x23 & a2;
+    DES_SLICE_T x36 = x30 ^ (x35 & a4);
+    DES_SLICE_T x37 = x35 ^ (x25 & a4);
+    DES_SLICE_T x38 = x36 ^ (x37 & a3);
+    DES_SLICE_T x39 = x34 ^ (x38 & a1);
+    DES_SLICE_T x40 = x2 ^ (x0 & a2);
+    DES_SLICE_T x41 = x0 | ~a2;
+    DES_SLICE_T x42 = x40 ^ (x41 & a4);
+    DES_SLICE_T x43 = a5 ^ (~x14 & a2);
+    DES_SLICE_T x44 = x42 ^ (x43 & a3);
+    DES_SLICE_T x45 = ~x23 ^ (~x18 & a2);
+    DES_SLICE_T x46 = x0 ^ (a5 & a2);
+    DES_SLICE_T x47 = x45 ^ (x46 & a4);
+    DES_SLICE_T x48 = x23 ^ (~a6 & a2);
+    DES_SLICE_T x49 = ~x9 ^ (x48 & a4);
+    DES_SLICE_T x50 = x47 ^ (x49 & a3);
+    DES_SLICE_T x51 = x44 ^ (x50 & a1);
+
+    *out1 ^= x13;
+    *out2 ^= x28;
+    *out3 ^= x39;
+    *out4 ^= x51;
+}
+
+static inline void des_s2(DES_SLICE_T a1, DES_SLICE_T a2, DES_SLICE_T a3, DES_SLICE_T a4, DES_SLICE_T a5, DES_SLICE_T a6,
+                           DES_SLICE_T *out1, DES_SLICE_T *out2, DES_SLICE_T *out3, DES_SLICE_T *out4)
+{
+    DES_SLICE_T x0 = ~a6 ^ a5;
+    DES_SLICE_T x1 = ~a6 | ~a5;
+    DES_SLICE_T x2 = x0 ^ (x1 & a1);
+    DES_SLICE_T x3 = x1 | ~a1;
+    DES_SLICE_T x4 = x2 ^ (x3 & a3);
+    DES_SLICE_T x5 = a6 & ~a5;
+    DES_SLICE_T x6 = a6 ^ (x5 & a1);
+    DES_SLICE_T x7 = ~a6 & ~a1;
+    DES_SLICE_T x8 = x6 ^ (x7 & a3);
+    DES_SLICE_T x9 = x4 ^ (x8 & a2);
+    DES_SLICE_T x10 = ~a6 & a5;
+    DES_SLICE_T x11 = a5 ^ (x10 & a1);
+    DES_SLICE_T x12 = x11 | a2;
+    DES_SLICE_T x13 = x9 ^ (x12 & a4);
+    DES_SLICE_T x14 = x0 ^ a1;
+    DES_SLICE_T x15 = x14 ^ (a6 & a3);
+    DES_SLICE_T x16 = x10 & a1;
+    DES_SLICE_T x17 = x16 | ~a3;
+    DES_SLICE_T x18 = x15 ^ (x17 & a2);
+    DES_SLICE_T x19 = x1 | a3;
+    DES_SLICE_T x20 = ~a6 ^ (x10 & a1);
+    DES_SLICE_T x21 = x19 ^ (x20 & a2);
+    DES_SLICE_T x22 = x18 ^ (x21 & a4);
+    DES_SLICE_T x23 = ~a5 ^ (x1 & a1);
+    DES_SLICE_T x24 = a5 | a1;
+    DES_SLICE_T x25 = x23 ^ (x24 & a3);
+    DES_SLICE_T x26 = x1 ^ (x0 & a1);
+    DES_SLICE_T x27 = a6 ^ (~x10 & a1);
+    DES_SLICE_T x28 = x26 ^ (x27 & a3);
+    DES_SLICE_T x29 = x25 ^ (x28 & a2);
+    DES_SLICE_T x30 = ~a5 | ~a1;
+    DES_SLICE_T x31 = x0 & ~a1;
+    DES_SLICE_T x32 = x30 ^ (x31 & a3);
+    DES_SLICE_T x33 = x5 | a1;
+    DES_SLICE_T x34 = x33 ^ (a1 & a3);
+    DES_SLICE_T x35 = x32 ^ (x34 & a2);
+    DES_SLICE_T x36 = x29 ^ (x35 & a4);
+    DES_SLICE_T x37 = x5 | ~a1;
+    DES_SLICE_T x38 = ~a6 & ~a5;
+    DES_SLICE_T x39 = x0 ^ (x38 & a1);
+    DES_SLICE_T x40 = x37 ^ (x39 & a3);
+    DES_SLICE_T x41 = x10 ^ (x5 & a1);
+    DES_SLICE_T x42 = x27 ^ (x41 & a3);
+    DES_SLICE_T x43 = x40 ^ (x42 & a2);
+    DES_SLICE_T x44 = x1 | a1;
+    DES_SLICE_T x45 = x10 ^ (a6 & a1);
+    DES_SLICE_T x46 = x44 ^ (x45 & a2);
+    DES_SLICE_T x47 = x43 ^ (x46 & a4);
+
+    *out1 ^= x13;
+    *out2 ^= x22;
+    *out3 ^= x36;
+    *out4 ^= x47;
+}
+
+static inline void des_s3(DES_SLICE_T a1, DES_SLICE_T a2, DES_SLICE_T a3, DES_SLICE_T a4, DES_SLICE_T a5, DES_SLICE_T a6,
+                           DES_SLICE_T *out1, DES_SLICE_T *out2, DES_SLICE_T *out3, DES_SLICE_T *out4)
+{
+    DES_SLICE_T x0 = ~a5 ^ a2;
+    DES_SLICE_T x1 = a5 | a2;
+    DES_SLICE_T x2 = ~a5 | a2;
+    DES_SLICE_T x3 = x1 ^ (x2 & a6);
+    DES_SLICE_T x4 = x0 ^ (x3 & a4);
+    DES_SLICE_T x5 = a5 & a2;
+    DES_SLICE_T x6 = x2 ^ (x5 & a6);
+    DES_SLICE_T x7 = ~a2 ^ (a5 & a6);
+    DES_SLICE_T x8 = x6 ^ (x7 & a4);
+    DES_SLICE_T x9 = x4 ^ (x8 & a3);
+    DES_SLICE_T x10 = a2 ^ a6;
+    DES_SLICE_T x11 = x10 ^ (~x3 & a4);
+    DES_SLICE_T x12 = x7 & ~a4;
+    DES_SLICE_T x13 = x11 ^ (x12 & a3);
+    DES_SLICE_T x14 = x9 ^ (x13 & a1);
+    DES_SLICE_T x15 = a5 | ~a2;
+    DES_SLICE_T x16 = x5 ^ (x15 & a6);
+    DES_SLICE_T x17 = ~x0 | a6;
+    DES_SLICE_T x18 = x16 ^ (x17 & a4);
+    DES_SLICE_T x19 = ~x1 ^ (~x15 & a6);
+    DES_SLICE_T x20 = x19 ^ (a2 & a4);
+    DES_SLICE_T x21 = x18 ^ (x20 & a3);
+    DES_SLICE_T x22 = x15 | a6;
+    DES_SLICE_T x23 = x22 ^ (~x7 & a4);
+    DES_SLICE_T x24 = x23 | a3;
+    DES_SLICE_T x25 = x21 ^ (x24 & a1);
+    DES_SLICE_T x26 = ~x1 ^ (~x5 & a6);
+    DES_SLICE_T x27 = x15 ^ (~a5 & a6);
+    DES_SLICE_T x28 = x26 ^ (x27 & a4);
+    DES_SLICE_T x29 = x17 | a4;
+    DES_SLICE_T x30 = x28 ^ (x29 & a3);
+    DES_SLICE_T x31 = x0 ^ (~x1 & a6);
+    DES_SLICE_T x32 = ~x16 ^ (x31 & a4);
+    DES_SLICE_T x33 = a5 & ~a6;
+    DES_SLICE_T x34 = a2 ^ (x0 & a6);
+    DES_SLICE_T x35 = x33 ^ (x34 & a4);
+    DES_SLICE_T x36 = x32 ^ (x35 & a3);
+    DES_SLICE_T x37 = x30 ^ (x36 & a1);
+    DES_SLICE_T x38 = x10 ^ (~a5 & a4);
+    DES_SLICE_T x39 = x38 ^ (a5 & a3);
+    DES_SLICE_T x40 = ~x1 ^ (x15 & a6);
+    DES_SLICE_T x41 = a5 ^ a6;
+    DES_SLICE_T x42 = x40 ^ (x41 & a4);
+    DES_SLICE_T x43 = ~x1 ^ (a2 & a6);
+    DES_SLICE_T x44 = a2 & a6;
+    DES_SLICE_T x45 = x43 ^ (x44 & a4);
+    DES_SLICE_T x46 = x42 ^ (x45 & a3);
+    DES_SLICE_T x47 = x39 ^ (x46 & a1);
+
+    *out1 ^= x14;
+    *out2 ^= x25;
+    *out3 ^= x37;
+    *out4 ^= x47;
+}
+
+static inline void des_s4(DES_SLICE_T a1, DES_SLICE_T a2, DES_SLICE_T a3, DES_SLICE_T a4, DES_SLICE_T a5, DES_SLICE_T a6,
+                           DES_SLICE_T *out1, DES_SLICE_T *out2, DES_SLICE_T *out3, DES_SLICE_T *out4)
+{
+    DES_SLICE_T x0 = ~a3 | ~a1;
+    DES_SLICE_T x1 = a1 ^ x0;
+    DES_SLICE_T x2 = a1 ^ (x1 & a4);
+    DES_SLICE_T x3 = a3 ^ a1;
+    DES_SLICE_T x4 = x3 ^ a4;
+    DES_SLICE_T x5 = x2 ^ x4;
+    DES_SLICE_T x6 = x2 ^ (x5 & a2);
+    DES_SLICE_T x7 = ~x3 ^ (~a1 & a4);
+    DES_SLICE_T x8 = a3 & ~a1;
+    DES_SLICE_T x9 = x8 ^ (~x1 & a4);
+    DES_SLICE_T x10 = x7 ^ x9;
+    DES_SLICE_T x11 = x7 ^ (x10 & a2);
+    DES_SLICE_T x12 = x6 ^ x11;
+    DES_SLICE_T x13 = x6 ^ (x12 & a5);
+    DES_SLICE_T x14 = a1 ^ x8;
+    DES_SLICE_T x15 = a1 ^ (x14 & a4);
+    DES_SLICE_T x16 = ~x3 ^ x15;
+    DES_SLICE_T x17 = ~x3 ^ (x16 & a2);
+    DES_SLICE_T x18 = x0 ^ a4;
+    DES_SLICE_T x19 = x8 | a4;
+    DES_SLICE_T x20 = x18 ^ x19;
+    DES_SLICE_T x21 = x18 ^ (x20 & a2);
+    DES_SLICE_T x22 = x17 ^ x21;
+    DES_SLICE_T x23 = x17 ^ (x22 & a5);
+    DES_SLICE_T x24 = x13 ^ x23;
+    DES_SLICE_T x25 = x13 ^ (x24 & a6);
+    DES_SLICE_T x26 = x23 ^ (~x24 & a6);
+    DES_SLICE_T x27 = ~a3 ^ (a1 & a4);
+    DES_SLICE_T x28 = x27 ^ (~x15 & a2);
+    DES_SLICE_T x29 = x14 ^ (~x8 & a4);
+    DES_SLICE_T x30 = x29 ^ ~x4;
+    DES_SLICE_T x31 = x29 ^ (x30 & a2);
+    DES_SLICE_T x32 = x28 ^ x31;
+    DES_SLICE_T x33 = x28 ^ (x32 & a5);
+    DES_SLICE_T x34 = x14 ^ a4;
+    DES_SLICE_T x35 = x1 & a4;
+    DES_SLICE_T x36 = x34 ^ x35;
+    DES_SLICE_T x37 = x34 ^ (x36 & a2);
+    DES_SLICE_T x38 = x3 ^ x10;
+    DES_SLICE_T x39 = x3 ^ (x38 & a2);
+    DES_SLICE_T x40 = x37 ^ x39;
+    DES_SLICE_T x41 = x37 ^ (x40 & a5);
+    DES_SLICE_T x42 = x33 ^ x41;
+    DES_SLICE_T x43 = x33 ^ (x42 & a6);
+    DES_SLICE_T x44 = ~x41 ^ (~x42 & a6);
+
+    *out1 ^= x25;
+    *out2 ^= x26;
+    *out3 ^= x43;
+    *out4 ^= x44;
+}
+
+static inline void des_s5(DES_SLICE_T a1, DES_SLICE_T a2, DES_SLICE_T a3, DES_SLICE_T a4, DES_SLICE_T a5, DES_SLICE_T a6,
+                           DES_SLICE_T *out1, DES_SLICE_T *out2, DES_SLICE_T *out3, DES_SLICE_T *out4)
+{
+    DES_SLICE_T x0 = a6 | a5;
+    DES_SLICE_T x1 = x0 ^ (a6 & a3);
+    DES_SLICE_T x2 = ~a6 & a5;
+    DES_SLICE_T x3 = ~a6 | a5;
+    DES_SLICE_T x4 = x2 ^ (x3 & a3);
+    DES_SLICE_T x5 = x1 ^ (x4 & a1);
+    DES_SLICE_T x6 = a6 ^ a5;
+    DES_SLICE_T x7 = x6 ^ (~x0 & a3);
+    DES_SLICE_T x8 = a6 ^ (a5 & a3);
+    DES_SLICE_T x9 = x7 ^ (x8 & a1);
+    DES_SLICE_T x10 = x5 ^ (x9 & a4);
+    DES_SLICE_T x11 = x3 | ~a3;
+    DES_SLICE_T x12 = a6 & a5;
+    DES_SLICE_T x13 = x12 ^ (a6 & a3);
+    DES_SLICE_T x14 = x11 ^ (x13 & a1);
+    DES_SLICE_T x15 = ~x0 ^ a3;
+    DES_SLICE_T x16 = ~x6 ^ (x15 & a1);
+    DES_SLICE_T x17 = x14 ^ (x16 & a4);
+    DES_SLICE_T x18 = x10 ^ (x17 & a2);
+    DES_SLICE_T x19 = x6 ^ (x3 & a3);
+    DES_SLICE_T x20 = x19 ^ (~x12 & a1);
+    DES_SLICE_T x21 = x2 ^ (a5 & a3);
+    DES_SLICE_T x22 = x11 ^ (x21 & a1);
+    DES_SLICE_T x23 = x20 ^ (x22 & a4);
+    DES_SLICE_T x24 = a6 & a3;
+    DES_SLICE_T x25 = a6 | a3;
+    DES_SLICE_T x26 = x24 ^ (x25 & a1);
+    DES_SLICE_T x27 = x26 | a4;
+    DES_SLICE_T x28 = x23 ^ (x27 & a2);
+    DES_SLICE_T x29 = ~x2 ^ (x6 & a3);
+    DES_SLICE_T x30 = x3 ^ (~x6 & a3);
+    DES_SLICE_T x31 = x29 ^ (x30 & a1);
+    DES_SLICE_T x32 = ~a5 ^ (~x0 & a3);
+    DES_SLICE_T x33 = ~x7 ^ (x32 & a1);
+    DES_SLICE_T x34 = x31 ^ (x33 & a4);
+    DES_SLICE_T x35 = ~x2 | a3;
+    DES_SLICE_T x36 = x6 ^ (~x12 & a3);
+    DES_SLICE_T x37 = x35 ^ (x36 & a1);
+    DES_SLICE_T x38 = x6 ^ (~a6 & a3);
+    DES_SLICE_T x39 = ~x12 ^ (~a6 & a3);
+    DES_SLICE_T x40 = x38 ^ (x39 & a1);
+    DES_SLICE_T x41 = x37 ^ (x40 & a4);
+    DES_SLICE_T x42 = x34 ^ (x41 & a2);
+    DES_SLICE_T x43 = x12 ^ (~x0 & a3);
+    DES_SLICE_T x44 = x43 ^ (x25 & a1);
+    DES_SLICE_T x45 = a5 ^ (x0 & a3);
+    DES_SLICE_T x46 = x45 | a1;
+    DES_SLICE_T x47 = x44 ^ (x46 & a4);
+    DES_SLICE_T x48 = x0 ^ (a5 & a3);
+    DES_SLICE_T x49 = ~x0 & ~a3;
+    DES_SLICE_T x50 = x48 ^ (x49 & a1);
+    DES_SLICE_T x51 = ~a5 ^ a3;
+    DES_SLICE_T x52 = x3 ^ (x51 & a1);
+    DES_SLICE_T x53 = x50 ^ (x52 & a4);
+    DES_SLICE_T x54 = x47 ^ (x53 & a2);
+
+    *out1 ^= x18;
+    *out2 ^= x28;
+    *out3 ^= x42;
+    *out4 ^= x54;
+}
+
+static inline void des_s6(DES_SLICE_T a1, DES_SLICE_T a2, DES_SLICE_T a3, DES_SLICE_T a4, DES_SLICE_T a5, DES_SLICE_T a6,
+                           DES_SLICE_T *out1, DES_SLICE_T *out2, DES_SLICE_T *out3, DES_SLICE_T *out4)
+{
+    DES_SLICE_T x0 = a6 ^ a2;
+    DES_SLICE_T x1 = ~a2 ^ (x0 & a3);
+    DES_SLICE_T x2 = ~a6 | a2;
+    DES_SLICE_T x3 = a6 ^ (x2 & a3);
+    DES_SLICE_T x4 = x1 ^ (x3 & a4);
+    DES_SLICE_T x5 = ~a6 | a3;
+    DES_SLICE_T x6 = ~a6 & ~a3;
+    DES_SLICE_T x7 = x5 ^ (x6 & a4);
+    DES_SLICE_T x8 = x4 ^ (x7 & a5);
+    DES_SLICE_T x9 = a6 & a2;
+    DES_SLICE_T x10 = ~x2 ^ (x9 & a3);
+    DES_SLICE_T x11 = x3 ^ (x10 & a4);
+    DES_SLICE_T x12 = ~x3 ^ (~x2 & a4);
+    DES_SLICE_T x13 = x11 ^ (x12 & a5);
+    DES_SLICE_T x14 = x8 ^ (x13 & a1);
+    DES_SLICE_T x15 = ~x0 ^ a3;
+    DES_SLICE_T x16 = x15 ^ (~a2 & a4);
+    DES_SLICE_T x17 = x9 ^ a3;
+    DES_SLICE_T x18 = ~a3 ^ (x17 & a4);
+    DES_SLICE_T x19 = x16 ^ (x18 & a5);
+    DES_SLICE_T x20 = a6 | a2;
+    DES_SLICE_T x21 = x20 | ~a3;
+    DES_SLICE_T x22 = x9 & a3;
+    DES_SLICE_T x23 = x21 ^ (x22 & a4);
+    DES_SLICE_T x24 = x20 & a3;
+    DES_SLICE_T x25 = x24 ^ (x15 & a4);
+    DES_SLICE_T x26 = x23 ^ (x25 & a5);
+    DES_SLICE_T x27 = x19 ^ (x26 & a1);
+    DES_SLICE_T x28 = a6 ^ (a2 & a3);
+    DES_SLICE_T x29 = x28 ^ a4;
+    DES_SLICE_T x30 = x9 ^ (~a2 & a3);
+    DES_SLICE_T x31 = x30 ^ (x0 & a4);
+    DES_SLICE_T x32 = x29 ^ (x31 & a5);
+    DES_SLICE_T x33 = x0 | a3;
+    DES_SLICE_T x34 = ~x2 | ~a3;
+    DES_SLICE_T x35 = x34 ^ (x20 & a4);
+    DES_SLICE_T x36 = x33 ^ (x35 & a5);
+    DES_SLICE_T x37 = x32 ^ (x36 & a1);
+    DES_SLICE_T x38 = ~a2 & a3;
+    DES_SLICE_T x39 = a2 ^ (~x20 & a3);
+    DES_SLICE_T x40 = x38 ^ (x39 & a4);
+    DES_SLICE_T x41 = x2 ^ (~a6 & a3);
+    DES_SLICE_T x42 = x41 | ~a4;
+    DES_SLICE_T x43 = x40 ^ (x42 & a5);
+    DES_SLICE_T x44 = x9 ^ (~a6 & a3);
+    DES_SLICE_T x45 = ~x10 ^ (x44 & a4);
+    DES_SLICE_T x46 = a3 ^ (x41 & a4);
+    DES_SLICE_T x47 = x45 ^ (x46 & a5);
+    DES_SLICE_T x48 = x43 ^ (x47 & a1);
+
+    *out1 ^= x14;
+    *out2 ^= x27;
+    *out3 ^= x37;
+    *out4 ^= x48;
+}
+
+static inline void des_s7(DES_SLICE_T a1, DES_SLICE_T a2, DES_SLICE_T a3, DES_SLICE_T a4, DES_SLICE_T a5, DES_SLICE_T a6,
+                           DES_SLICE_T *out1, DES_SLICE_T *out2, DES_SLICE_T *out3, DES_SLICE_T *out4)
+{
+    DES_SLICE_T x0 = a6 ^ a5;
+    DES_SLICE_T x1 = a6 | ~a4;
+    DES_SLICE_T x2 = x1 | ~a5;
+    DES_SLICE_T x3 = x0 ^ (x2 & a3);
+    DES_SLICE_T x4 = ~a6 & ~a4;
+    DES_SLICE_T x5 = a4 ^ (x4 & a3);
+    DES_SLICE_T x6 = x3 ^ (x5 & a2);
+    DES_SLICE_T x7 = a6 ^ a4;
+    DES_SLICE_T x8 = ~a6 | a4;
+    DES_SLICE_T x9 = x7 ^ (x8 & a5);
+    DES_SLICE_T x10 = a6 ^ (x1 & a5);
+    DES_SLICE_T x11 = x9 ^ (x10 & a3);
+    DES_SLICE_T x12 = ~a4 | a5;
+    DES_SLICE_T x13 = x4 ^ a5;
+    DES_SLICE_T x14 = x12 ^ (x13 & a3);
+    DES_SLICE_T x15 = x11 ^ (x14 & a2);
+    DES_SLICE_T x16 = x6 ^ (x15 & a1);
+    DES_SLICE_T x17 = ~a4 ^ a5;
+    DES_SLICE_T x18 = a6 & a4;
+    DES_SLICE_T x19 = x18 & a5;
+    DES_SLICE_T x20 = x17 ^ (x19 & a3);
+    DES_SLICE_T x21 = ~x7 ^ (x18 & a5);
+    DES_SLICE_T x22 = x21 ^ a3;
+    DES_SLICE_T x23 = x20 ^ (x22 & a2);
+    DES_SLICE_T x24 = ~a4 | ~a5;
+    DES_SLICE_T x25 = ~x7 ^ (x24 & a3);
+    DES_SLICE_T x26 = ~x18 | a5;
+    DES_SLICE_T x27 = x26 ^ (x7 & a3);
+    DES_SLICE_T x28 = x25 ^ (x27 & a2);
+    DES_SLICE_T x29 = x23 ^ (x28 & a1);
+    DES_SLICE_T x30 = a4 ^ (x4 & a5);
+    DES_SLICE_T x31 = x8 ^ (x18 & a5);
+    DES_SLICE_T x32 = x30 ^ (x31 & a3);
+    DES_SLICE_T x33 = x2 ^ (x18 & a3);
+    DES_SLICE_T x34 = x32 ^ (x33 & a2);
+    DES_SLICE_T x35 = a6 | a5;
+    DES_SLICE_T x36 = ~x18 ^ (x8 & a5);
+    DES_SLICE_T x37 = x35 ^ (x36 & a3);
+    DES_SLICE_T x38 = x8 ^ (~a6 & a5);
+    DES_SLICE_T x39 = ~x12 ^ (x38 & a3);
+    DES_SLICE_T x40 = x37 ^ (x39 & a2);
+    DES_SLICE_T x41 = x34 ^ (x40 & a1);
+    DES_SLICE_T x42 = a6 ^ (~a4 & a5);
+    DES_SLICE_T x43 = x42 ^ (x12 & a3);
+    DES_SLICE_T x44 = x26 ^ a3;
+    DES_SLICE_T x45 = x43 ^ (x44 & a2);
+    DES_SLICE_T x46 = x26 | a3;
+    DES_SLICE_T x47 = x18 ^ (a6 & a5);
+    DES_SLICE_T x48 = x47 ^ (a6 & a3);
+    DES_SLICE_T x49 = x46 ^ (x48 & a2);
+    DES_SLICE_T x50 = x45 ^ (x49 & a1);
+
+    *out1 ^= x16;
+    *out2 ^= x29;
+    *out3 ^= x41;
+    *out4 ^= x50;
+}
+
+static inline void des_s8(DES_SLICE_T a1, DES_SLICE_T a2, DES_SLICE_T a3, DES_SLICE_T a4, DES_SLICE_T a5, DES_SLICE_T a6,
+                           DES_SLICE_T *out1, DES_SLICE_T *out2, DES_SLICE_T *out3, DES_SLICE_T *out4)
+{
+    DES_SLICE_T x0 = ~a5 ^ a3;
+    DES_SLICE_T x1 = x0 ^ (a5 & a2);
+    DES_SLICE_T x2 = ~a5 | ~a3;
+    DES_SLICE_T x3 = x1 ^ (x2 & a1);
+    DES_SLICE_T x4 = a5 | ~a2;
+    DES_SLICE_T x5 = ~a5 & a3;
+    DES_SLICE_T x6 = x0 ^ (x5 & a2);
+    DES_SLICE_T x7 = x4 ^ (x6 & a1);
+    DES_SLICE_T x8 = x3 ^ (x7 & a6);
+    DES_SLICE_T x9 = a3 ^ (x0 & a2);
+    DES_SLICE_T x10 = ~x0 ^ (a3 & a2);
+    DES_SLICE_T x11 = x9 ^ (x10 & a1);
+    DES_SLICE_T x12 = x0 ^ (~a3 & a2);
+    DES_SLICE_T x13 = ~x0 | a2;
+    DES_SLICE_T x14 = x12 ^ (x13 & a1);
+    DES_SLICE_T x15 = x11 ^ (x14 & a6);
+    DES_SLICE_T x16 = x8 ^ (x15 & a4);
+    DES_SLICE_T x17 = ~a5 | a3;
+    DES_SLICE_T x18 = x17 ^ (x0 & a2);
+    DES_SLICE_T x19 = x5 ^ (~x0 & a2);
+    DES_SLICE_T x20 = x18 ^ (x19 & a1);
+    DES_SLICE_T x21 = x17 | ~a1;
+    DES_SLICE_T x22 = x20 ^ (x21 & a6);
+    DES_SLICE_T x23 = x4 ^ (~x9 & a1);
+    DES_SLICE_T x24 = ~a3 | a2;
+    DES_SLICE_T x25 = x24 & a1;
+    DES_SLICE_T x26 = x23 ^ (x25 & a6);
+    DES_SLICE_T x27 = x22 ^ (x26 & a4);
+    DES_SLICE_T x28 = a5 | a3;
+    DES_SLICE_T x29 = x28 ^ a2;
+    DES_SLICE_T x30 = x17 | a2;
+    DES_SLICE_T x31 = x29 ^ (x30 & a1);
+    DES_SLICE_T x32 = x0 & a2;
+    DES_SLICE_T x33 = a5 ^ (~x2 & a2);
+    DES_SLICE_T x34 = x32 ^ (x33 & a1);
+    DES_SLICE_T x35 = x31 ^ (x34 & a6);
+    DES_SLICE_T x36 = a5 | a1;
+    DES_SLICE_T x37 = ~a5 | a2;
+    DES_SLICE_T x38 = x32 ^ (x37 & a1);
+    DES_SLICE_T x39 = x36 ^ (x38 & a6);
+    DES_SLICE_T x40 = x35 ^ (x39 & a4);
+    DES_SLICE_T x41 = x0 ^ a2;
+    DES_SLICE_T x42 = x28 ^ (x5 & a2);
+    DES_SLICE_T x43 = x41 ^ (x42 & a1);
+    DES_SLICE_T x44 = ~x17 ^ (~x0 & a2);
+    DES_SLICE_T x45 = x2 ^ (~x17 & a2);
+    DES_SLICE_T x46 = x44 ^ (x45 & a1);
+    DES_SLICE_T x47 = x43 ^ (x46 & a6);
+    DES_SLICE_T x48 = x37 ^ (~x4 & a1);
+    DES_SLICE_T x49 = ~x5 ^ (~x12 & a1);
+    DES_SLICE_T x50 = x48 ^ (x49 & a6);
+    DES_SLICE_T x51 = x47 ^ (x50 & a4);
+
+    *out1 ^= x16;
+    *out2 ^= x27;
+    *out3 ^= x40;
+    *out4 ^= x51;
+}
+
+
+/*
+    Transpose the 64x64 bit matrix a (a[i] is row i, column 0 being the most significant bit).
+*/
+static void transpose_64x64(uint64_t *a)
+{
+    uint64_t m = 0x00000000FFFFFFFF;
+
+    for(int j = 32; j != 0; j >>= 1, m ^= m << j){
+        for(int k = 0; k < 64; k = ((k | j) + 1) & ~j){
+            uint64_t t = (a[k] ^ (a[k | j] >> j)) & m;
+            a[k] ^= t;
+            a[k | j] ^= t << j;
+        }
+    }
+}
+
+
+/* blocks -> planes: plane i holds the DES bit i+1 of every block */
+static void blocks_to_planes(const uint64_t *blocks, DES_SLICE_T *planes)
+{
+    uint64_t rows[64];
+
+    for(int w = 0; w < DES_BITSLICE_WORDS; w++){
+        for(int r = 0; r < 64; r++){
+            rows[r] = blocks[64*w + r];
+        }
+        transpose_64x64(rows);
+        for(int i = 0; i < 64; i++){
+            planes[i][w] = rows[i];
+        }
+    }
+}
+
+static void planes_to_blocks(const DES_SLICE_T *planes, uint64_t *blocks)
+{
+    uint64_t rows[64];
+
+    for(int w = 0; w < DES_BITSLICE_WORDS; w++){
+        for(int i = 0; i < 64; i++){
+            rows[i] = planes[i][w];
+        }
+        transpose_64x64(rows);
+        for(int r = 0; r < 64; r++){
+            blocks[64*w + r] = rows[r];
+        }
+    }
+}
+
+
+
+/*
+    sub_keys: the 16 sub-keys in the order of the rounds (encryption or decryption).
+*/
+void DES_Bitslice_Init_Key(DES_BITSLICE_KEY_T *key, const uint64_t *sub_keys)
+{
+    for(int round = 0; round < 16; round++){
+        for(int k = 0; k < 48; k++){
+            uint64_t bit = (sub_keys[round] >> (47 - k)) & 1;
+            DES_SLICE_T zero = {0};
+
+            key->key_planes[round][k] = zero - bit;         // 0 or all-ones
+        }
+    }
+}
+
+
+/*
+    One round: left ^= P(S(E(right) ^ K)). p_destination[q]: position in the round output of the S-boxes
+    output bit q.
+*/
+static inline void des_round(DES_SLICE_T *left, const DES_SLICE_T *right, const DES_SLICE_T *key_planes, const int *p_destination)
+{
+    DES_SLICE_T in[48];
+
+    for(int k = 0; k < 48; k++){
+        in[k] = right[DES_E_table[k] - 1] ^ key_planes[k];
+    }
+
+    const int *d = p_destination;
+    des_s1(in[0], in[1], in[2], in[3], in[4], in[5], &left[d[0]], &left[d[1]], &left[d[2]], &left[d[3]]);
+    des_s2(in[6], in[7], in[8], in[9], in[10], in[11], &left[d[4]], &left[d[5]], &left[d[6]], &left[d[7]]);
+    des_s3(in[12], in[13], in[14], in[15], in[16], in[17], &left[d[8]], &left[d[9]], &left[d[10]], &left[d[11]]);
+    des_s4(in[18], in[19], in[20], in[21], in[22], in[23], &left[d[12]], &left[d[13]], &left[d[14]], &left[d[15]]);
+    des_s5(in[24], in[25], in[26], in[27], in[28], in[29], &left[d[16]], &left[d[17]], &left[d[18]], &left[d[19]]);
+    des_s6(in[30], in[31], in[32], in[33], in[34], in[35], &left[d[20]], &left[d[21]], &left[d[22]], &left[d[23]]);
+    des_s7(in[36], in[37], in[38], in[39], in[40], in[41], &left[d[24]], &left[d[25]], &left[d[26]], &left[d[27]]);
+    des_s8(in[42], in[43], in[44], in[45], in[46], in[47], &left[d[28]], &left[d[29]], &left[d[30]], &left[d[31]]);
+}
+
+
+/*
+    Encrypt (or decrypt, with a key built from the decryption sub-keys) the 64 bit planes of
+    DES_BITSLICE_BLOCKS blocks in place (plane i: DES bit i+1).
+*/
+void DES_Bitslice_Planes(const DES_BITSLICE_KEY_T *key, DES_SLICE_T *planes)
+{
+    DES_SLICE_T half[2][32];            // half[0]: L0, half[1]: R0; the rounds alternate between them
+    int p_destination[32];
+
+    for(int k = 0; k < 32; k++){
+        p_destination[DES_P_table[k] - 1] = k;
+    }
+
+    for(int k = 0; k < 32; k++){
+        half[0][k] = planes[DES_IP_table[k] - 1];
+        half[1][k] = planes[DES_IP_table[32 + k] - 1];
+    }
+
+    for(int round = 0; round < 16; round++){
+        des_round(half[round & 1], half[(round & 1) ^ 1], key->key_planes[round], p_destination);
+    }
+
+    /* pre-output R16 || L16 = half[1] || half[0] */
+    for(int k = 0; k < 64; k++){
+        int source = DES_IP_INV_table[k] - 1;
+        planes[k] = (source < 32) ? half[1][source] : half[0][source - 32];
+    }
+}
+
+
+/*
+    Encrypt (or decrypt, with a key built from the decryption sub-keys) DES_BITSLICE_BLOCKS blocks in place.
+*/
+void DES_Bitslice_Blocks(const DES_BITSLICE_KEY_T *key, uint64_t *blocks)
+{
+    DES_SLICE_T planes[64];
+
+    blocks_to_planes(blocks, planes);
+    DES_Bitslice_Planes(key, planes);
+    planes_to_blocks(planes, blocks);
+}
@@ -0,0 +1,337 @@
+/*
+    DES known-plaintext exhaustive key search, used as a whole-machine CPU benchmark.
+
+    The key range is split between the threads (parallel_for()); each thread tests DES_BITSLICE_BLOCKS keys
+    per pass with the bitsliced engine, one key per lane, the plaintext being the same in every lane.
+    Key index bits: the low bits select the lane, the high bits are a per-thread batch counter.
+
+    Each sub-key bit is a copy of one key bit (PC1, rotations and PC2 only select bits), so the key planes
+    of the 16 rounds are not recomputed between two batches: only the sub-key planes fed by the counter
+    bits that changed are inverted (2 counter bits on average, about 14 sub-key planes each).
+*/
+#include "DES_backends.h"
+#include <pthread.h>
+#include <time.h>
+
+
+typedef struct {
+    uint8_t round;
+    uint8_t bit;                    // 0: most significant bit of the 48-bits sub-key
+} SUB_KEY_BIT_T;
+
+typedef struct {
+    DES_SLICE_T plaintext_planes[64];
+    DES_SLICE_T ciphertext_planes[64];
+    DES_SLICE_T lane_planes[56];                // key index bits selecting the lane (lane_bits first entries)
+    SUB_KEY_BIT_T uses[56][16];                 // sub-key bits equal to each key index bit
+    int use_count[56];
+    int lane_bits;
+
+    uint64_t first_index;
+    uint64_t end_index;
+    uint64_t first_batch;
+    uint64_t batch_count;
+    int thread_count;
+
+    int found;                                  // read by all threads, stops the search
+    pthread_mutex_t mutex;
+    DES_KEY_SEARCH_RESULT_T *result;
+} KEY_SEARCH_T;
+
+
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+
+/* position of key index bit b in the DES key (bit 0: least significant bit, parity bits skipped) */
+static int key_bit_position(int b)
+{
+    return 8*(b / 7) + 1 + (b % 7);
+}
+
+
+/*
+    Key index (56 bits) -> DES key, with odd parity bytes.
+*/
+uint64_t DES_Key_From_Index(uint64_t index)
+{
+    uint64_t key = 0;
+
+    for(int b = 0; b < 56; b++){
+        key |= ((index >> b) & 1) << key_bit_position(b);
+    }
+
+    for(int i = 0; i < 8; i++){
+        if(__builtin_popcountll((key >> (8*i)) & 0xFF) % 2 == 0)
+            key |= 1ULL << (8*i);
+    }
+
+    return key;
+}
+
+
+/*
+    DES key -> key index (the parity bits are ignored).
+*/
+uint64_t DES_Key_To_Index(uint64_t key)
+{
+    uint64_t index = 0;
+
+    for(int b = 0; b < 56; b++){
+        index |= ((key >> key_bit_position(b)) & 1) << b;
+    }
+
+    return index;
+}
+
+
+static void value_to_planes(uint64_t value, DES_SLICE_T *planes)
+{
+    DES_SLICE_T zero = {0};
+
+    for(int i = 0; i < 64; i++){
+        planes[i] = zero - ((value >> (63 - i)) & 1);
+    }
+}
+
+
+/*
+    Shared tables: plaintext/ciphertext planes, lane planes and, for each key index bit, the sub-key bits
+    it feeds (found by running the DES key schedule on single-bit keys).
+*/
+static void key_search_init(KEY_SEARCH_T *search, uint64_t plaintext, uint64_t ciphertext)
+{
+    value_to_planes(plaintext, search->plaintext_planes);
+    value_to_planes(ciphertext, search->ciphertext_planes);
+
+    search->lane_bits = 0;
+    while((1 << search->lane_bits) < DES_BITSLICE_BLOCKS){
+        search->lane_bits++;
+    }
+
+    for(int b = 0; b < search->lane_bits; b++){
+        for(int lane = 0; lane < DES_BITSLICE_BLOCKS; lane++){
+            uint64_t bit = 1ULL << (63 - (lane % 64));
+
+            if((lane >> b) & 1)
+                search->lane_planes[b][lane / 64] |= bit;
+            else
+                search->lane_planes[b][lane / 64] &= ~bit;
+        }
+    }
+
+    for(int b = 0; b < 56; b++){
+        DES_KEY_CONTEXT_T context;
+        DES_Init_Key_Context(&context, 1ULL << key_bit_position(b));
+
+        search->use_count[b] = 0;
+        for(int round = 0; round < 16; round++){
+            for(int k = 0; k < 48; k++){
+                if((context.sub_keys[round] >> (47 - k)) & 1){
+                    search->uses[b][search->use_count[b]].round = (uint8_t)round;
+                    search->uses[b][search->use_count[b]].bit = (uint8_t)k;
+                    search->use_count[b]++;
+                }
+            }
+        }
+    }
+}
+
+
+/* key planes of the DES_BITSLICE_BLOCKS keys of a batch */
+static void batch_key(const KEY_SEARCH_T *search, uint64_t batch, DES_BITSLICE_KEY_T *key)
+{
+    DES_SLICE_T zero = {0};
+
+    for(int b = 0; b < 56; b++){
+        DES_SLICE_T plane = (b < search->lane_bits) ? search->lane_planes[b] : zero - ((batch >> (b - search->lane_bits)) & 1);
+
+        for(int u = 0; u < search->use_count[b]; u++){
+            key->key_planes[search->uses[b][u].round][search->uses[b][u].bit] = plane;
+        }
+    }
+}
+
+
+/* key planes: batch -> batch+1, the sub-key bits fed by the changed counter bits are inverted */
+static void batch_key_increment(const KEY_SEARCH_T *search, uint64_t batch, DES_BITSLICE_KEY_T *key)
+{
+    uint64_t changed = batch ^ (batch + 1);
+
+    for(int b = search->lane_bits; (b < 56) && (changed != 0); b++, changed >>= 1){
+        if((changed & 1) == 0)
+            continue;
+
+        for(int u = 0; u < search->use_count[b]; u++){
+            DES_SLICE_T *plane = &key->key_planes[search->uses[b][u].round][search->uses[b][u].bit];
+            *plane = ~*plane;
+        }
+    }
+}
+
+
+/*
+    Lanes of a batch whose output equals the ciphertext; a matching key inside the range ends the search.
+*/
+static void batch_check(KEY_SEARCH_T *search, uint64_t batch, const DES_SLICE_T *planes)
+{
+    DES_SLICE_T mismatch = {0};
+
+    for(int i = 0; i < 64; i++){
+        mismatch |= planes[i] ^ search->ciphertext_planes[i];
+    }
+
+    for(int w = 0; w < DES_BITSLICE_WORDS; w++){
+        uint64_t matches = ~mismatch[w];
+
+        while(matches != 0){
+            int j = __builtin_ctzll(matches);
+            uint64_t index = (batch << search->lane_bits) | (uint64_t)(64*w + 63 - j);
+            matches &= matches - 1;
+
+            if(  (index < search->first_index) || (index >= search->end_index)  )
+                continue;
+
+            pthread_mutex_lock(&search->mutex);
+            if(!search->result->found){
+                search->result->found = 1;
+                search->result->key = DES_Key_From_Index(index);
+            }
+            pthread_mutex_unlock(&search->mutex);
+
+            __atomic_store_n(&search->found, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+
+/* number of keys of the batch inside the searched range */
+static uint64_t batch_keys_in_range(const KEY_SEARCH_T *search, uint64_t batch)
+{
+    uint64_t begin = __max_(batch << search->lane_bits, search->first_index);
+    uint64_t end = __min_((batch + 1) << search->lane_bits, search->end_index);
+
+    return end - begin;
+}
+
+
+static void key_search_task(uint64_t begin, uint64_t end, void *arg)
+{
+    KEY_SEARCH_T *search = (KEY_SEARCH_T*)arg;
+    DES_BITSLICE_KEY_T key;
+    DES_SLICE_T planes[64];
+    uint64_t keys_tested = 0;
+    uint64_t start = monotonic_ns();
+
+    /* thread number: position of the range in the parallel_for() split */
+    int thread = 0;
+    while(  (thread + 1 < search->thread_count) && ((search->batch_count * (thread + 1)) / search->thread_count <= begin)  ){
+        thread++;
+    }
+
+    uint64_t batch = search->first_batch + begin;
+    batch_key(search, batch, &key);
+
+    for(uint64_t n = begin; n < end; n++, batch++){
+        if(__atomic_load_n(&search->found, __ATOMIC_RELAXED))
+            break;
+
+        memcpy(planes, search->plaintext_planes, sizeof(planes));
+        DES_Bitslice_Planes(&key, planes);
+        batch_check(search, batch, planes);
+        keys_tested += batch_keys_in_range(search, batch);
+
+        batch_key_increment(search, batch, &key);
+    }
+
+    double seconds = (double)(monotonic_ns() - start) * 1e-9;
+
+    pthread_mutex_lock(&search->mutex);
+    search->result->keys_tested += keys_tested;
+    search->result->thread_keys_tested[thread] = keys_tested;
+    search->result->thread_keys_per_second[thread] = (seconds > 0) ? (double)keys_tested / seconds : 0.0;
+    pthread_mutex_unlock(&search->mutex);
+
+    memset(&key, 0, sizeof(key));
+}
+
+
+
+/*
+    Search the key mapping plaintext to ciphertext (DES blocks, DES bit 1 = most significant bit) among the
+    key indexes [first_index, first_index + key_count), on thread_count threads (0: one per CPU).
+    The search stops at the first key found. Returns EXIT_FAILURE if the range is invalid.
+*/
+int DES_Key_Search(uint64_t plaintext, uint64_t ciphertext, uint64_t first_index, uint64_t key_count, int thread_count, DES_KEY_SEARCH_RESULT_T *result)
+{
+    const uint64_t index_count = 1ULL << 56;
+
+    if(  (key_count == 0) || (first_index >= index_count) || (key_count > index_count - first_index)  ){
+        printf("DES Error: invalid key range.\n");
+        return EXIT_FAILURE;
+    }
+
+    KEY_SEARCH_T *search = (KEY_SEARCH_T*)calloc(1, sizeof(KEY_SEARCH_T));
+    if(search == NULL){
+        printf("DES Error: memory allocation failed.\n");
+        return EXIT_FAILURE;
+    }
+
+    key_search_init(search, plaintext, ciphertext);
+
+    search->first_index = first_index;
+    search->end_index = first_index + key_count;
+    search->first_batch = first_index >> search->lane_bits;
+    search->batch_count = ((search->end_index - 1) >> search->lane_bits) - search->first_batch + 1;
+
+    /* same thread count as parallel_for() */
+    if(thread_count <= 0){
+        thread_count = get_cpu_count();
+    }
+    thread_count = (int)__min_((uint64_t)__min_(thread_count, DES_KEY_SEARCH_MAX_THREADS), search->batch_count);
+    search->thread_count = thread_count;
+
+    memset(result, 0, sizeof(DES_KEY_SEARCH_RESULT_T));
+    result->thread_count = thread_count;
+    search->result = result;
+    pthread_mutex_init(&search->mutex, NULL);
+
+    uint64_t start = monotonic_ns();
+    parallel_for(search->batch_count, thread_count, key_search_task, search);
+    result->seconds = (double)(monotonic_ns() - start) * 1e-9;
+    result->keys_per_second = (result->seconds > 0) ? (double)result->keys_tested / result->seconds : 0.0;
+
+    pthread_mutex_destroy(&search->mutex);
+    free(search);
+
+    return EXIT_SUCCESS;
+}
+
+
+/*
+    Reproducible load test: search key_count keys ending with the key of the FIPS 46 example (so the whole
+    range is searched and the key must be found), then print the keys/s of each thread and of the machine.
+*/
+void DES_Key_Search_Benchmark(uint64_t key_count, int thread_count)
+{
+    DES_KEY_SEARCH_RESULT_T result;
+    uint64_t last_index = DES_Key_To_Index(DES_KEY_SEARCH_TEST_KEY);
+
+    key_count = __min_(key_count, last_index + 1);
+
+    if(DES_Key_Search(DES_KEY_SEARCH_TEST_PLAINTEXT, DES_KEY_SEARCH_TEST_CIPHERTEXT, last_index + 1 - key_count, key_count, thread_count, &result) != EXIT_SUCCESS)
+        return;
+
+    printf("DES key search: %llu keys, %d threads, %.3f s\n", (unsigned long long)result.keys_tested, result.thread_count, result.seconds);
+    for(int i = 0; i < result.thread_count; i++){
+        printf("    thread %d: %.2f Mkeys/s\n", i, result.thread_keys_per_second[i] * 1e-6);
+    }
+    printf("    total: %.2f Mkeys/s\n", result.keys_per_second * 1e-6);
+    printf("DES key search: %s\n", (result.found && (result.key == DES_KEY_SEARCH_TEST_KEY)) ? "OK" : "FAILED");
+}
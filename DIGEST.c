@@ -0,0 +1,256 @@
+/*
+    Single-pass multi-digest: several hashes (MD5, SHA-256) of one file with a single read of the file.
+
+    The file is read once into a ring of DIGEST_RING_BUFFERS buffers, and each buffer is fed to all the
+    selected engines. With "threaded", every engine runs on its own thread and consumes the buffers in
+    order, read-only; a buffer is filled again once all the engines are done with it, so reading the file
+    overlaps with hashing. Otherwise (or if its thread cannot be started) an engine is updated by the
+    reading thread, right after each read.
+
+    Ring state (protected by the mutex): buffers [consumed, produced) of a worker are ready for it,
+    buffer n being stored at index n % DIGEST_RING_BUFFERS.
+*/
+#include "DIGEST.h"
+#include <pthread.h>
+
+
+#define DIGEST_ENGINE_COUNT         2
+
+
+typedef struct DIGEST_STATE_S DIGEST_STATE_T;
+
+typedef struct {
+    DIGEST_STATE_T *state;
+    int engine;                     // index in digest_engines[]
+    int threaded;                   // 0: updated by the reading thread
+    uint64_t consumed;              // number of buffers hashed
+    pthread_t thread;
+} DIGEST_WORKER_T;
+
+struct DIGEST_STATE_S {
+    MD5_CONTEXT_T md5;
+    SHA256_CONTEXT_T sha256;
+
+    uint8_t *buffers[DIGEST_RING_BUFFERS];
+    size_t sizes[DIGEST_RING_BUFFERS];
+    uint64_t produced;              // number of buffers read
+    int end_of_file;
+
+    DIGEST_WORKER_T workers[DIGEST_ENGINE_COUNT];
+    int worker_count;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t data_ready;      // a buffer was read, or end of file
+    pthread_cond_t space_ready;     // a worker is done with a buffer
+};
+
+
+
+static void md5_update(DIGEST_STATE_T *state, const uint8_t *data, size_t size)
+{
+    MD5_Context_Update(&state->md5, data, size);
+}
+
+static void sha256_update(DIGEST_STATE_T *state, const uint8_t *data, size_t size)
+{
+    SHA256_Context_Update(&state->sha256, data, size);
+}
+
+
+static const struct {
+    int mask;
+    void (*update)(DIGEST_STATE_T *state, const uint8_t *data, size_t size);
+} digest_engines[DIGEST_ENGINE_COUNT] = {
+    {DIGEST_MD5, md5_update},
+    {DIGEST_SHA256, sha256_update}
+};
+
+
+
+static void* Digest_Worker_Thread(void *arg)
+{
+    DIGEST_WORKER_T *worker = (DIGEST_WORKER_T*)arg;
+    DIGEST_STATE_T *state = worker->state;
+
+    pthread_mutex_lock(&state->mutex);
+
+    for(;;){
+        while(  (worker->consumed == state->produced) && !state->end_of_file  ){
+            pthread_cond_wait(&state->data_ready, &state->mutex);
+        }
+
+        if(worker->consumed == state->produced)
+            break;          // end of file, all the buffers hashed
+
+        /* the buffer is not modified before this worker is done with it */
+        int index = (int)(worker->consumed % DIGEST_RING_BUFFERS);
+        pthread_mutex_unlock(&state->mutex);
+
+        digest_engines[worker->engine].update(state, state->buffers[index], state->sizes[index]);
+
+        pthread_mutex_lock(&state->mutex);
+        worker->consumed++;
+        pthread_cond_signal(&state->space_ready);
+    }
+
+    pthread_mutex_unlock(&state->mutex);
+
+    return NULL;
+}
+
+
+/* number of buffers hashed by all the threaded workers (the mutex is held) */
+static uint64_t oldest_consumed(const DIGEST_STATE_T *state)
+{
+    uint64_t oldest = state->produced;
+
+    for(int w = 0; w < state->worker_count; w++){
+        if(state->workers[w].threaded)
+            oldest = __min_(oldest, state->workers[w].consumed);
+    }
+
+    return oldest;
+}
+
+
+/*
+    Read the file once and feed it to the workers. Returns EXIT_FAILURE on a read error.
+*/
+static int digest_read_file(DIGEST_STATE_T *state, FILE *file)
+{
+    int result = EXIT_SUCCESS;
+
+    for(;;){
+        pthread_mutex_lock(&state->mutex);
+        while(state->produced - oldest_consumed(state) >= DIGEST_RING_BUFFERS){
+            pthread_cond_wait(&state->space_ready, &state->mutex);
+        }
+        pthread_mutex_unlock(&state->mutex);
+
+        int index = (int)(state->produced % DIGEST_RING_BUFFERS);
+        size_t n = fread(state->buffers[index], sizeof(uint8_t), DIGEST_BUFFER_SIZE, file);
+
+        if(n == 0){
+            if(ferror(file)){
+                printf("DIGEST Error: cannot read file.\n");
+                result = EXIT_FAILURE;
+            }
+            break;
+        }
+
+        for(int w = 0; w < state->worker_count; w++){
+            if(!state->workers[w].threaded)
+                digest_engines[state->workers[w].engine].update(state, state->buffers[index], n);
+        }
+
+        pthread_mutex_lock(&state->mutex);
+        state->sizes[index] = n;
+        state->produced++;
+        pthread_cond_broadcast(&state->data_ready);
+        pthread_mutex_unlock(&state->mutex);
+    }
+
+    pthread_mutex_lock(&state->mutex);
+    state->end_of_file = 1;
+    pthread_cond_broadcast(&state->data_ready);
+    pthread_mutex_unlock(&state->mutex);
+
+    return result;
+}
+
+
+
+/*
+    Compute the hashes selected by "engines" (DIGEST_MD5 | DIGEST_SHA256) of a file, reading it only once.
+    With threaded = 1, each engine runs on its own thread.
+
+    Return the error status (EXIT_FAILURE or EXIT_SUCCESS)
+*/
+int DIGEST_hash_file(const char* const filename, int engines, int threaded, DIGEST_RESULT_T *result)
+{
+    if(  (engines == 0) || ((engines & ~(DIGEST_MD5 | DIGEST_SHA256)) != 0)  ){
+        printf("DIGEST Error: invalid engines.\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE *file = fopen(filename, "rb");
+    if(file == NULL){
+        printf("DIGEST Error: cannot open file.\n");
+        return EXIT_FAILURE;
+    }
+
+    DIGEST_STATE_T *state = (DIGEST_STATE_T*)calloc(1, sizeof(DIGEST_STATE_T));
+    uint8_t *ring = (uint8_t*)malloc((size_t)DIGEST_RING_BUFFERS * DIGEST_BUFFER_SIZE);
+
+    if(  (state == NULL) || (ring == NULL)  ){
+        printf("DIGEST Error: memory allocation failed.\n");
+        free(state);
+        free(ring);
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    for(int i = 0; i < DIGEST_RING_BUFFERS; i++){
+        state->buffers[i] = &ring[(size_t)i * DIGEST_BUFFER_SIZE];
+    }
+
+    MD5_Context_Init(&state->md5);
+    SHA256_Context_Init(&state->sha256);
+    pthread_mutex_init(&state->mutex, NULL);
+    pthread_cond_init(&state->data_ready, NULL);
+    pthread_cond_init(&state->space_ready, NULL);
+
+    /* one worker per selected engine */
+    for(int e = 0; e < DIGEST_ENGINE_COUNT; e++){
+        if((engines & digest_engines[e].mask) == 0)
+            continue;
+
+        DIGEST_WORKER_T *worker = &state->workers[state->worker_count++];
+        worker->state = state;
+        worker->engine = e;
+        worker->consumed = 0;
+        worker->threaded = threaded && (pthread_create(&worker->thread, NULL, Digest_Worker_Thread, worker) == 0);
+    }
+
+    int status = digest_read_file(state, file);
+
+    for(int w = 0; w < state->worker_count; w++){
+        if(state->workers[w].threaded)
+            pthread_join(state->workers[w].thread, NULL);
+    }
+
+    result->engines = engines;
+    if(engines & DIGEST_MD5)
+        MD5_Context_Final(&state->md5, &result->md5);
+    if(engines & DIGEST_SHA256)
+        SHA256_Context_Final(&state->sha256, &result->sha256);
+
+    pthread_mutex_destroy(&state->mutex);
+    pthread_cond_destroy(&state->data_ready);
+    pthread_cond_destroy(&state->space_ready);
+    free(ring);
+    free(state);
+    fclose(file);
+
+    return status;
+}
+
+
+
+void DIGEST_test(void)
+{
+    DIGEST_RESULT_T result;
+    MD5_HASH_STRUCT md5_hash;
+    SHA256_HASH_STRUCT sha256_hash;
+
+    MD5_hash("plain_data_test.txt", &md5_hash);
+    SHA256_hash("plain_data_test.txt", &sha256_hash);
+
+    for(int threaded = 0; threaded <= 1; threaded++){
+        DIGEST_hash_file("plain_data_test.txt", DIGEST_MD5 | DIGEST_SHA256, threaded, &result);
+
+        int ok = (memcmp(&result.md5, &md5_hash, sizeof(MD5_HASH_STRUCT)) == 0) &&
+                 (memcmp(&result.sha256, &sha256_hash, sizeof(SHA256_HASH_STRUCT)) == 0);
+        printf("Multi-digest MD5 + SHA-256 (%s): %s\n", threaded ? "one thread per engine" : "single thread", ok ? "OK" : "FAILED");
+    }
+}
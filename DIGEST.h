@@ -0,0 +1,34 @@
+#ifndef DIGEST_H_
+#define DIGEST_H_
+
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "helpers.h"
+#include "MD5.h"
+#include "SHA.h"
+
+
+/* hash engines (bit mask) */
+#define DIGEST_MD5                  (1 << 0)
+#define DIGEST_SHA256               (1 << 1)
+
+#define DIGEST_RING_BUFFERS         4           // buffers shared by the reader and the engine threads
+#define DIGEST_BUFFER_SIZE          262144      // size of each buffer (bytes)
+
+
+/*
+    Hashes of one input, for the selected engines.
+*/
+typedef struct {
+    int engines;                    // DIGEST_MD5 | DIGEST_SHA256
+    MD5_HASH_STRUCT md5;
+    SHA256_HASH_STRUCT sha256;
+} DIGEST_RESULT_T;
+
+
+int DIGEST_hash_file(const char* const filename, int engines, int threaded, DIGEST_RESULT_T *result);
+void DIGEST_test(void);
+
+#endif      // DIGEST_H_
@@ -1,10 +1,10 @@
 /*
     MD5 Hashing Algorithm implementation.
 */
-#include "MD5.h"
+#include "MD5_backends.h"
 
 
-static uint8_t shift[64] = {
+const uint8_t MD5_shift[64] = {
     7, 12, 17, 22, 7, 12, 17, 22,
     7, 12, 17, 22, 7, 12, 17, 22,
     5, 9, 14, 20, 5, 9, 14, 20,
@@ -16,7 +16,7 @@ static uint8_t shift[64] = {
 };
 
 
-static uint32_t K[64] = 
+const uint32_t MD5_K[64] =
 {
     0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
     0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821, 
@@ -30,14 +30,24 @@ static uint32_t K[64] =
 
 
 
+/* 32-bits little-endian word at any address (compiled to a single load) */
+static inline uint32_t load_32(const uint8_t *data)
+{
+    uint32_t word;
+    memcpy(&word, data, sizeof(uint32_t));
+    return word;
+}
+
+
 /*
     block = 512-bits data block (64 * 8-bits words)
     hash = 128-bits data (4 * 32-bits words)
 
     - md5_hash.h0 is the most significant word
     - all values are expressed in little-endian format
+    - block can be anywhere in memory (no alignment required)
 */
-static void MD5_Process_Block(uint8_t *block, MD5_HASH_STRUCT *md5_hash)
+static void MD5_Process_Block_Reference(const uint8_t *block, MD5_HASH_STRUCT *md5_hash)
 {
     uint32_t a = md5_hash->h0;
     uint32_t b = md5_hash->h1;
@@ -67,11 +77,11 @@ static void MD5_Process_Block(uint8_t *block, MD5_HASH_STRUCT *md5_hash)
         }
 
 
-        f = f + a + K[i] + *(uint32_t*)&block[4*g];
+        f = f + a + MD5_K[i] + load_32(&block[4*g]);
         a = d;
         d = c;
         c = b;
-        b += left_circular_shift_32(f, shift[i]);
+        b += left_circular_shift_32(f, MD5_shift[i]);
     }
 
     md5_hash->h0 += a;
@@ -82,72 +92,157 @@ static void MD5_Process_Block(uint8_t *block, MD5_HASH_STRUCT *md5_hash)
 
 
 /*
-    Compute the MD5 hash of a given file.
-
-    - md5_hash.h0 is the most significant word.
+    Unrolled compression function: the round functions, constants, message indexes and rotations of the
+    64 steps are fixed at compile time (no round selection, no index computation).
 */
-int MD5_hash(const char* const filename, MD5_HASH_STRUCT *md5_hash)
+static void MD5_Process_Block_Unrolled(const uint8_t *block, MD5_HASH_STRUCT *md5_hash)
 {
-    FILE *file = fopen(filename, "rb");
-    int filesize = get_filesize(filename);      // filesize (in bytes)
+    uint32_t M[16];
 
-    if((file == NULL) || (filesize == -1)){
-        printf("MD5 Error: cannot open file.\n");
-        return EXIT_FAILURE;
+    for(int i = 0; i < 16; i++){
+        M[i] = load_32(&block[4*i]);
     }
 
+    uint32_t a = md5_hash->h0;
+    uint32_t b = md5_hash->h1;
+    uint32_t c = md5_hash->h2;
+    uint32_t d = md5_hash->h3;
+
+    MD5_64_STEPS(M);
+
+    md5_hash->h0 += a;
+    md5_hash->h1 += b;
+    md5_hash->h2 += c;
+    md5_hash->h3 += d;
+}
+
 
-    /* MD5 operates on 512-bits (64 * 8-bits) wide blocks
-    *  Filesize (bits) = 512*q + r
-    *  q = number of 512-bits (64 bytes) wide blocks; r = remainder (bytes)
-    */
-    int r = filesize % (512/8);
-    int q = filesize / (512/8);
+static void MD5_Process_Block(const uint8_t *block, MD5_HASH_STRUCT *md5_hash)
+{
+    if(MD5_ENGINE == MD5_ENGINE_UNROLLED)
+        MD5_Process_Block_Unrolled(block, md5_hash);
+    else
+        MD5_Process_Block_Reference(block, md5_hash);
+}
 
 
+/*
+    Start a new hash.
+*/
+void MD5_Context_Init(MD5_CONTEXT_T *context)
+{
     /* hash initialization */
-    md5_hash->h0 = 0x67452301;
-    md5_hash->h1 = 0xEFCDAB89;
-    md5_hash->h2 = 0x98BADCFE;
-    md5_hash->h3 = 0x10325476;
+    context->hash.h0 = 0x67452301;
+    context->hash.h1 = 0xEFCDAB89;
+    context->hash.h2 = 0x98BADCFE;
+    context->hash.h3 = 0x10325476;
 
+    context->length = 0;
+    context->buffer_size = 0;
+}
 
-    uint8_t block[64];     // 512-bits block
+
+/*
+    Hash "size" more bytes. The full blocks of data are processed in place; only the bytes of a partial
+    block are copied into the context.
+*/
+void MD5_Context_Update(MD5_CONTEXT_T *context, const uint8_t *data, size_t size)
+{
+    context->length += size;
+
+    /* complete the partial block first */
+    if(context->buffer_size > 0){
+        size_t n = __min_(64 - context->buffer_size, size);
+
+        memcpy(&context->buffer[context->buffer_size], data, n);
+        context->buffer_size += n;
+        data += n;
+        size -= n;
+
+        if(context->buffer_size < 64)
+            return;
+
+        MD5_Process_Block(context->buffer, &context->hash);
+        context->buffer_size = 0;
+    }
 
     /* process each 512-bits block */
-    for(int i = 0; i < q; i++){
-        fread(&block, sizeof(uint8_t), 64, file);
-        MD5_Process_Block(block, md5_hash);
+    for(; size >= 64; data += 64, size -= 64){
+        MD5_Process_Block(data, &context->hash);
     }
 
-    /* process last block (+ padding) */
-    uint8_t last_block[64];     // 512-bits last block
-    fread(&last_block, sizeof(uint8_t), r, file);
+    memcpy(context->buffer, data, size);
+    context->buffer_size = size;
+}
+
+
+/*
+    Padding of the last block and hash result. The context must be initialized again before being reused.
+
+    - md5_hash.h0 is the most significant word.
+*/
+void MD5_Context_Final(MD5_CONTEXT_T *context, MD5_HASH_STRUCT *md5_hash)
+{
+    uint8_t *last_block = context->buffer;      // 512-bits last block
+    size_t r = context->buffer_size;
+    uint64_t bit_length = context->length * 8;
+
     last_block[r] = 0x80;           // append a "1" bit
 
-    if((r+1) <= 64-8)           // enough space to put the file length (64-bits = 8 bytes)
+    if((r+1) <= 64-8)           // enough space to put the message length (64-bits = 8 bytes)
     {
-        for(int i = r+1; i < 64-8; i++){
-            last_block[i] = 0;      // 0-padding
-        }
+        memset(&last_block[r+1], 0, 64-8 - (r+1));      // 0-padding
     }
     else        // not enough space, we need a second block
     {
-        for(int i = r+1; i < 64; i++){
-            last_block[i] = 0;          // 0-padding
-        }
-        MD5_Process_Block(last_block, md5_hash);
+        memset(&last_block[r+1], 0, 64 - (r+1));        // 0-padding
+        MD5_Process_Block(last_block, &context->hash);
 
         /* add a second "last block" */
-        for(int i = 0; i < 64-8; i++){
-            last_block[i] = 0;          // 0-padding
-        }
+        memset(last_block, 0, 64-8);
     }
 
-    /* file length */
-    *(uint64_t*)&last_block[64-8] = (uint64_t)filesize * 8;
-    MD5_Process_Block(last_block, md5_hash);            // process the very last block
+    /* message length */
+    memcpy(&last_block[64-8], &bit_length, sizeof(uint64_t));
+    MD5_Process_Block(last_block, &context->hash);            // process the very last block
+
+    *md5_hash = context->hash;
+
+    memset(context, 0, sizeof(MD5_CONTEXT_T));
+}
+
+
+/*
+    Compute the MD5 hash of a given file.
+
+    - md5_hash.h0 is the most significant word.
+*/
+int MD5_hash(const char* const filename, MD5_HASH_STRUCT *md5_hash)
+{
+    FILE *file = fopen(filename, "rb");
 
+    if(file == NULL){
+        printf("MD5 Error: cannot open file.\n");
+        return EXIT_FAILURE;
+    }
+
+    MD5_CONTEXT_T context;
+    uint8_t *chunk = (uint8_t*)malloc(MD5_FILE_CHUNK_SIZE);
+    size_t n;
+
+    if(chunk == NULL){
+        printf("MD5 Error: memory allocation failed.\n");
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    MD5_Context_Init(&context);
+    while((n = fread(chunk, sizeof(uint8_t), MD5_FILE_CHUNK_SIZE, file)) > 0){
+        MD5_Context_Update(&context, chunk, n);
+    }
+    MD5_Context_Final(&context, md5_hash);
+
+    free(chunk);
     fclose(file);
 
     return EXIT_SUCCESS;
@@ -184,4 +279,50 @@ void MD5_test(void)
 
     printf("MD5 hash = ");
     MD5_Print_Hash(&md5_hash);
+
+    /* multi-buffer hashing: same hashes as one message at a time */
+    uint8_t data[1000];
+    const uint8_t *buffers[10];
+    size_t sizes[10];
+    MD5_HASH_STRUCT batch_hashes[10];
+    int errors;
+
+    for(int i = 0; i < 1000; i++){
+        data[i] = (uint8_t)(i * 7);
+    }
+    for(int i = 0; i < 10; i++){
+        buffers[i] = &data[3*i];
+        sizes[i] = 97 * i;
+    }
+
+    /* every engine supported by the CPU */
+    const MD5_BATCH_ENGINE_ID_T engines[] = {MD5_BATCH_ENGINE_SCALAR, MD5_BATCH_ENGINE_SSE2, MD5_BATCH_ENGINE_AVX2};
+    for(int e = 0; e < (int)(sizeof(engines)/sizeof(engines[0])); e++){
+        if(MD5_Set_Batch_Engine(engines[e]) != EXIT_SUCCESS)
+            continue;
+
+        errors = 0;
+        MD5_hash_batch(buffers, sizes, 10, batch_hashes);
+        for(int i = 0; i < 10; i++){
+            MD5_CONTEXT_T context;
+            MD5_Context_Init(&context);
+            MD5_Context_Update(&context, buffers[i], sizes[i]);
+            MD5_Context_Final(&context, &md5_hash);
+            errors += (memcmp(&md5_hash, &batch_hashes[i], sizeof(MD5_HASH_STRUCT)) != 0);
+        }
+        printf("MD5 multi-buffer batch (%s): %s\n", MD5_Get_Batch_Engine_Name(), (errors == 0) ? "OK" : "FAILED");
+    }
+    MD5_Set_Batch_Engine(MD5_BATCH_ENGINE_AUTO);
+
+    /* unrolled compression function: same states as the reference one on random blocks */
+    uint32_t random_blocks[16 * 64];
+    MD5_HASH_STRUCT reference_hash = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476};
+    MD5_HASH_STRUCT unrolled_hash = reference_hash;
+
+    random_array(random_blocks, 16 * 64);
+    for(int i = 0; i < 64; i++){
+        MD5_Process_Block_Reference((const uint8_t*)&random_blocks[16*i], &reference_hash);
+        MD5_Process_Block_Unrolled((const uint8_t*)&random_blocks[16*i], &unrolled_hash);
+    }
+    printf("MD5 unrolled compression: %s\n", (memcmp(&reference_hash, &unrolled_hash, sizeof(MD5_HASH_STRUCT)) == 0) ? "OK" : "FAILED");
 }
\ No newline at end of file
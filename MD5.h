@@ -8,6 +8,23 @@
 #include "helpers.h"
 
 
+#define MD5_ENGINE_REFERENCE    0           // generic loop (reference path)
+#define MD5_ENGINE_UNROLLED     1           // 64 steps unrolled, constants baked in
+#define MD5_ENGINE              MD5_ENGINE_UNROLLED     // select the compression function
+
+#define MD5_FILE_CHUNK_SIZE     65536       // number of bytes read at once by MD5_hash()
+#define MD5_BATCH_MAX_LANES     8           // multi-buffer hashing: maximum number of messages in flight (AVX2)
+
+
+/* multi-buffer engines, selected at run-time (MD5_BATCH_ENGINE_AUTO picks the fastest one supported by the CPU) */
+typedef enum {
+    MD5_BATCH_ENGINE_AUTO = 0,
+    MD5_BATCH_ENGINE_SCALAR,            // one message at a time
+    MD5_BATCH_ENGINE_SSE2,              // 4 messages per vector
+    MD5_BATCH_ENGINE_AVX2               // 8 messages per vector
+} MD5_BATCH_ENGINE_ID_T;
+
+
 /*
     MD5 hash structure.
 */
@@ -19,7 +36,26 @@ typedef struct {
 } MD5_HASH_STRUCT;
 
 
+/*
+    Incremental hashing context (MD5_Context_Init(), MD5_Context_Update(), MD5_Context_Final()): the hash of
+    the full blocks already processed, and the bytes of the current partial block.
+*/
+typedef struct {
+    MD5_HASH_STRUCT hash;
+    uint64_t length;                // total number of bytes hashed
+    uint8_t buffer[64];             // partial block
+    size_t buffer_size;
+} MD5_CONTEXT_T;
+
+
+void MD5_Context_Init(MD5_CONTEXT_T *context);
+void MD5_Context_Update(MD5_CONTEXT_T *context, const uint8_t *data, size_t size);
+void MD5_Context_Final(MD5_CONTEXT_T *context, MD5_HASH_STRUCT *md5_hash);
+
 int MD5_hash(const char* const filename, MD5_HASH_STRUCT *md5_hash);
+int MD5_hash_batch(const uint8_t *const *buffers, const size_t *sizes, int count, MD5_HASH_STRUCT *md5_hashes);
+int MD5_Set_Batch_Engine(MD5_BATCH_ENGINE_ID_T engine_id);
+const char* MD5_Get_Batch_Engine_Name(void);
 void MD5_Print_Hash(MD5_HASH_STRUCT *md5_hash);
 void MD5_test(void);
 
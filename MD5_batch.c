@@ -0,0 +1,355 @@
+/*
+    Multi-buffer MD5: hash of many independent messages (cache keys, ETags of small objects).
+
+    MD5 is serial inside a message, but the 32-bits operations of 4 (SSE2) or 8 (AVX2) messages can run
+    side by side, one message per vector lane. A lane scheduler feeds the engine one block per lane: the
+    full blocks are read in place from the caller buffers, the last one or two blocks (padding and length)
+    are built per lane. A lane is refilled with the next message as soon as its message is finished.
+*/
+#include "MD5_backends.h"
+
+
+typedef struct {
+    const char *name;
+    int lanes;
+    int (*is_supported)(void);
+    /* one block per lane: state[word][lane] */
+    void (*process_blocks)(uint32_t state[4][MD5_BATCH_MAX_LANES], const uint8_t *const *blocks);
+} MD5_BATCH_ENGINE_T;
+
+typedef struct {
+    int message;                    // index of the message, -1: idle lane
+    const uint8_t *data;            // next full block of the message
+    size_t full_blocks;             // full blocks left in data
+    uint8_t tail[128];              // last partial block + padding + length (1 or 2 blocks)
+    int tail_blocks;
+    int tail_index;                 // next tail block
+} MD5_LANE_T;
+
+
+
+#if MD5_X86_ENGINES
+
+#include <immintrin.h>
+
+
+#define MD5_SSE2_TARGET         __attribute__((target("sse2")))
+#define MD5_AVX2_TARGET         __attribute__((target("avx2")))
+
+typedef uint32_t MD5_V4_T __attribute__((vector_size(16)));
+typedef uint32_t MD5_V8_T __attribute__((vector_size(32)));
+
+
+static int SSE2_Is_Supported(void)
+{
+    return cpu_has_feature(CPU_FEATURE_SSE2);
+}
+
+static int AVX2_Is_Supported(void)
+{
+    return cpu_has_feature(CPU_FEATURE_AVX2);
+}
+
+
+MD5_SSE2_TARGET static void SSE2_Process_Blocks(uint32_t state[4][MD5_BATCH_MAX_LANES], const uint8_t *const *blocks)
+{
+    MD5_V4_T a, b, c, d, m[16];
+
+    memcpy(&a, state[0], sizeof(a));
+    memcpy(&b, state[1], sizeof(b));
+    memcpy(&c, state[2], sizeof(c));
+    memcpy(&d, state[3], sizeof(d));
+    MD5_V4_T a0 = a, b0 = b, c0 = c, d0 = d;
+
+    /* message words: 4x4 transpositions of words 4q..4q+3 of the 4 blocks */
+    for(int q = 0; q < 4; q++){
+        __m128i r0 = _mm_loadu_si128((const __m128i*)&blocks[0][16*q]);
+        __m128i r1 = _mm_loadu_si128((const __m128i*)&blocks[1][16*q]);
+        __m128i r2 = _mm_loadu_si128((const __m128i*)&blocks[2][16*q]);
+        __m128i r3 = _mm_loadu_si128((const __m128i*)&blocks[3][16*q]);
+
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1), t1 = _mm_unpackhi_epi32(r0, r1);
+        __m128i t2 = _mm_unpacklo_epi32(r2, r3), t3 = _mm_unpackhi_epi32(r2, r3);
+
+        m[4*q + 0] = (MD5_V4_T)_mm_unpacklo_epi64(t0, t2);
+        m[4*q + 1] = (MD5_V4_T)_mm_unpackhi_epi64(t0, t2);
+        m[4*q + 2] = (MD5_V4_T)_mm_unpacklo_epi64(t1, t3);
+        m[4*q + 3] = (MD5_V4_T)_mm_unpackhi_epi64(t1, t3);
+    }
+
+    MD5_64_STEPS(m);          // one message per lane
+
+    a += a0;
+    b += b0;
+    c += c0;
+    d += d0;
+    memcpy(state[0], &a, sizeof(a));
+    memcpy(state[1], &b, sizeof(b));
+    memcpy(state[2], &c, sizeof(c));
+    memcpy(state[3], &d, sizeof(d));
+}
+
+
+MD5_AVX2_TARGET static void AVX2_Process_Blocks(uint32_t state[4][MD5_BATCH_MAX_LANES], const uint8_t *const *blocks)
+{
+    MD5_V8_T a, b, c, d, m[16];
+
+    memcpy(&a, state[0], sizeof(a));
+    memcpy(&b, state[1], sizeof(b));
+    memcpy(&c, state[2], sizeof(c));
+    memcpy(&d, state[3], sizeof(d));
+    MD5_V8_T a0 = a, b0 = b, c0 = c, d0 = d;
+
+    /* message words: 8x8 transpositions of words 0..7 and 8..15 of the 8 blocks */
+    for(int half = 0; half < 2; half++){
+        __m256i r0 = _mm256_loadu_si256((const __m256i*)&blocks[0][32*half]);
+        __m256i r1 = _mm256_loadu_si256((const __m256i*)&blocks[1][32*half]);
+        __m256i r2 = _mm256_loadu_si256((const __m256i*)&blocks[2][32*half]);
+        __m256i r3 = _mm256_loadu_si256((const __m256i*)&blocks[3][32*half]);
+        __m256i r4 = _mm256_loadu_si256((const __m256i*)&blocks[4][32*half]);
+        __m256i r5 = _mm256_loadu_si256((const __m256i*)&blocks[5][32*half]);
+        __m256i r6 = _mm256_loadu_si256((const __m256i*)&blocks[6][32*half]);
+        __m256i r7 = _mm256_loadu_si256((const __m256i*)&blocks[7][32*half]);
+
+        __m256i t0 = _mm256_unpacklo_epi32(r0, r1), t1 = _mm256_unpackhi_epi32(r0, r1);
+        __m256i t2 = _mm256_unpacklo_epi32(r2, r3), t3 = _mm256_unpackhi_epi32(r2, r3);
+        __m256i t4 = _mm256_unpacklo_epi32(r4, r5), t5 = _mm256_unpackhi_epi32(r4, r5);
+        __m256i t6 = _mm256_unpacklo_epi32(r6, r7), t7 = _mm256_unpackhi_epi32(r6, r7);
+
+        __m256i u0 = _mm256_unpacklo_epi64(t0, t2), u1 = _mm256_unpackhi_epi64(t0, t2);
+        __m256i u2 = _mm256_unpacklo_epi64(t1, t3), u3 = _mm256_unpackhi_epi64(t1, t3);
+        __m256i u4 = _mm256_unpacklo_epi64(t4, t6), u5 = _mm256_unpackhi_epi64(t4, t6);
+        __m256i u6 = _mm256_unpacklo_epi64(t5, t7), u7 = _mm256_unpackhi_epi64(t5, t7);
+
+        MD5_V8_T *w = &m[8*half];
+        w[0] = (MD5_V8_T)_mm256_permute2x128_si256(u0, u4, 0x20);
+        w[1] = (MD5_V8_T)_mm256_permute2x128_si256(u1, u5, 0x20);
+        w[2] = (MD5_V8_T)_mm256_permute2x128_si256(u2, u6, 0x20);
+        w[3] = (MD5_V8_T)_mm256_permute2x128_si256(u3, u7, 0x20);
+        w[4] = (MD5_V8_T)_mm256_permute2x128_si256(u0, u4, 0x31);
+        w[5] = (MD5_V8_T)_mm256_permute2x128_si256(u1, u5, 0x31);
+        w[6] = (MD5_V8_T)_mm256_permute2x128_si256(u2, u6, 0x31);
+        w[7] = (MD5_V8_T)_mm256_permute2x128_si256(u3, u7, 0x31);
+    }
+
+    MD5_64_STEPS(m);          // one message per lane
+
+    a += a0;
+    b += b0;
+    c += c0;
+    d += d0;
+    memcpy(state[0], &a, sizeof(a));
+    memcpy(state[1], &b, sizeof(b));
+    memcpy(state[2], &c, sizeof(c));
+    memcpy(state[3], &d, sizeof(d));
+}
+
+
+static const MD5_BATCH_ENGINE_T MD5_Engine_AVX2 = {
+    .name = "AVX2 (8 lanes)",
+    .lanes = 8,
+    .is_supported = AVX2_Is_Supported,
+    .process_blocks = AVX2_Process_Blocks
+};
+
+static const MD5_BATCH_ENGINE_T MD5_Engine_SSE2 = {
+    .name = "SSE2 (4 lanes)",
+    .lanes = 4,
+    .is_supported = SSE2_Is_Supported,
+    .process_blocks = SSE2_Process_Blocks
+};
+
+#endif      // MD5_X86_ENGINES
+
+
+
+/*
+    Engine selection.
+    The engine is chosen once (on the first batch, from the CPUID feature flags) unless MD5_Set_Batch_Engine()
+    is called explicitly. NULL: the messages are hashed one by one.
+*/
+static const MD5_BATCH_ENGINE_T *md5_batch_engine = NULL;
+static int md5_batch_engine_selected = 0;
+
+static int get_engine_by_id(MD5_BATCH_ENGINE_ID_T engine_id, const MD5_BATCH_ENGINE_T **engine)
+{
+    switch(engine_id)
+    {
+        case MD5_BATCH_ENGINE_SCALAR: *engine = NULL; return EXIT_SUCCESS;
+#if MD5_X86_ENGINES
+        case MD5_BATCH_ENGINE_SSE2: *engine = &MD5_Engine_SSE2; return EXIT_SUCCESS;
+        case MD5_BATCH_ENGINE_AVX2: *engine = &MD5_Engine_AVX2; return EXIT_SUCCESS;
+#endif
+        default: return EXIT_FAILURE;
+    }
+}
+
+
+/*
+    Select the engine used by MD5_hash_batch() (MD5_BATCH_ENGINE_AUTO: the fastest one supported by the CPU).
+
+    Return EXIT_FAILURE if the engine is not supported by this CPU (the current engine is kept).
+*/
+int MD5_Set_Batch_Engine(MD5_BATCH_ENGINE_ID_T engine_id)
+{
+    if(engine_id == MD5_BATCH_ENGINE_AUTO){
+        MD5_BATCH_ENGINE_ID_T candidates[] = {MD5_BATCH_ENGINE_AVX2, MD5_BATCH_ENGINE_SSE2, MD5_BATCH_ENGINE_SCALAR};
+
+        for(int i = 0; i < (int)(sizeof(candidates)/sizeof(candidates[0])); i++){
+            if(MD5_Set_Batch_Engine(candidates[i]) == EXIT_SUCCESS){
+                return EXIT_SUCCESS;
+            }
+        }
+        return EXIT_FAILURE;
+    }
+
+    const MD5_BATCH_ENGINE_T *engine;
+    if(  (get_engine_by_id(engine_id, &engine) != EXIT_SUCCESS) || ((engine != NULL) && (engine->is_supported() == 0))  ){
+        return EXIT_FAILURE;
+    }
+
+    md5_batch_engine = engine;
+    md5_batch_engine_selected = 1;
+    return EXIT_SUCCESS;
+}
+
+
+static const MD5_BATCH_ENGINE_T* MD5_Get_Batch_Engine(void)
+{
+    if(md5_batch_engine_selected == 0){
+        MD5_Set_Batch_Engine(MD5_BATCH_ENGINE_AUTO);
+    }
+    return md5_batch_engine;
+}
+
+
+const char* MD5_Get_Batch_Engine_Name(void)
+{
+    const MD5_BATCH_ENGINE_T *engine = MD5_Get_Batch_Engine();
+
+    return (engine != NULL) ? engine->name : "scalar";
+}
+
+
+
+/*
+    Start hashing a message in a lane: initial hash, and the padded tail of the message.
+*/
+static void lane_start(MD5_LANE_T *lane, uint32_t state[4][MD5_BATCH_MAX_LANES], int l, int message, const uint8_t *data, size_t size)
+{
+    size_t r = size % 64;
+    uint64_t bit_length = (uint64_t)size * 8;
+
+    lane->message = message;
+    lane->data = data;
+    lane->full_blocks = size / 64;
+    lane->tail_blocks = ((r+1) <= 64-8) ? 1 : 2;
+    lane->tail_index = 0;
+
+    memset(lane->tail, 0, sizeof(lane->tail));
+    if(r > 0)
+        memcpy(lane->tail, &data[size - r], r);
+    lane->tail[r] = 0x80;           // append a "1" bit
+    memcpy(&lane->tail[64*lane->tail_blocks - 8], &bit_length, sizeof(uint64_t));
+
+    state[0][l] = 0x67452301;
+    state[1][l] = 0xEFCDAB89;
+    state[2][l] = 0x98BADCFE;
+    state[3][l] = 0x10325476;
+}
+
+
+static const uint8_t* lane_next_block(MD5_LANE_T *lane)
+{
+    if(lane->full_blocks > 0){
+        const uint8_t *block = lane->data;
+        lane->data += 64;
+        lane->full_blocks--;
+        return block;
+    }
+
+    return &lane->tail[64 * lane->tail_index++];
+}
+
+
+static int lane_finished(const MD5_LANE_T *lane)
+{
+    return (lane->full_blocks == 0) && (lane->tail_index == lane->tail_blocks);
+}
+
+
+
+/*
+    MD5 hash of "count" buffers: md5_hashes[i] = MD5 of buffers[i] (sizes[i] bytes), the same value as
+    MD5_Context_Init(), MD5_Context_Update(), MD5_Context_Final() on this buffer.
+*/
+int MD5_hash_batch(const uint8_t *const *buffers, const size_t *sizes, int count, MD5_HASH_STRUCT *md5_hashes)
+{
+    const MD5_BATCH_ENGINE_T *engine = MD5_Get_Batch_Engine();
+
+    for(int i = 0; i < count; i++){
+        if(  (buffers[i] == NULL) && (sizes[i] > 0)  ){
+            printf("MD5 Error: invalid buffer.\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(engine == NULL){
+        for(int i = 0; i < count; i++){
+            MD5_CONTEXT_T context;
+            MD5_Context_Init(&context);
+            MD5_Context_Update(&context, buffers[i], sizes[i]);
+            MD5_Context_Final(&context, &md5_hashes[i]);
+        }
+        return EXIT_SUCCESS;
+    }
+
+    MD5_LANE_T lanes[MD5_BATCH_MAX_LANES];
+    uint32_t state[4][MD5_BATCH_MAX_LANES];
+    const uint8_t *blocks[MD5_BATCH_MAX_LANES];
+    static const uint8_t idle_block[64] = {0};      // input of the idle lanes (result ignored)
+    int next_message = 0;
+    int active = 0;
+
+    for(int l = 0; l < engine->lanes; l++){
+        if(next_message < count){
+            lane_start(&lanes[l], state, l, next_message, buffers[next_message], sizes[next_message]);
+            next_message++;
+            active++;
+        }
+        else{
+            lanes[l].message = -1;
+        }
+    }
+
+    while(active > 0){
+        for(int l = 0; l < engine->lanes; l++){
+            blocks[l] = (lanes[l].message >= 0) ? lane_next_block(&lanes[l]) : idle_block;
+        }
+
+        engine->process_blocks(state, blocks);
+
+        for(int l = 0; l < engine->lanes; l++){
+            if(  (lanes[l].message < 0) || !lane_finished(&lanes[l])  )
+                continue;
+
+            MD5_HASH_STRUCT *md5_hash = &md5_hashes[lanes[l].message];
+            md5_hash->h0 = state[0][l];
+            md5_hash->h1 = state[1][l];
+            md5_hash->h2 = state[2][l];
+            md5_hash->h3 = state[3][l];
+
+            /* refill the lane */
+            if(next_message < count){
+                lane_start(&lanes[l], state, l, next_message, buffers[next_message], sizes[next_message]);
+                next_message++;
+            }
+            else{
+                lanes[l].message = -1;
+                active--;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
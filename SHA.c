@@ -1,11 +1,11 @@
 /*
     SHA hashing algorithm implementations.
 */
-#include "SHA.h"
+#include "SHA_backends.h"
 
 
 
-static uint32_t K[64] = {
+const uint32_t SHA256_K[64] = {
     0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
     0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
     0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
@@ -24,14 +24,16 @@ static uint32_t K[64] = {
     - sha256_hash.h0 is the most significant word
     - in the SHA algorithm, all values are processed in big-endian format
 */
-static void SHA256_Process_Block(uint8_t* M, SHA256_HASH_STRUCT *sha256_hash)
+static void SHA256_Process_Block_Reference(const uint8_t* M, SHA256_HASH_STRUCT *sha256_hash)
 {
     uint32_t W[64];
 
     for(int i = 0; i < 64; i += 1){
         if(i <= 15){
-            /* the value is expressed in big-endian format */
-            W[i] = switch_endianness_32(*(uint32_t*)&M[4*i]);
+            /* the value is expressed in big-endian format (M can be anywhere in memory) */
+            uint32_t word;
+            memcpy(&word, &M[4*i], sizeof(uint32_t));
+            W[i] = switch_endianness_32(word);
         }
         else{
             W[i] = SHA256_sigma1(W[i-2]) + W[i-7] + SHA256_sigma0(W[i-15]) + W[i-16];
@@ -49,7 +51,7 @@ static void SHA256_Process_Block(uint8_t* M, SHA256_HASH_STRUCT *sha256_hash)
     h = sha256_hash->h7;
 
     for(int i = 0; i < 64; i++){
-        uint32_t T1 = h + SHA256_SIGMA1(e) + SHA256_Ch(e,f,g) + K[i] + W[i];
+        uint32_t T1 = h + SHA256_SIGMA1(e) + SHA256_Ch(e,f,g) + SHA256_K[i] + W[i];
         uint32_t T2 = SHA256_SIGMA0(a) + SHA256_Maj(a,b,c);
         h = g;
         g = f;
@@ -72,88 +74,365 @@ static void SHA256_Process_Block(uint8_t* M, SHA256_HASH_STRUCT *sha256_hash)
 }
 
 
+static inline uint32_t rotr_32(uint32_t x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+
+/*
+    Unrolled compression function: constants and message indexes fixed at compile time, the working
+    variables renamed from one round to the next instead of being shifted. The message schedule is
+    computed in a rolling window of 16 words: W[i & 15] holds W[i-16] until it is replaced by W[i].
+*/
+#define SHA256_SCHEDULE(i)                                                                                  \
+    (W[(i) & 15] += SHA256_sigma1(W[((i) - 2) & 15]) + W[((i) - 7) & 15] + SHA256_sigma0(W[((i) - 15) & 15]))
+
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, k, w)                                                          \
+    do {                                                                                                    \
+        uint32_t T1 = h + rotr_32(rotr_32(rotr_32(e, 14) ^ e, 5) ^ e, 6) + (g ^ (e & (f ^ g))) + (k) + (w); \
+        d += T1;                                                                                            \
+        h = T1 + rotr_32(rotr_32(rotr_32(a, 9) ^ a, 11) ^ a, 2) + ((a & b) | (c & (a | b)));                \
+    } while(0)
+
+static void SHA256_Process_Block_Unrolled(const uint8_t* M, SHA256_HASH_STRUCT *sha256_hash)
+{
+    uint32_t W[16];
+
+    for(int i = 0; i < 16; i++){
+        uint32_t word;
+        memcpy(&word, &M[4*i], sizeof(uint32_t));
+        W[i] = __builtin_bswap32(word);         // big-endian words
+    }
+
+    uint32_t a = sha256_hash->h0;
+    uint32_t b = sha256_hash->h1;
+    uint32_t c = sha256_hash->h2;
+    uint32_t d = sha256_hash->h3;
+    uint32_t e = sha256_hash->h4;
+    uint32_t f = sha256_hash->h5;
+    uint32_t g = sha256_hash->h6;
+    uint32_t h = sha256_hash->h7;
+
+    SHA256_ROUND(a, b, c, d, e, f, g, h, 0x428a2f98, W[0]);
+    SHA256_ROUND(h, a, b, c, d, e, f, g, 0x71374491, W[1]);
+    SHA256_ROUND(g, h, a, b, c, d, e, f, 0xb5c0fbcf, W[2]);
+    SHA256_ROUND(f, g, h, a, b, c, d, e, 0xe9b5dba5, W[3]);
+    SHA256_ROUND(e, f, g, h, a, b, c, d, 0x3956c25b, W[4]);
+    SHA256_ROUND(d, e, f, g, h, a, b, c, 0x59f111f1, W[5]);
+    SHA256_ROUND(c, d, e, f, g, h, a, b, 0x923f82a4, W[6]);
+    SHA256_ROUND(b, c, d, e, f, g, h, a, 0xab1c5ed5, W[7]);
+
+    SHA256_ROUND(a, b, c, d, e, f, g, h, 0xd807aa98, W[8]);
+    SHA256_ROUND(h, a, b, c, d, e, f, g, 0x12835b01, W[9]);
+    SHA256_ROUND(g, h, a, b, c, d, e, f, 0x243185be, W[10]);
+    SHA256_ROUND(f, g, h, a, b, c, d, e, 0x550c7dc3, W[11]);
+    SHA256_ROUND(e, f, g, h, a, b, c, d, 0x72be5d74, W[12]);
+    SHA256_ROUND(d, e, f, g, h, a, b, c, 0x80deb1fe, W[13]);
+    SHA256_ROUND(c, d, e, f, g, h, a, b, 0x9bdc06a7, W[14]);
+    SHA256_ROUND(b, c, d, e, f, g, h, a, 0xc19bf174, W[15]);
+
+    SHA256_ROUND(a, b, c, d, e, f, g, h, 0xe49b69c1, SHA256_SCHEDULE(16));
+    SHA256_ROUND(h, a, b, c, d, e, f, g, 0xefbe4786, SHA256_SCHEDULE(17));
+    SHA256_ROUND(g, h, a, b, c, d, e, f, 0x0fc19dc6, SHA256_SCHEDULE(18));
+    SHA256_ROUND(f, g, h, a, b, c, d, e, 0x240ca1cc, SHA256_SCHEDULE(19));
+    SHA256_ROUND(e, f, g, h, a, b, c, d, 0x2de92c6f, SHA256_SCHEDULE(20));
+    SHA256_ROUND(d, e, f, g, h, a, b, c, 0x4a7484aa, SHA256_SCHEDULE(21));
+    SHA256_ROUND(c, d, e, f, g, h, a, b, 0x5cb0a9dc, SHA256_SCHEDULE(22));
+    SHA256_ROUND(b, c, d, e, f, g, h, a, 0x76f988da, SHA256_SCHEDULE(23));
+
+    SHA256_ROUND(a, b, c, d, e, f, g, h, 0x983e5152, SHA256_SCHEDULE(24));
+    SHA256_ROUND(h, a, b, c, d, e, f, g, 0xa831c66d, SHA256_SCHEDULE(25));
+    SHA256_ROUND(g, h, a, b, c, d, e, f, 0xb00327c8, SHA256_SCHEDULE(26));
+    SHA256_ROUND(f, g, h, a, b, c, d, e, 0xbf597fc7, SHA256_SCHEDULE(27));
+    SHA256_ROUND(e, f, g, h, a, b, c, d, 0xc6e00bf3, SHA256_SCHEDULE(28));
+    SHA256_ROUND(d, e, f, g, h, a, b, c, 0xd5a79147, SHA256_SCHEDULE(29));
+    SHA256_ROUND(c, d, e, f, g, h, a, b, 0x06ca6351, SHA256_SCHEDULE(30));
+    SHA256_ROUND(b, c, d, e, f, g, h, a, 0x14292967, SHA256_SCHEDULE(31));
+
+    SHA256_ROUND(a, b, c, d, e, f, g, h, 0x27b70a85, SHA256_SCHEDULE(32));
+    SHA256_ROUND(h, a, b, c, d, e, f, g, 0x2e1b2138, SHA256_SCHEDULE(33));
+    SHA256_ROUND(g, h, a, b, c, d, e, f, 0x4d2c6dfc, SHA256_SCHEDULE(34));
+    SHA256_ROUND(f, g, h, a, b, c, d, e, 0x53380d13, SHA256_SCHEDULE(35));
+    SHA256_ROUND(e, f, g, h, a, b, c, d, 0x650a7354, SHA256_SCHEDULE(36));
+    SHA256_ROUND(d, e, f, g, h, a, b, c, 0x766a0abb, SHA256_SCHEDULE(37));
+    SHA256_ROUND(c, d, e, f, g, h, a, b, 0x81c2c92e, SHA256_SCHEDULE(38));
+    SHA256_ROUND(b, c, d, e, f, g, h, a, 0x92722c85, SHA256_SCHEDULE(39));
+
+    SHA256_ROUND(a, b, c, d, e, f, g, h, 0xa2bfe8a1, SHA256_SCHEDULE(40));
+    SHA256_ROUND(h, a, b, c, d, e, f, g, 0xa81a664b, SHA256_SCHEDULE(41));
+    SHA256_ROUND(g, h, a, b, c, d, e, f, 0xc24b8b70, SHA256_SCHEDULE(42));
+    SHA256_ROUND(f, g, h, a, b, c, d, e, 0xc76c51a3, SHA256_SCHEDULE(43));
+    SHA256_ROUND(e, f, g, h, a, b, c, d, 0xd192e819, SHA256_SCHEDULE(44));
+    SHA256_ROUND(d, e, f, g, h, a, b, c, 0xd6990624, SHA256_SCHEDULE(45));
+    SHA256_ROUND(c, d, e, f, g, h, a, b, 0xf40e3585, SHA256_SCHEDULE(46));
+    SHA256_ROUND(b, c, d, e, f, g, h, a, 0x106aa070, SHA256_SCHEDULE(47));
+
+    SHA256_ROUND(a, b, c, d, e, f, g, h, 0x19a4c116, SHA256_SCHEDULE(48));
+    SHA256_ROUND(h, a, b, c, d, e, f, g, 0x1e376c08, SHA256_SCHEDULE(49));
+    SHA256_ROUND(g, h, a, b, c, d, e, f, 0x2748774c, SHA256_SCHEDULE(50));
+    SHA256_ROUND(f, g, h, a, b, c, d, e, 0x34b0bcb5, SHA256_SCHEDULE(51));
+    SHA256_ROUND(e, f, g, h, a, b, c, d, 0x391c0cb3, SHA256_SCHEDULE(52));
+    SHA256_ROUND(d, e, f, g, h, a, b, c, 0x4ed8aa4a, SHA256_SCHEDULE(53));
+    SHA256_ROUND(c, d, e, f, g, h, a, b, 0x5b9cca4f, SHA256_SCHEDULE(54));
+    SHA256_ROUND(b, c, d, e, f, g, h, a, 0x682e6ff3, SHA256_SCHEDULE(55));
+
+    SHA256_ROUND(a, b, c, d, e, f, g, h, 0x748f82ee, SHA256_SCHEDULE(56));
+    SHA256_ROUND(h, a, b, c, d, e, f, g, 0x78a5636f, SHA256_SCHEDULE(57));
+    SHA256_ROUND(g, h, a, b, c, d, e, f, 0x84c87814, SHA256_SCHEDULE(58));
+    SHA256_ROUND(f, g, h, a, b, c, d, e, 0x8cc70208, SHA256_SCHEDULE(59));
+    SHA256_ROUND(e, f, g, h, a, b, c, d, 0x90befffa, SHA256_SCHEDULE(60));
+    SHA256_ROUND(d, e, f, g, h, a, b, c, 0xa4506ceb, SHA256_SCHEDULE(61));
+    SHA256_ROUND(c, d, e, f, g, h, a, b, 0xbef9a3f7, SHA256_SCHEDULE(62));
+    SHA256_ROUND(b, c, d, e, f, g, h, a, 0xc67178f2, SHA256_SCHEDULE(63));
+
+    sha256_hash->h0 += a;
+    sha256_hash->h1 += b;
+    sha256_hash->h2 += c;
+    sha256_hash->h3 += d;
+    sha256_hash->h4 += e;
+    sha256_hash->h5 += f;
+    sha256_hash->h6 += g;
+    sha256_hash->h7 += h;
+}
 
 
+static void SHA256_Process_Block(const uint8_t* M, SHA256_HASH_STRUCT *sha256_hash)
+{
+    if(SHA256_ENGINE == SHA256_ENGINE_UNROLLED)
+        SHA256_Process_Block_Unrolled(M, sha256_hash);
+    else
+        SHA256_Process_Block_Reference(M, sha256_hash);
+}
 
 
 
 /*
-    Compute the SHA256 hash of a given file.
+    Software backend (portable C, always available).
+*/
+static int Software_Is_Supported(void)
+{
+    return 1;
+}
 
-    sha256_hash.h0 is the most significant word
-    all values are processed in big-endian format
+static void Software_Process_Blocks(const uint8_t *blocks, size_t count, SHA256_HASH_STRUCT *sha256_hash)
+{
+    for(size_t i = 0; i < count; i++){
+        SHA256_Process_Block(&blocks[64*i], sha256_hash);
+    }
+}
 
-    Return the error status (EXIT_FAILURE or EXIT_SUCCESS)
+static const SHA256_BACKEND_T SHA256_Backend_Software = {
+    .name = (SHA256_ENGINE == SHA256_ENGINE_UNROLLED) ? "software (unrolled)" : "software (reference)",
+    .is_supported = Software_Is_Supported,
+    .process_blocks = Software_Process_Blocks
+};
+
+
+
+/*
+    Backend selection.
+    The backend is chosen once (on the first SHA-256 call, from the CPU feature flags) unless
+    SHA256_Set_Backend() is called explicitly.
 */
-int SHA256_hash(const char* const filename, SHA256_HASH_STRUCT *sha256_hash)
+static const SHA256_BACKEND_T *sha256_backend = NULL;
+
+static const SHA256_BACKEND_T* get_backend_by_id(SHA256_BACKEND_ID_T backend_id)
 {
-    FILE *file = fopen(filename, "rb");
-    int filesize = get_filesize(filename);
+    switch(backend_id)
+    {
+        case SHA256_BACKEND_SOFTWARE: return &SHA256_Backend_Software;
+#if SHA_X86_BACKENDS
+        case SHA256_BACKEND_SHANI: return &SHA256_Backend_SHANI;
+#endif
+#if SHA_ARMV8_BACKENDS
+        case SHA256_BACKEND_ARMV8: return &SHA256_Backend_ARMv8;
+#endif
+        default: return NULL;
+    }
+}
 
-    if( (file == NULL) || (filesize == -1) ){
-        printf("SHA256 Error: cannot open file.\n");
+
+/*
+    Select the backend used by the contexts initialized from now on.
+
+    Return EXIT_FAILURE if the backend is not supported by this CPU (the current backend is kept).
+*/
+int SHA256_Set_Backend(SHA256_BACKEND_ID_T backend_id)
+{
+    if(backend_id == SHA256_BACKEND_AUTO){
+        SHA256_BACKEND_ID_T candidates[] = {SHA256_BACKEND_SHANI, SHA256_BACKEND_ARMV8, SHA256_BACKEND_SOFTWARE};
+
+        for(int i = 0; i < (int)(sizeof(candidates)/sizeof(candidates[0])); i++){
+            if(SHA256_Set_Backend(candidates[i]) == EXIT_SUCCESS){
+                return EXIT_SUCCESS;
+            }
+        }
+        return EXIT_FAILURE;
+    }
+
+    const SHA256_BACKEND_T *backend = get_backend_by_id(backend_id);
+    if((backend == NULL) || (backend->is_supported() == 0)){
         return EXIT_FAILURE;
     }
 
+    sha256_backend = backend;
+    return EXIT_SUCCESS;
+}
 
 
-    /* SHA256 operates on 512-bits (64 * 8-bits) wide blocks
-    *  Filesize (bits) = 512*q + r
-    *  q = number of 512-bits (64 bytes) wide blocks; r = remainder (bytes)
-    */
-    int r = filesize % (512/8);
-    int q = filesize / (512/8);
+/*
+    Current backend (selected on the first call).
+*/
+const SHA256_BACKEND_T* SHA256_Get_Backend(void)
+{
+    if(sha256_backend == NULL){
+        SHA256_Set_Backend(SHA256_BACKEND_AUTO);
+    }
+    return sha256_backend;
+}
+
 
+const char* SHA256_Get_Backend_Name(void)
+{
+    return SHA256_Get_Backend()->name;
+}
 
+
+
+
+
+
+
+/*
+    Start a new hash.
+*/
+void SHA256_Context_Init(SHA256_CONTEXT_T *context)
+{
     /* hash initialization */
-    sha256_hash->h0 = 0x6a09e667;
-    sha256_hash->h1 = 0xbb67ae85;
-    sha256_hash->h2 = 0x3c6ef372;
-    sha256_hash->h3 = 0xa54ff53a;
-    sha256_hash->h4 = 0x510e527f;
-    sha256_hash->h5 = 0x9b05688c;
-    sha256_hash->h6 = 0x1f83d9ab;
-    sha256_hash->h7 = 0x5be0cd19;
+    context->hash.h0 = 0x6a09e667;
+    context->hash.h1 = 0xbb67ae85;
+    context->hash.h2 = 0x3c6ef372;
+    context->hash.h3 = 0xa54ff53a;
+    context->hash.h4 = 0x510e527f;
+    context->hash.h5 = 0x9b05688c;
+    context->hash.h6 = 0x1f83d9ab;
+    context->hash.h7 = 0x5be0cd19;
+
+    context->length = 0;
+    context->buffer_size = 0;
+    context->backend = SHA256_Get_Backend();
+}
+
+
+/*
+    Hash "size" more bytes. The full blocks of data are processed in place; only the bytes of a partial
+    block are copied into the context.
+*/
+void SHA256_Context_Update(SHA256_CONTEXT_T *context, const uint8_t *data, size_t size)
+{
+    context->length += size;
 
+    /* complete the partial block first */
+    if(context->buffer_size > 0){
+        size_t n = __min_(64 - context->buffer_size, size);
 
-    uint8_t block[64];     // 512-bits block
+        memcpy(&context->buffer[context->buffer_size], data, n);
+        context->buffer_size += n;
+        data += n;
+        size -= n;
 
-    /* process each 512-bits block */
-    for(int i = 0; i < q; i++){
-        fread(&block, sizeof(uint8_t), 64, file);
-        SHA256_Process_Block(block, sha256_hash);
+        if(context->buffer_size < 64)
+            return;
+
+        context->backend->process_blocks(context->buffer, 1, &context->hash);
+        context->buffer_size = 0;
     }
 
-    /* process last block (+ padding) */
-    uint8_t last_block[64];     // 512-bits last block
-    fread(&last_block, sizeof(uint8_t), r, file);           // r <= 63
+    /* process all the 512-bits blocks at once */
+    size_t blocks = size / 64;
+    if(blocks > 0){
+        context->backend->process_blocks(data, blocks, &context->hash);
+        data += 64*blocks;
+        size -= 64*blocks;
+    }
+
+    memcpy(context->buffer, data, size);
+    context->buffer_size = size;
+}
+
+
+/*
+    Padding of the last block and hash result. The context must be initialized again before being reused.
+
+    sha256_hash.h0 is the most significant word
+*/
+void SHA256_Context_Final(SHA256_CONTEXT_T *context, SHA256_HASH_STRUCT *sha256_hash)
+{
+    uint8_t *last_block = context->buffer;      // 512-bits last block
+    size_t r = context->buffer_size;
+
     last_block[r] = 0x80;           // append a "1" bit
 
-    if((r+1) <= 64-8)           // enough space to put the file length (64-bits = 8 bytes)
+    if((r+1) <= 64-8)           // enough space to put the message length (64-bits = 8 bytes)
     {
-        for(int i = r+1; i < 64-8; i++){
-            last_block[i] = 0;      // 0-padding
-        }
+        memset(&last_block[r+1], 0, 64-8 - (r+1));      // 0-padding
     }
     else        // not enough space, we need a second block
     {
-        for(int i = r+1; i < 64; i++){
-            last_block[i] = 0;          // 0-padding
-        }
-        SHA256_Process_Block(last_block, sha256_hash);
+        memset(&last_block[r+1], 0, 64 - (r+1));        // 0-padding
+        context->backend->process_blocks(last_block, 1, &context->hash);
 
         /* add a second "last block" */
-        for(int i = 0; i < 64-8; i++){
-            last_block[i] = 0;          // 0-padding
-        }
+        memset(last_block, 0, 64-8);
+    }
+
+    /* append message length, in 64-bits big-endian format */
+    uint64_t bit_length = switch_endianness_64(context->length * 8);
+    memcpy(&last_block[64-8], &bit_length, sizeof(uint64_t));
+
+    context->backend->process_blocks(last_block, 1, &context->hash);         // process the very last block
+
+    *sha256_hash = context->hash;
+
+    memset(context, 0, sizeof(SHA256_CONTEXT_T));
+}
+
+
+/*
+    Compute the SHA256 hash of a given file.
+
+    sha256_hash.h0 is the most significant word
+    all values are processed in big-endian format
+
+    Return the error status (EXIT_FAILURE or EXIT_SUCCESS)
+*/
+int SHA256_hash(const char* const filename, SHA256_HASH_STRUCT *sha256_hash)
+{
+    FILE *file = fopen(filename, "rb");
+
+    if(file == NULL){
+        printf("SHA256 Error: cannot open file.\n");
+        return EXIT_FAILURE;
     }
 
-    /* append file length, in 64-bits big-endian format */
-    *(uint64_t*)&last_block[64-8] = switch_endianness_64((uint64_t)filesize * 8);
+    SHA256_CONTEXT_T context;
+    uint8_t *chunk = (uint8_t*)malloc(SHA256_FILE_CHUNK_SIZE);
+    size_t n;
 
-    SHA256_Process_Block(last_block, sha256_hash);            // process the very last block
+    if(chunk == NULL){
+        printf("SHA256 Error: memory allocation failed.\n");
+        fclose(file);
+        return EXIT_FAILURE;
+    }
 
+    SHA256_Context_Init(&context);
+    while((n = fread(chunk, sizeof(uint8_t), SHA256_FILE_CHUNK_SIZE, file)) > 0){
+        SHA256_Context_Update(&context, chunk, n);
+    }
+    SHA256_Context_Final(&context, sha256_hash);
 
+    free(chunk);
     fclose(file);
 
     return EXIT_SUCCESS;
@@ -190,6 +469,59 @@ void SHA256_test(void)
     SHA256_HASH_STRUCT sha256_hash;
     SHA256_hash("plain_data_test.txt", &sha256_hash);
 
+    printf("SHA256 backend: %s\n", SHA256_Get_Backend_Name());
     printf("SHA256 hash: ");
     SHA256_Print_Hash(&sha256_hash);
+
+    /*
+        Every backend supported by the CPU: FIPS 180-4 known answers ("abc" and the 448-bits message),
+        and a multi-block message at an odd address compared with the software backend.
+    */
+    const char *const kat_messages[2] = {"abc", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"};
+    const SHA256_HASH_STRUCT kat_expected[2] = {
+        {0xba7816bf, 0x8f01cfea, 0x414140de, 0x5dae2223, 0xb00361a3, 0x96177a9c, 0xb410ff61, 0xf20015ad},
+        {0x248d6a61, 0xd20638b8, 0xe5c02693, 0x0c3e6039, 0xa33ce459, 0x64ff2167, 0xf6ecedd4, 0x19db06c1}
+    };
+    const SHA256_BACKEND_ID_T backends[] = {SHA256_BACKEND_SOFTWARE, SHA256_BACKEND_SHANI, SHA256_BACKEND_ARMV8};
+    SHA256_HASH_STRUCT software_hash;
+    SHA256_CONTEXT_T context;
+    uint8_t data[1001];
+
+    for(int i = 0; i < 1001; i++){
+        data[i] = (uint8_t)(i * 13);
+    }
+    for(int b = 0; b < (int)(sizeof(backends)/sizeof(backends[0])); b++){
+        if(SHA256_Set_Backend(backends[b]) != EXIT_SUCCESS)
+            continue;
+
+        int ok = 1;
+        for(int m = 0; m < 2; m++){
+            SHA256_Context_Init(&context);
+            SHA256_Context_Update(&context, (const uint8_t*)kat_messages[m], strlen(kat_messages[m]));
+            SHA256_Context_Final(&context, &sha256_hash);
+            ok &= (memcmp(&sha256_hash, &kat_expected[m], sizeof(SHA256_HASH_STRUCT)) == 0);
+        }
+
+        SHA256_Context_Init(&context);
+        SHA256_Context_Update(&context, &data[1], 1000);
+        SHA256_Context_Final(&context, &sha256_hash);
+        if(backends[b] == SHA256_BACKEND_SOFTWARE)
+            software_hash = sha256_hash;
+        ok &= (memcmp(&sha256_hash, &software_hash, sizeof(SHA256_HASH_STRUCT)) == 0);
+
+        printf("SHA256 known answer (%s): %s\n", SHA256_Get_Backend_Name(), ok ? "OK" : "FAILED");
+    }
+    SHA256_Set_Backend(SHA256_BACKEND_AUTO);
+
+    /* unrolled compression function: same states as the reference one on random blocks */
+    uint32_t random_blocks[16 * 64];
+    SHA256_HASH_STRUCT reference_hash = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    SHA256_HASH_STRUCT unrolled_hash = reference_hash;
+
+    random_array(random_blocks, 16 * 64);
+    for(int i = 0; i < 64; i++){
+        SHA256_Process_Block_Reference((const uint8_t*)&random_blocks[16*i], &reference_hash);
+        SHA256_Process_Block_Unrolled((const uint8_t*)&random_blocks[16*i], &unrolled_hash);
+    }
+    printf("SHA256 unrolled compression: %s\n", (memcmp(&reference_hash, &unrolled_hash, sizeof(SHA256_HASH_STRUCT)) == 0) ? "OK" : "FAILED");
 }
\ No newline at end of file
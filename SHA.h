@@ -8,6 +8,13 @@
 #include "helpers.h"
 
 
+#define SHA256_ENGINE_REFERENCE     0       // generic loops, 64-words message schedule (reference path)
+#define SHA256_ENGINE_UNROLLED      1       // 64 rounds unrolled, rolling 16-words message schedule
+#define SHA256_ENGINE               SHA256_ENGINE_UNROLLED      // select the compression function
+
+#define SHA256_FILE_CHUNK_SIZE      65536   // number of bytes read at once by SHA256_hash()
+
+
 #define SHA256_ROTRn(x, n)     ((x >> n) | (x << (32-n)))          // circular right shift (32-bits operand)
 #define SHA256_SHRn(x,n)       (x >> n)                            // right shift
 #define SHA256_Ch(x,y,z)       ((x & y) ^ ((~x) & z))
@@ -30,6 +37,35 @@ typedef struct {
 } SHA256_HASH_STRUCT;
 
 
+/* SHA-256 backends, selected at run-time (SHA256_BACKEND_AUTO picks the fastest one supported by the CPU) */
+typedef enum {
+    SHA256_BACKEND_AUTO = 0,
+    SHA256_BACKEND_SOFTWARE,        // portable C compression function selected by SHA256_ENGINE
+    SHA256_BACKEND_SHANI,           // x86 SHA extensions (SHA256RNDS2, SHA256MSG1, SHA256MSG2)
+    SHA256_BACKEND_ARMV8            // ARMv8 cryptography extensions (SHA256H, SHA256H2, SHA256SU0, SHA256SU1)
+} SHA256_BACKEND_ID_T;
+
+
+/*
+    Incremental hashing context (SHA256_Context_Init(), SHA256_Context_Update(), SHA256_Context_Final()): the hash
+    of the full blocks already processed, and the bytes of the current partial block.
+*/
+typedef struct {
+    SHA256_HASH_STRUCT hash;
+    uint64_t length;                // total number of bytes hashed
+    uint8_t buffer[64];             // partial block
+    size_t buffer_size;
+    const struct SHA256_BACKEND_S *backend;     // compression backend, chosen by SHA256_Context_Init()
+} SHA256_CONTEXT_T;
+
+
+int SHA256_Set_Backend(SHA256_BACKEND_ID_T backend_id);
+const char* SHA256_Get_Backend_Name(void);
+
+void SHA256_Context_Init(SHA256_CONTEXT_T *context);
+void SHA256_Context_Update(SHA256_CONTEXT_T *context, const uint8_t *data, size_t size);
+void SHA256_Context_Final(SHA256_CONTEXT_T *context, SHA256_HASH_STRUCT *sha256_hash);
+
 int SHA256_hash(const char* const file_name, SHA256_HASH_STRUCT *sha256_hash);
 void SHA256_Print_Hash(SHA256_HASH_STRUCT *sha256_hash);
 void SHA256_test(void);
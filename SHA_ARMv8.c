@@ -0,0 +1,91 @@
+/*
+    SHA-256 backend using the ARMv8 cryptography extensions (SHA256H, SHA256H2, SHA256SU0, SHA256SU1).
+
+    The state is kept as ABCD / EFGH in two vector registers for the whole run of blocks; SHA256H and
+    SHA256H2 each update one half over 4 rounds, and the message schedule is computed 4 words at a time.
+    Only built for AArch64 (the compiler must accept the "+sha2" target).
+*/
+#include "SHA_backends.h"
+
+#if SHA_ARMV8_BACKENDS
+
+#include <arm_neon.h>
+
+
+#define ARMV8_TARGET            __attribute__((target("+sha2")))
+
+
+static int ARMv8_Is_Supported(void)
+{
+    return cpu_has_feature(CPU_FEATURE_SHA);
+}
+
+
+/* 4 rounds: message words "w" (W[4g..4g+3]) */
+#define ARMV8_ROUNDS(g, w)                                                  \
+    do {                                                                    \
+        uint32x4_t wk = vaddq_u32(w, vld1q_u32(&SHA256_K[4*(g)]));          \
+        uint32x4_t abcd = state0;                                           \
+        state0 = vsha256hq_u32(state0, state1, wk);                         \
+        state1 = vsha256h2q_u32(state1, abcd, wk);                          \
+    } while(0)
+
+/* W[4g..4g+3] from the 4 previous groups, "w0" holding W[4g-16..4g-13] */
+#define ARMV8_SCHEDULE(w0, w1, w2, w3)                                      \
+    (w0 = vsha256su1q_u32(vsha256su0q_u32(w0, w1), w2, w3))
+
+ARMV8_TARGET static void ARMv8_Process_Blocks(const uint8_t *blocks, size_t count, SHA256_HASH_STRUCT *sha256_hash)
+{
+    uint32_t hash[8] = {sha256_hash->h0, sha256_hash->h1, sha256_hash->h2, sha256_hash->h3,
+                        sha256_hash->h4, sha256_hash->h5, sha256_hash->h6, sha256_hash->h7};
+
+    uint32x4_t state0 = vld1q_u32(&hash[0]);       // ABCD
+    uint32x4_t state1 = vld1q_u32(&hash[4]);       // EFGH
+
+    for(size_t i = 0; i < count; i++, blocks += 64){
+        uint32x4_t saved0 = state0;
+        uint32x4_t saved1 = state1;
+
+        /* big-endian words */
+        uint32x4_t w0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&blocks[0])));
+        uint32x4_t w1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&blocks[16])));
+        uint32x4_t w2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&blocks[32])));
+        uint32x4_t w3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&blocks[48])));
+
+        ARMV8_ROUNDS(0, w0);
+        ARMV8_ROUNDS(1, w1);
+        ARMV8_ROUNDS(2, w2);
+        ARMV8_ROUNDS(3, w3);
+
+        for(int g = 4; g < 16; g += 4){
+            ARMV8_ROUNDS(g, ARMV8_SCHEDULE(w0, w1, w2, w3));
+            ARMV8_ROUNDS(g + 1, ARMV8_SCHEDULE(w1, w2, w3, w0));
+            ARMV8_ROUNDS(g + 2, ARMV8_SCHEDULE(w2, w3, w0, w1));
+            ARMV8_ROUNDS(g + 3, ARMV8_SCHEDULE(w3, w0, w1, w2));
+        }
+
+        state0 = vaddq_u32(state0, saved0);
+        state1 = vaddq_u32(state1, saved1);
+    }
+
+    vst1q_u32(&hash[0], state0);
+    vst1q_u32(&hash[4], state1);
+
+    sha256_hash->h0 = hash[0];
+    sha256_hash->h1 = hash[1];
+    sha256_hash->h2 = hash[2];
+    sha256_hash->h3 = hash[3];
+    sha256_hash->h4 = hash[4];
+    sha256_hash->h5 = hash[5];
+    sha256_hash->h6 = hash[6];
+    sha256_hash->h7 = hash[7];
+}
+
+
+const SHA256_BACKEND_T SHA256_Backend_ARMv8 = {
+    .name = "ARMv8 SHA-256",
+    .is_supported = ARMv8_Is_Supported,
+    .process_blocks = ARMv8_Process_Blocks
+};
+
+#endif      // SHA_ARMV8_BACKENDS
@@ -0,0 +1,98 @@
+/*
+    SHA-256 backend using the x86 SHA extensions (SHA256RNDS2, SHA256MSG1, SHA256MSG2).
+
+    SHA256RNDS2 does 2 rounds on the state split as ABEF / CDGH (instead of ABCD / EFGH), so the hash is
+    rearranged once per call of process_blocks() and stays in the xmm registers between the blocks.
+    The message schedule is computed 4 words at a time, with SHA256MSG1/SHA256MSG2.
+*/
+#include "SHA_backends.h"
+
+#if SHA_X86_BACKENDS
+
+#include <immintrin.h>
+
+
+#define SHANI_TARGET            __attribute__((target("sha,sse4.1,ssse3")))
+
+
+static int SHANI_Is_Supported(void)
+{
+    return cpu_has_feature(CPU_FEATURE_SHA) && cpu_has_feature(CPU_FEATURE_SSE41) && cpu_has_feature(CPU_FEATURE_SSSE3);
+}
+
+
+/* 4 rounds: message words "w" (W[4g..4g+3]) */
+#define SHANI_ROUNDS(g, w)                                                              \
+    do {                                                                                \
+        __m128i msg = _mm_add_epi32(w, _mm_loadu_si128((const __m128i*)&SHA256_K[4*(g)]));  \
+        state1 = _mm_sha256rnds2_epu32(state1, state0, msg);                           \
+        state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E)); \
+    } while(0)
+
+/* W[4g..4g+3] from the 4 previous groups, "w0" holding W[4g-16..4g-13] */
+#define SHANI_SCHEDULE(w0, w1, w2, w3)                                                  \
+    (w0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w0, w1), _mm_alignr_epi8(w3, w2, 4)), w3))
+
+SHANI_TARGET static void SHANI_Process_Blocks(const uint8_t *blocks, size_t count, SHA256_HASH_STRUCT *sha256_hash)
+{
+    const __m128i swap_mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);     // big-endian words
+    uint32_t hash[8] = {sha256_hash->h0, sha256_hash->h1, sha256_hash->h2, sha256_hash->h3,
+                        sha256_hash->h4, sha256_hash->h5, sha256_hash->h6, sha256_hash->h7};
+
+    /* ABCD / EFGH -> ABEF / CDGH */
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&hash[0]), 0xB1);       // CDAB
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&hash[4]), 0x1B);    // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);          // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);               // CDGH
+
+    for(size_t i = 0; i < count; i++, blocks += 64){
+        __m128i saved0 = state0;
+        __m128i saved1 = state1;
+
+        __m128i w0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[0]), swap_mask);
+        __m128i w1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[16]), swap_mask);
+        __m128i w2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[32]), swap_mask);
+        __m128i w3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&blocks[48]), swap_mask);
+
+        SHANI_ROUNDS(0, w0);
+        SHANI_ROUNDS(1, w1);
+        SHANI_ROUNDS(2, w2);
+        SHANI_ROUNDS(3, w3);
+
+        for(int g = 4; g < 16; g += 4){
+            SHANI_ROUNDS(g, SHANI_SCHEDULE(w0, w1, w2, w3));
+            SHANI_ROUNDS(g + 1, SHANI_SCHEDULE(w1, w2, w3, w0));
+            SHANI_ROUNDS(g + 2, SHANI_SCHEDULE(w2, w3, w0, w1));
+            SHANI_ROUNDS(g + 3, SHANI_SCHEDULE(w3, w0, w1, w2));
+        }
+
+        state0 = _mm_add_epi32(state0, saved0);
+        state1 = _mm_add_epi32(state1, saved1);
+    }
+
+    /* ABEF / CDGH -> ABCD / EFGH */
+    tmp = _mm_shuffle_epi32(state0, 0x1B);                     // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);                  // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);               // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);                  // HGFE
+    _mm_storeu_si128((__m128i*)&hash[0], state0);
+    _mm_storeu_si128((__m128i*)&hash[4], state1);
+
+    sha256_hash->h0 = hash[0];
+    sha256_hash->h1 = hash[1];
+    sha256_hash->h2 = hash[2];
+    sha256_hash->h3 = hash[3];
+    sha256_hash->h4 = hash[4];
+    sha256_hash->h5 = hash[5];
+    sha256_hash->h6 = hash[6];
+    sha256_hash->h7 = hash[7];
+}
+
+
+const SHA256_BACKEND_T SHA256_Backend_SHANI = {
+    .name = "SHA-NI",
+    .is_supported = SHANI_Is_Supported,
+    .process_blocks = SHANI_Process_Blocks
+};
+
+#endif      // SHA_X86_BACKENDS
@@ -0,0 +1,49 @@
+#ifndef SHA_BACKENDS_H_
+#define SHA_BACKENDS_H_
+
+/*
+    Internal interface between the SHA-256 hashing functions (SHA.c) and the compression backends.
+    A backend processes runs of consecutive 64-bytes blocks, so that the hardware ones keep the hash in
+    their registers from one block to the next.
+*/
+#include "SHA.h"
+
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SHA_X86_BACKENDS        1
+#else
+#define SHA_X86_BACKENDS        0
+#endif
+
+#if defined(__aarch64__)
+#define SHA_ARMV8_BACKENDS      1
+#else
+#define SHA_ARMV8_BACKENDS      0
+#endif
+
+
+typedef struct SHA256_BACKEND_S {
+    const char *name;
+    int (*is_supported)(void);
+
+    /* "count" consecutive blocks */
+    void (*process_blocks)(const uint8_t *blocks, size_t count, SHA256_HASH_STRUCT *sha256_hash);
+} SHA256_BACKEND_T;
+
+
+const SHA256_BACKEND_T* SHA256_Get_Backend(void);
+
+/* SHA.c */
+extern const uint32_t SHA256_K[64];
+
+
+#if SHA_X86_BACKENDS
+extern const SHA256_BACKEND_T SHA256_Backend_SHANI;
+#endif
+
+#if SHA_ARMV8_BACKENDS
+extern const SHA256_BACKEND_T SHA256_Backend_ARMv8;
+#endif
+
+
+#endif      // SHA_BACKENDS_H_
@@ -2,6 +2,22 @@
     Helpers functions
 */
 #include "helpers.h"
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
 
 /*
@@ -40,6 +56,76 @@ int get_filesize(const char* const filename)
 }
 
 
+/*
+    Get the size in bytes of a given file, without the 2 GB limit of get_filesize().
+
+    Return -1 in case of error.
+*/
+int64_t get_filesize_64(const char* const filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if(file == NULL){
+        return -1;
+    }
+
+#ifdef _WIN32
+    _fseeki64(file, 0, SEEK_END);
+    int64_t size = _ftelli64(file);
+#else
+    fseeko(file, 0, SEEK_END);
+    int64_t size = ftello(file);
+#endif
+    fclose(file);
+
+    return size;
+}
+
+
+/*
+    Move the cursor of a file to an absolute position (64-bits offset).
+
+    Return the error status (EXIT_FAILURE or EXIT_SUCCESS).
+*/
+int file_seek_64(FILE *file, int64_t offset)
+{
+#ifdef _WIN32
+    int status = _fseeki64(file, offset, SEEK_SET);
+#else
+    int status = fseeko(file, (off_t)offset, SEEK_SET);
+#endif
+
+    return (status == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/*
+    Read "size" bytes at an absolute position of a file. On POSIX systems, pread() is used: the cursor
+    of the file is not moved and several threads can read the same FILE at once.
+
+    Return the number of bytes read (less than "size" at the end of the file).
+*/
+size_t file_read_at(FILE *file, void *buffer, size_t size, int64_t offset)
+{
+#ifdef _WIN32
+    if(file_seek_64(file, offset) == EXIT_FAILURE){
+        return 0;
+    }
+    return fread(buffer, sizeof(uint8_t), size, file);
+#else
+    size_t done = 0;
+
+    while(done < size){
+        ssize_t count = pread(fileno(file), (uint8_t*)buffer + done, size - done, (off_t)(offset + done));
+        if(count <= 0){
+            break;
+        }
+        done += (size_t)count;
+    }
+    return done;
+#endif
+}
+
+
 /*
     Swap two byte elements.
 
@@ -89,6 +175,182 @@ uint64_t switch_endianness_64(uint64_t number)
 
 
 
+#if defined(__x86_64__) || defined(__i386__)
+/*
+    AVX2: CPUID (leaf 7) and the OS must save the ymm registers (OSXSAVE, XCR0 bits 1 and 2).
+*/
+static int cpu_has_avx2(unsigned int ecx_leaf_1)
+{
+    unsigned int eax, ebx, ecx, edx;
+    unsigned int xcr0_low, xcr0_high;
+
+    if(  (((ecx_leaf_1 >> 27) & 1) == 0) || (((ecx_leaf_1 >> 28) & 1) == 0)  ){
+        return 0;       // no OSXSAVE or no AVX
+    }
+
+    __asm__ volatile("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+    if((xcr0_low & 0x6) != 0x6){
+        return 0;
+    }
+
+    if(__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0){
+        return 0;
+    }
+
+    return (ebx >> 5) & 1;
+}
+
+
+/* leaf 7: SHA extensions */
+static int cpu_has_sha(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if(__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0){
+        return 0;
+    }
+
+    return (ebx >> 29) & 1;
+}
+#endif
+
+
+/*
+    Check whether the CPU we are running on supports a given instruction set extension (CPUID).
+
+    Return 1 if the feature is available, 0 otherwise (on ARMv8 Linux only CPU_FEATURE_SHA is detected,
+    always 0 on the other targets).
+*/
+int cpu_has_feature(CPU_FEATURE_T feature)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+
+    if(__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0){
+        return 0;
+    }
+
+    switch(feature)
+    {
+        case CPU_FEATURE_SSE2:      return (edx >> 26) & 1;
+        case CPU_FEATURE_SSSE3:     return (ecx >> 9) & 1;
+        case CPU_FEATURE_SSE41:     return (ecx >> 19) & 1;
+        case CPU_FEATURE_AESNI:     return (ecx >> 25) & 1;
+        case CPU_FEATURE_PCLMULQDQ: return (ecx >> 1) & 1;
+        case CPU_FEATURE_AVX2:      return cpu_has_avx2(ecx);
+        case CPU_FEATURE_SHA:       return cpu_has_sha();
+        default:                    return 0;
+    }
+#elif defined(__aarch64__) && defined(__linux__)
+    switch(feature)
+    {
+        case CPU_FEATURE_SHA:       return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+        default:                    return 0;
+    }
+#else
+    (void)feature;
+    return 0;
+#endif
+}
+
+
+
+
+/*
+    Number of logical CPUs available (at least 1).
+*/
+int get_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int count = (int)info.dwNumberOfProcessors;
+#else
+    int count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    return (count > 0) ? count : 1;
+}
+
+
+typedef struct {
+    PARALLEL_TASK_T task;
+    void *arg;
+    uint64_t begin;
+    uint64_t end;
+} PARALLEL_RANGE_T;
+
+static void* parallel_worker(void *range_ptr)
+{
+    PARALLEL_RANGE_T *range = (PARALLEL_RANGE_T*)range_ptr;
+    range->task(range->begin, range->end, range->arg);
+    return NULL;
+}
+
+
+/*
+    Split [0, count) into "threads" contiguous ranges and run task(begin, end, arg) on each of them,
+    in parallel. The calling thread processes the first range; the function returns when all ranges are done.
+
+    Parameters:
+        - count  : number of items
+        - threads: number of threads (0 = one per CPU), never more than count
+        - task   : function called once per range
+        - arg    : shared argument passed to task
+
+    If a thread cannot be created, its range is processed by the calling thread.
+    If the bookkeeping arrays cannot be allocated, the whole [0, count) range is processed by the calling thread.
+*/
+void parallel_for(uint64_t count, int threads, PARALLEL_TASK_T task, void *arg)
+{
+    if(threads <= 0){
+        threads = get_cpu_count();
+    }
+    if((uint64_t)threads > count){
+        threads = (count > 0) ? (int)count : 1;
+    }
+
+    PARALLEL_RANGE_T *ranges = (PARALLEL_RANGE_T*)malloc(threads * sizeof(PARALLEL_RANGE_T));
+    pthread_t *thread_ids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    int *started = (int*)calloc(threads, sizeof(int));
+    if(ranges == NULL || thread_ids == NULL || started == NULL){
+        free(ranges);
+        free(thread_ids);
+        free(started);
+        task(0, count, arg);
+        return;
+    }
+
+    for(int i = 0; i < threads; i++){
+        ranges[i].task = task;
+        ranges[i].arg = arg;
+        ranges[i].begin = (count * i) / threads;
+        ranges[i].end = (count * (i+1)) / threads;
+    }
+
+    for(int i = 1; i < threads; i++){
+        started[i] = (pthread_create(&thread_ids[i], NULL, parallel_worker, &ranges[i]) == 0);
+    }
+
+    parallel_worker(&ranges[0]);
+
+    for(int i = 1; i < threads; i++){
+        if(started[i]){
+            pthread_join(thread_ids[i], NULL);
+        }
+        else{
+            parallel_worker(&ranges[i]);
+        }
+    }
+
+    free(ranges);
+    free(thread_ids);
+    free(started);
+}
+
+
+
+
 /*
     Return the maximum number of characters required to represent a mpz_t variable as a string.
 
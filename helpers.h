@@ -17,6 +17,17 @@
 #define GET_VARIABLE_NAME(variable)         TO_STRING(variable)
 
 
+typedef enum {
+    CPU_FEATURE_SSE2,
+    CPU_FEATURE_SSSE3,
+    CPU_FEATURE_SSE41,
+    CPU_FEATURE_AESNI,
+    CPU_FEATURE_PCLMULQDQ,
+    CPU_FEATURE_AVX2,
+    CPU_FEATURE_SHA             // x86 SHA extensions, ARMv8 SHA-256 instructions
+} CPU_FEATURE_T;
+
+
 typedef enum {
     PRINT_FORMAT_HEX = 16,
     PRINT_FORMAT_DEC = 10,
@@ -26,12 +37,21 @@ typedef enum {
 
 void random_array(uint32_t *arr, unsigned int size);
 int get_filesize(const char* const filename);
+int64_t get_filesize_64(const char* const filename);
+int file_seek_64(FILE *file, int64_t offset);
+size_t file_read_at(FILE *file, void *buffer, size_t size, int64_t offset);
 void swap_bytes(uint8_t *x, uint8_t *y);
 
 uint32_t left_circular_shift_32(uint32_t number, int shift);
 uint32_t switch_endianness_32(uint32_t number);
 uint64_t switch_endianness_64(uint64_t number);
 
+int cpu_has_feature(CPU_FEATURE_T feature);
+int get_cpu_count(void);
+
+typedef void (*PARALLEL_TASK_T)(uint64_t begin, uint64_t end, void *arg);
+void parallel_for(uint64_t count, int threads, PARALLEL_TASK_T task, void *arg);
+
 size_t get_char_len_mpz_t(const mpz_t number, PRINT_FORMAT_T format);
 char* get_str_mpz_t(const mpz_t number, size_t *str_len, PRINT_FORMAT_T format);
 void print_mpz_t(const mpz_t number, const char* const var_name, PRINT_FORMAT_T format);
@@ -6,12 +6,22 @@
 #include "DES.h"
 #include "RSA.h"
 #include "ECC.h"
+#include "DIGEST.h"
 
 
-int main(void)
+/*
+    Run the tests of every module, or only the load tests with "--benchmark".
+*/
+int main(int argc, char *argv[])
 {
+    if(  (argc > 1) && (strcmp(argv[1], "--benchmark") == 0)  ){
+        DES_Key_Search_Benchmark(1 << 20, 0);
+        return 0;
+    }
+
     MD5_test();
     SHA256_test();
+    DIGEST_test();
     printf("\n\n\n\n\n");
 
     OTP_test();